@@ -6,6 +6,10 @@ find_package( Eigen3 REQUIRED )
 include_directories(SYSTEM ${EIGEN3_INCLUDE_DIR})
 list(APPEND gp_LIBRARIES ${EIGEN3_LIBRARIES})
 
+# Find threads.
+find_package( Threads REQUIRED )
+list(APPEND gp_LIBRARIES ${CMAKE_THREAD_LIBS_INIT})
+
 # Find matplotpp.
 #find_package( matplotpp REQUIRED )
 #include_directories(SYSTEM ${MATPLOTPP_INCLUDE_DIR})
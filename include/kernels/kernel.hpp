@@ -68,6 +68,38 @@ namespace gp {
     virtual void Gradient(const VectorXd& x, const VectorXd& y,
                           VectorXd& gradient) const = 0;
 
+    // Create a deep copy of this kernel, including its current parameters.
+    virtual Kernel::Ptr Clone() const = 0;
+
+    // Kernels which depend on a pair of points only through the elementwise
+    // squared difference (x - y).^2 may be evaluated from precomputed
+    // squared differences, one pair per row. This lets callers which
+    // evaluate many pairs at many parameter values cache the differences.
+    virtual bool SupportsSquaredDifferences() const { return false; }
+    virtual void EvaluateSquaredDifferences(
+      const Eigen::Ref<const MatrixXd>& squared_differences,
+      VectorXd& values) const {
+      LOG(FATAL) << "Squared differences are not supported by this kernel.";
+    }
+    virtual void PartialSquaredDifferences(
+      const Eigen::Ref<const MatrixXd>& squared_differences,
+      const VectorXd& values, size_t ii, VectorXd& partials) const {
+      LOG(FATAL) << "Squared differences are not supported by this kernel.";
+    }
+
+    // Kernels which are differentiable in their first argument may provide
+    // the gradient and Hessian of k(x, y) with respect to x. 'value' is
+    // k(x, y), which callers usually have already.
+    virtual bool SupportsInputGradient() const { return false; }
+    virtual void InputGradient(const VectorXd& x, const VectorXd& y,
+                               double value, VectorXd& gradient) const {
+      LOG(FATAL) << "Input gradients are not supported by this kernel.";
+    }
+    virtual void InputHessian(const VectorXd& x, const VectorXd& y,
+                              double value, MatrixXd& hessian) const {
+      LOG(FATAL) << "Input gradients are not supported by this kernel.";
+    }
+
     // Access and reset params.
     VectorXd& Params() { return params_; }
     const VectorXd& ImmutableParams() const { return params_; }
@@ -59,6 +59,25 @@ namespace gp {
     double Partial(const VectorXd& x, const VectorXd& y, size_t ii) const;
     void Gradient(const VectorXd& x, const VectorXd& y,
                   VectorXd& gradient) const;
+    Kernel::Ptr Clone() const;
+
+    // Evaluation from precomputed squared differences. 'values' holds the
+    // kernel evaluated at each pair, as computed by EvaluateSquaredDifferences.
+    bool SupportsSquaredDifferences() const { return true; }
+    void EvaluateSquaredDifferences(
+      const Eigen::Ref<const MatrixXd>& squared_differences,
+      VectorXd& values) const;
+    void PartialSquaredDifferences(
+      const Eigen::Ref<const MatrixXd>& squared_differences,
+      const VectorXd& values, size_t ii, VectorXd& partials) const;
+
+    // Gradient and Hessian with respect to x. With u = inv(L) (x - y), these
+    // are -k u and k (u u^T - inv(L)).
+    bool SupportsInputGradient() const { return true; }
+    void InputGradient(const VectorXd& x, const VectorXd& y, double value,
+                       VectorXd& gradient) const;
+    void InputHessian(const VectorXd& x, const VectorXd& y, double value,
+                      MatrixXd& hessian) const;
 
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   private:
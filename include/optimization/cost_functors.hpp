@@ -44,27 +44,48 @@
 
 #include "../process/gaussian_process.hpp"
 #include "../kernels/kernel.hpp"
+#include "../utils/thread_pool.hpp"
 
+#include <Eigen/Cholesky>
 #include <ceres/ceres.h>
 #include <glog/logging.h>
+#include <algorithm>
 #include <math.h>
+#include <memory>
+#include <vector>
 
 namespace gp {
 
   // Compute twice the negative log-likelihood of the training data of a GP
-  // and the gradient against all the parameters of the kernel.
+  // and the gradient against all the parameters of the kernel. The functor
+  // keeps workspaces for the covariance, its factorization and inverse, and
+  // the regressed targets, and reuses the factorization when evaluated again
+  // at the same parameters (e.g. by a line search which evaluates the cost
+  // first and the gradient later). Hence it must not be shared across threads.
   class TrainingLogLikelihood : public ceres::FirstOrderFunction {
   public:
+    // Default memory budget for caching squared differences (256 MB).
+    static const size_t kDefaultMaxCacheBytes = 1 << 28;
+
     // Inputs: training points, training targets, kernel, and noise.
     // Optimization variables: kernel parameters.
+    // If the kernel supports it, the squared differences between all pairs of
+    // training points are computed once here and reused by every evaluation,
+    // provided they fit in 'max_cache_bytes'. Otherwise they are recomputed.
     TrainingLogLikelihood(const PointSet& points,
                           const VectorXd* targets,
                           const Kernel::Ptr& kernel,
-                          double noise)
+                          double noise,
+                          size_t max_cache_bytes = kDefaultMaxCacheBytes)
       : points_(points),
         targets_(targets),
         kernel_(kernel),
-        noise_(noise) {
+        noise_(noise),
+        use_squared_differences_(false),
+        cache_squared_differences_(false),
+        factored_(false),
+        inverted_(false),
+        num_factorizations_(0) {
       CHECK_NOTNULL(targets);
       CHECK_NOTNULL(points.get());
       CHECK_NOTNULL(kernel.get());
@@ -72,79 +93,584 @@ namespace gp {
       CHECK_EQ(points->size(), targets->size());
       CHECK_GE(points->size(), 1);
       CHECK_GT(noise, 0.0);
+
+      // Maybe cache squared differences. Pairs are stored row by row in the
+      // order of the strict lower triangle of the covariance matrix.
+      use_squared_differences_ = kernel_->SupportsSquaredDifferences();
+
+      const size_t N = points_->size();
+      const size_t dimension = points_->front().size();
+      const size_t num_pairs = N * (N - 1) / 2;
+      cache_squared_differences_ = use_squared_differences_ &&
+        num_pairs * dimension * sizeof(double) <= max_cache_bytes;
+
+      if (cache_squared_differences_) {
+        squared_differences_.resize(num_pairs, dimension);
+
+        MatrixXd block;
+        for (size_t ii = 1; ii < N; ii++) {
+          ComputeSquaredDifferences(ii, block);
+          squared_differences_.middleRows(FirstPair(ii), ii) = block;
+        }
+      }
     }
 
-    // Evaluate objective function and gradient. For details please see
-    // R&W, pg. 113/4, eqs. 5.8/9. For simplicity we leave off the constant.
+    // Evaluate objective function and gradient, with a log barrier so that
+    // parameters don't go negative.
     bool Evaluate(const double* const parameters,
                   double* cost, double* gradient) const {
+      if (!Objective(parameters, cost, gradient))
+        return false;
+
+      AddBarrier(parameters, NumParameters(), cost, gradient);
+      return true;
+    }
+
+    // Evaluate the objective and (optionally) its gradient, without the
+    // barrier. For details please see R&W, pg. 113/4, eqs. 5.8/9. For
+    // simplicity we leave off the constant.
+    bool Objective(const double* const parameters,
+                   double* cost, double* gradient) const {
       // Update the kernel.
       for (size_t ii = 0; ii < NumParameters(); ii++)
         kernel_->Params()(ii) = parameters[ii];
 
-      // Create a new GP model and extract computed variables.
-      GaussianProcess gp(kernel_, noise_, points_, *targets_, points_->size());
-      const Eigen::LLT<MatrixXd>& llt = gp.ImmutableCholesky();
-      const VectorXd& regressed = gp.ImmutableRegressedTargets();
-      const MatrixXd& L = llt.matrixL();
-
       const size_t N = points_->size();
 
-      // Compute log det of covariance matrix.
-      double logdet = 0.0;
-      for (size_t ii = 0; ii < N; ii++)
-        logdet += std::log(L(ii, ii));
+      // Build and factor the covariance matrix, regress the targets, and
+      // compute the log det of the covariance matrix. Skip all of this if the
+      // parameters have not changed since the last evaluation.
+      if (!factored_ || last_parameters_ != kernel_->ImmutableParams()) {
+        last_parameters_ = kernel_->ImmutableParams();
+        inverted_ = false;
 
-      logdet *= 2.0;
+        covariance_.resize(N, N);
+        Covariance(covariance_);
 
-      // Evaluate cost. Add a log barrier so that parameters don't go negative.
-      double barrier = 0.0;
-      const double kBarrierScaling = 1e3;
-      for (size_t ii = 0; ii < NumParameters(); ii++)
-        barrier -= std::log(kBarrierScaling * parameters[ii]);
+        llt_.compute(covariance_);
+        num_factorizations_++;
+        factored_ = (llt_.info() == Eigen::Success);
+        if (!factored_)
+          return false;
+
+        regressed_ = llt_.solve(*targets_);
 
-      *cost = targets_->head(N).dot(regressed.head(N)) + logdet + barrier;
+        logdet_ = 0.0;
+        for (size_t ii = 0; ii < N; ii++)
+          logdet_ += std::log(llt_.matrixLLT()(ii, ii));
 
-      // Maybe compute gradient.
-      if (gradient) {
-        MatrixXd dK(N, N);
+        logdet_ *= 2.0;
+      }
 
-        for (size_t ii = 0; ii < NumParameters(); ii++) {
-          // Compute the derivative of covariance against the ii'th parameter.
-          for (size_t jj = 0; jj < N; jj++) {
-            dK(jj, jj) = kernel_->Partial(points_->at(jj), points_->at(jj), ii);
+      // Evaluate cost, and maybe compute gradient.
+      *cost = targets_->dot(regressed_) + logdet_;
+      if (gradient)
+        Gradient(gradient, NULL, NULL);
 
-            for (size_t kk = 0; kk < jj; kk++) {
-              dK(jj, kk) =
-                kernel_->Partial(points_->at(jj), points_->at(kk), ii);
-              dK(kk, jj) = dK(jj, kk);
-            }
-          }
+      return true;
+    }
 
-          // Compute the gradient. Must add the gradient of the log barrier.
-          gradient[ii] = llt.solve(dK).trace() - 1.0 / parameters[ii] -
-            regressed.head(N).dot(dK * regressed.head(N));
+    // Add the log barrier on the given parameters to a cost and gradient,
+    // either of which may be null.
+    static void AddBarrier(const double* const parameters,
+                           int num_parameters,
+                           double* cost, double* gradient) {
+      const double kBarrierScaling = 1e3;
+      for (int ii = 0; ii < num_parameters; ii++) {
+        if (cost)
+          *cost -= std::log(kBarrierScaling * parameters[ii]);
+        if (gradient)
+          gradient[ii] -= 1.0 / parameters[ii];
+      }
+    }
+
+    // Evaluate objective function, gradient, and the Fisher information
+    // matrix, i.e. the expected Hessian of the objective over targets drawn
+    // from the GP: tr(inv(K) dK_i inv(K) dK_j), plus the Hessian of the log
+    // barrier. This reuses the factorization and inverse from the gradient.
+    bool EvaluateFisher(const double* const parameters, double* cost,
+                        double* gradient, MatrixXd& fisher) const {
+      CHECK_NOTNULL(gradient);
+
+      if (!Evaluate(parameters, cost, NULL))
+        return false;
+
+      // Compute the gradient, keeping inv(K) dK_i for each parameter.
+      std::vector<MatrixXd> products;
+      Gradient(gradient, &products, NULL);
+      AddBarrier(parameters, NumParameters(), NULL, gradient);
+
+      // Since inv(K) and dK_j are symmetric, the trace of the product of
+      // inv(K) dK_i and inv(K) dK_j is the sum of the elementwise product of
+      // the first with the transpose of the second.
+      fisher.resize(NumParameters(), NumParameters());
+      for (size_t ii = 0; ii < NumParameters(); ii++) {
+        for (size_t jj = 0; jj <= ii; jj++) {
+          fisher(ii, jj) =
+            products[ii].cwiseProduct(products[jj].transpose()).sum();
+          fisher(jj, ii) = fisher(ii, jj);
         }
+
+        fisher(ii, ii) += 1.0 / (parameters[ii] * parameters[ii]);
       }
 
       return true;
     }
 
+    // Evaluate objective function, gradient, and the average information
+    // matrix, i.e. the mean of the Fisher information and the observed
+    // information without second derivatives of the kernel:
+    // (dK_i alpha)^T inv(K) (dK_j alpha), plus the Hessian of the log barrier.
+    // Unlike the Fisher information, this adapts to the scale of the targets,
+    // and it only costs O(N^2) per parameter on top of the gradient.
+    bool EvaluateAverageInformation(const double* const parameters,
+                                    double* cost, double* gradient,
+                                    MatrixXd& information) const {
+      CHECK_NOTNULL(gradient);
+
+      if (!Evaluate(parameters, cost, NULL))
+        return false;
+
+      // Compute the gradient, keeping dK_i alpha for each parameter.
+      MatrixXd projections;
+      Gradient(gradient, NULL, &projections);
+      AddBarrier(parameters, NumParameters(), NULL, gradient);
+
+      information.noalias() =
+        projections.transpose() * llt_.solve(projections);
+      for (size_t ii = 0; ii < NumParameters(); ii++)
+        information(ii, ii) += 1.0 / (parameters[ii] * parameters[ii]);
+
+      return true;
+    }
+
     // Number of parameters in the problem.
     int NumParameters() const {
       return static_cast<int>(kernel_->ImmutableParams().size());
     }
-    
+
+    // Are squared differences cached?
+    bool IsCached() const { return cache_squared_differences_; }
+
+    // Number of times the covariance matrix has been factored.
+    size_t NumFactorizations() const { return num_factorizations_; }
+
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   private:
+    // Index of the first pair (ii, 0) in row 'ii' of the strict lower triangle.
+    static size_t FirstPair(size_t ii) { return ii * (ii - 1) / 2; }
+
+    // Squared differences between point 'ii' and points 0, ..., ii - 1, one
+    // pair per row.
+    void ComputeSquaredDifferences(size_t ii, MatrixXd& block) const {
+      const VectorXd& x = points_->at(ii);
+      block.resize(ii, x.size());
+
+      for (size_t jj = 0; jj < ii; jj++)
+        block.row(jj) = (x - points_->at(jj)).cwiseAbs2().transpose();
+    }
+
+    // Same, but returns a view into the cache if there is one, and otherwise
+    // computes them in 'block'.
+    Eigen::Ref<const MatrixXd> SquaredDifferences(size_t ii,
+                                                  MatrixXd& block) const {
+      if (cache_squared_differences_)
+        return squared_differences_.middleRows(FirstPair(ii), ii);
+
+      ComputeSquaredDifferences(ii, block);
+      return block;
+    }
+
+    // Compute the gradient (without the barrier) at the parameters of the
+    // last factorization. Since the covariance is symmetric, trace(inv(K) dK)
+    // is just the sum of the elementwise product. Optionally store
+    // inv(K) dK_i, and dK_i alpha (as columns), for each parameter.
+    void Gradient(double* gradient, std::vector<MatrixXd>* products,
+                  MatrixXd* projections) const {
+      const size_t N = points_->size();
+
+      if (!inverted_) {
+        inverse_.setIdentity(N, N);
+        llt_.solveInPlace(inverse_);
+        inverted_ = true;
+      }
+
+      if (products)
+        products->resize(NumParameters());
+      if (projections)
+        projections->resize(N, NumParameters());
+
+      dK_.resize(N, N);
+      VectorXd projection(N);
+      for (size_t ii = 0; ii < NumParameters(); ii++) {
+        // Compute the derivative of covariance against the ii'th parameter.
+        CovariancePartial(covariance_, ii, dK_);
+
+        // Compute the gradient.
+        projection.noalias() = dK_ * regressed_;
+        gradient[ii] = inverse_.cwiseProduct(dK_).sum() -
+          regressed_.dot(projection);
+
+        if (projections)
+          projections->col(ii) = projection;
+        if (products)
+          (*products)[ii].noalias() = inverse_ * dK_;
+      }
+    }
+
+    // Compute the covariance matrix, and its derivative against the ii'th
+    // kernel parameter given the covariance matrix.
+    void Covariance(MatrixXd& covariance) const {
+      const size_t N = points_->size();
+      MatrixXd block;
+      VectorXd values;
+
+      for (size_t ii = 0; ii < N; ii++) {
+        covariance(ii, ii) = 1.0 + noise_;
+
+        if (use_squared_differences_) {
+          kernel_->EvaluateSquaredDifferences(
+            SquaredDifferences(ii, block), values);
+          covariance.row(ii).head(ii) = values.transpose();
+          covariance.col(ii).head(ii) = values;
+        } else {
+          for (size_t jj = 0; jj < ii; jj++) {
+            covariance(ii, jj) =
+              kernel_->Evaluate(points_->at(ii), points_->at(jj));
+            covariance(jj, ii) = covariance(ii, jj);
+          }
+        }
+      }
+    }
+
+    void CovariancePartial(const MatrixXd& covariance, size_t ii,
+                           MatrixXd& dK) const {
+      const size_t N = points_->size();
+      MatrixXd block;
+      VectorXd values, partials;
+
+      for (size_t jj = 0; jj < N; jj++) {
+        dK(jj, jj) = kernel_->Partial(points_->at(jj), points_->at(jj), ii);
+
+        if (use_squared_differences_) {
+          values = covariance.row(jj).head(jj).transpose();
+          kernel_->PartialSquaredDifferences(
+            SquaredDifferences(jj, block), values, ii, partials);
+          dK.row(jj).head(jj) = partials.transpose();
+          dK.col(jj).head(jj) = partials;
+        } else {
+          for (size_t kk = 0; kk < jj; kk++) {
+            dK(jj, kk) =
+              kernel_->Partial(points_->at(jj), points_->at(kk), ii);
+            dK(kk, jj) = dK(jj, kk);
+          }
+        }
+      }
+    }
+
     // Inputs: training points, training targets, kernel, and noise.
     // Optimization variables: kernel parameters.
     const PointSet points_;
     const VectorXd* targets_;
     const Kernel::Ptr kernel_;
     const double noise_;
+
+    // Squared differences between all pairs of training points, if cached.
+    bool use_squared_differences_;
+    bool cache_squared_differences_;
+    MatrixXd squared_differences_;
+
+    // Workspaces persisting across evaluations: parameters at the last
+    // factorization, covariance, its Cholesky factorization and (lazily)
+    // inverse, regressed targets, log det, and derivative of the covariance.
+    mutable VectorXd last_parameters_;
+    mutable MatrixXd covariance_;
+    mutable Eigen::LLT<MatrixXd> llt_;
+    mutable MatrixXd inverse_;
+    mutable VectorXd regressed_;
+    mutable double logdet_;
+    mutable MatrixXd dK_;
+    mutable bool factored_;
+    mutable bool inverted_;
+    mutable size_t num_factorizations_;
   }; // struct TrainingLogLikelihood
 
+  // Sum of the training log-likelihoods of disjoint shards of the training
+  // data, i.e. twice the negative log-likelihood under a covariance which is
+  // block diagonal over the shards, plus one log barrier (as in
+  // TrainingLogLikelihood). Each shard has its own TrainingLogLikelihood (and
+  // hence its own copy of the kernel), and shards are evaluated in parallel
+  // on the given thread pool, so one evaluation costs O(N^3 / K^2) per
+  // thread for K equal shards.
+  class CommitteeLogLikelihood : public ceres::FirstOrderFunction {
+  public:
+    CommitteeLogLikelihood(const std::vector<PointSet>& points,
+                           const std::vector<VectorXd>& targets,
+                           const Kernel& kernel, double noise,
+                           const ThreadPool::Ptr& pool)
+      : targets_(targets),
+        pool_(pool) {
+      CHECK_NOTNULL(pool.get());
+      CHECK_EQ(points.size(), targets.size());
+      CHECK_GE(points.size(), 1);
+
+      for (size_t ii = 0; ii < points.size(); ii++)
+        shards_.push_back(std::shared_ptr<TrainingLogLikelihood>(
+          new TrainingLogLikelihood(points[ii], &targets_[ii],
+                                    kernel.Clone(), noise)));
+    }
+
+    // Evaluate objective function and gradient. Fails if any shard fails.
+    bool Evaluate(const double* const parameters,
+                  double* cost, double* gradient) const {
+      const size_t K = shards_.size();
+      std::vector<double> costs(K);
+      std::vector<VectorXd> gradients(K);
+      std::vector<char> successes(K);
+
+      ThreadPool::TaskGroup group;
+      for (size_t ii = 0; ii < K; ii++) {
+        pool_->Schedule([&, ii]() {
+          if (gradient)
+            gradients[ii].resize(NumParameters());
+
+          successes[ii] = shards_[ii]->Objective(
+            parameters, &costs[ii], gradient ? gradients[ii].data() : NULL);
+        }, group);
+      }
+
+      pool_->Wait(group);
+
+      *cost = 0.0;
+      if (gradient)
+        std::fill(gradient, gradient + NumParameters(), 0.0);
+
+      for (size_t ii = 0; ii < K; ii++) {
+        if (!successes[ii])
+          return false;
+
+        *cost += costs[ii];
+        if (gradient) {
+          for (int jj = 0; jj < NumParameters(); jj++)
+            gradient[jj] += gradients[ii](jj);
+        }
+      }
+
+      // The barrier is on the shared parameters, so it is only added once.
+      TrainingLogLikelihood::AddBarrier(parameters, NumParameters(), cost,
+                                        gradient);
+      return true;
+    }
+
+    // Number of parameters in the problem.
+    int NumParameters() const { return shards_.front()->NumParameters(); }
+
+    // Number of shards.
+    size_t NumShards() const { return shards_.size(); }
+
+  private:
+    // Per-shard targets (which the shards point into), and likelihoods.
+    const std::vector<VectorXd> targets_;
+    std::vector< std::shared_ptr<TrainingLogLikelihood> > shards_;
+
+    // Thread pool for evaluating shards.
+    const ThreadPool::Ptr pool_;
+  }; // class CommitteeLogLikelihood
+
+  // Vecchia approximation to twice the negative log-likelihood of the
+  // training data. In a fixed ordering of the points, each target is
+  // conditioned only on the targets of a few earlier points (its
+  // conditioning set) rather than on all of them, so the likelihood factors
+  // into N univariate conditionals. The ii'th term is the exact objective of
+  // the targets of {c(ii), ii} minus that of {c(ii)}, which costs O(m^3) for
+  // m neighbors, or O(N m^3) in total. Terms are evaluated in parallel, in
+  // chunks on the given thread pool, each chunk with its own copy of the
+  // kernel.
+  class VecchiaLogLikelihood : public ceres::FirstOrderFunction {
+  public:
+    // Inputs: training points and targets (in order), conditioning sets
+    // (indices of earlier points), kernel, and noise.
+    // Optimization variables: kernel parameters.
+    VecchiaLogLikelihood(const PointSet& points, const VectorXd& targets,
+                         const std::vector< std::vector<size_t> >& conditioning,
+                         const Kernel& kernel, double noise,
+                         const ThreadPool::Ptr& pool)
+      : points_(points),
+        targets_(targets),
+        conditioning_(conditioning),
+        kernel_(kernel.Clone()),
+        noise_(noise),
+        pool_(pool) {
+      CHECK_NOTNULL(points.get());
+      CHECK_NOTNULL(pool.get());
+      CHECK_EQ(points->size(), targets.size());
+      CHECK_EQ(points->size(), conditioning.size());
+      CHECK_GT(noise, 0.0);
+    }
+
+    // Evaluate objective function and gradient, with a log barrier so that
+    // parameters don't go negative (as in TrainingLogLikelihood).
+    bool Evaluate(const double* const parameters,
+                  double* cost, double* gradient) const {
+      if (!Objective(parameters, cost, gradient))
+        return false;
+
+      const double kBarrierScaling = 1e3;
+      for (int ii = 0; ii < NumParameters(); ii++) {
+        *cost -= std::log(kBarrierScaling * parameters[ii]);
+        if (gradient)
+          gradient[ii] -= 1.0 / parameters[ii];
+      }
+
+      return true;
+    }
+
+    // Evaluate the objective and (optionally) its gradient, without the
+    // barrier. Returns false if any of the small covariances is singular.
+    bool Objective(const double* const parameters,
+                   double* cost, double* gradient) const {
+      const size_t N = points_->size();
+      const size_t kChunksPerThread = 4;
+      const size_t num_chunks =
+        std::min(N, kChunksPerThread * pool_->NumThreads());
+
+      std::vector<double> costs(num_chunks, 0.0);
+      std::vector<VectorXd> gradients(num_chunks);
+      std::vector<char> successes(num_chunks, true);
+
+      ThreadPool::TaskGroup group;
+      for (size_t ii = 0; ii < num_chunks; ii++) {
+        pool_->Schedule([&, ii]() {
+          const Kernel::Ptr kernel = kernel_->Clone();
+          for (int jj = 0; jj < NumParameters(); jj++)
+            kernel->Params()(jj) = parameters[jj];
+
+          if (gradient)
+            gradients[ii] = VectorXd::Zero(NumParameters());
+
+          std::vector<size_t> indices;
+          double term;
+          VectorXd term_gradient;
+          for (size_t jj = ii * N / num_chunks;
+               jj < (ii + 1) * N / num_chunks; jj++) {
+            // Conditional of point jj given its conditioning set.
+            indices = conditioning_[jj];
+            if (!indices.empty()) {
+              if (!Marginal(*kernel, indices, &term,
+                            gradient ? &term_gradient : NULL)) {
+                successes[ii] = false;
+                return;
+              }
+
+              costs[ii] -= term;
+              if (gradient)
+                gradients[ii] -= term_gradient;
+            }
+
+            indices.push_back(jj);
+            if (!Marginal(*kernel, indices, &term,
+                          gradient ? &term_gradient : NULL)) {
+              successes[ii] = false;
+              return;
+            }
+
+            costs[ii] += term;
+            if (gradient)
+              gradients[ii] += term_gradient;
+          }
+        }, group);
+      }
+
+      pool_->Wait(group);
+
+      *cost = 0.0;
+      if (gradient)
+        std::fill(gradient, gradient + NumParameters(), 0.0);
+
+      for (size_t ii = 0; ii < num_chunks; ii++) {
+        if (!successes[ii])
+          return false;
+
+        *cost += costs[ii];
+        if (gradient) {
+          for (int jj = 0; jj < NumParameters(); jj++)
+            gradient[jj] += gradients[ii](jj);
+        }
+      }
+
+      return true;
+    }
+
+    // Number of parameters in the problem.
+    int NumParameters() const {
+      return static_cast<int>(kernel_->ImmutableParams().size());
+    }
+
+  private:
+    // Twice the negative log marginal likelihood of the targets of the given
+    // points, and its gradient against the kernel parameters. For details
+    // please see R&W, pg. 113/4, eqs. 5.8/9.
+    bool Marginal(const Kernel& kernel, const std::vector<size_t>& indices,
+                  double* cost, VectorXd* gradient) const {
+      const size_t M = indices.size();
+      MatrixXd covariance(M, M);
+      VectorXd targets(M);
+      for (size_t ii = 0; ii < M; ii++) {
+        const VectorXd& x = points_->at(indices[ii]);
+        covariance(ii, ii) = 1.0 + noise_;
+        targets(ii) = targets_(indices[ii]);
+
+        for (size_t jj = 0; jj < ii; jj++) {
+          covariance(ii, jj) = kernel.Evaluate(x, points_->at(indices[jj]));
+          covariance(jj, ii) = covariance(ii, jj);
+        }
+      }
+
+      const Eigen::LLT<MatrixXd> llt(covariance);
+      if (llt.info() != Eigen::Success)
+        return false;
+
+      const VectorXd regressed = llt.solve(targets);
+      *cost = targets.dot(regressed);
+      for (size_t ii = 0; ii < M; ii++)
+        *cost += 2.0 * std::log(llt.matrixLLT()(ii, ii));
+
+      if (!gradient)
+        return true;
+
+      // Since the covariance is symmetric, trace(inv(K) dK) is just the sum
+      // of the elementwise product.
+      const MatrixXd inverse = llt.solve(MatrixXd::Identity(M, M));
+      gradient->resize(NumParameters());
+      MatrixXd dK(M, M);
+      for (int kk = 0; kk < NumParameters(); kk++) {
+        for (size_t ii = 0; ii < M; ii++) {
+          const VectorXd& x = points_->at(indices[ii]);
+          for (size_t jj = 0; jj <= ii; jj++) {
+            dK(ii, jj) = kernel.Partial(x, points_->at(indices[jj]), kk);
+            dK(jj, ii) = dK(ii, jj);
+          }
+        }
+
+        (*gradient)(kk) = inverse.cwiseProduct(dK).sum() -
+          regressed.dot(dK * regressed);
+      }
+
+      return true;
+    }
+
+    // Training points, targets, and conditioning sets.
+    const PointSet points_;
+    const VectorXd targets_;
+    const std::vector< std::vector<size_t> > conditioning_;
+
+    // Kernel (only its type is used; each chunk evaluates a copy), noise,
+    // and the thread pool for evaluating chunks.
+    const Kernel::Ptr kernel_;
+    const double noise_;
+    const ThreadPool::Ptr pool_;
+  }; // class VecchiaLogLikelihood
+
 } // namespace gp
 
 #endif
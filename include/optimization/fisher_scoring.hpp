@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the FisherScoring class, a second order minimizer for the training
+// log-likelihood of a GP. Each iteration solves a Levenberg-Marquardt damped
+// system with an information matrix standing in for the Hessian, formed from
+// the same quantities the gradient already needs: either the Fisher
+// information (the expected Hessian), or the average of the expected and
+// observed information, as in AI-REML. The Fisher information assumes the
+// targets are drawn from the GP, so when the fixed signal variance does not
+// match their scale it converges only linearly; the average information
+// adapts to the targets and usually converges in a handful of iterations.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_FISHER_SCORING_H
+#define GP_OPTIMIZATION_FISHER_SCORING_H
+
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+
+namespace gp {
+
+  class TrainingLogLikelihood;
+
+  class FisherScoring {
+  public:
+    // Which information matrix to use in place of the Hessian.
+    enum InformationType { FISHER_INFORMATION, AVERAGE_INFORMATION };
+
+    struct Options {
+      // Information matrix.
+      InformationType information;
+
+      // Maximum number of iterations (accepted or rejected steps).
+      size_t max_iterations;
+
+      // Stop when the largest gradient component is below this (absolute)
+      // tolerance, or when the relative decrease in the objective is.
+      double gradient_tolerance;
+      double function_tolerance;
+
+      // Initial damping, the factors by which it shrinks after an accepted
+      // step and grows after a rejected one, and the largest damping before
+      // giving up.
+      double initial_damping;
+      double damping_decrease;
+      double damping_increase;
+      double max_damping;
+
+      Options()
+        : information(AVERAGE_INFORMATION),
+          max_iterations(50),
+          gradient_tolerance(1e-6),
+          function_tolerance(1e-10),
+          initial_damping(1e-3),
+          damping_decrease(3.0),
+          damping_increase(4.0),
+          max_damping(1e10) {}
+    }; //\struct Options
+
+    struct Summary {
+      // Number of iterations, and how many steps were accepted.
+      size_t iterations;
+      size_t num_accepted;
+
+      // Objective before and after.
+      double initial_objective;
+      double final_objective;
+
+      // Did we meet one of the tolerances?
+      bool converged;
+
+      Summary()
+        : iterations(0),
+          num_accepted(0),
+          initial_objective(0.0),
+          final_objective(0.0),
+          converged(false) {}
+    }; //\struct Summary
+
+    // Minimize starting from 'parameters', which holds the solution on
+    // return. Steps which would make a parameter non-positive are rejected.
+    // Returns whether the solution is usable, i.e. the objective was finite at
+    // the start.
+    static bool Minimize(const TrainingLogLikelihood& likelihood,
+                         const Options& options, double* parameters,
+                         Summary* summary = NULL);
+
+  private:
+    // Evaluate objective, gradient, and the chosen information matrix.
+    static bool Information(const TrainingLogLikelihood& likelihood,
+                            const Options& options, const VectorXd& x,
+                            double& objective, VectorXd& gradient,
+                            MatrixXd& information);
+  }; //\class FisherScoring
+
+}  //\namespace gp
+
+#endif
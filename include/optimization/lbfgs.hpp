@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the Lbfgs class, a limited-memory BFGS minimizer for Ceres first
+// order functions whose state (curvature pairs and last parameters) persists
+// across calls. When the objective changes slightly between calls (e.g. a few
+// training points were added), restarting from the previous state usually
+// converges in a handful of iterations, where Ceres would start again from a
+// steepest descent step.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_LBFGS_H
+#define GP_OPTIMIZATION_LBFGS_H
+
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <deque>
+
+namespace ceres {
+  class FirstOrderFunction;
+} //\namespace ceres
+
+namespace gp {
+
+  // Optimizer state kept across calls.
+  struct LbfgsState {
+    // Curvature pairs, oldest first: s = x_{k+1} - x_k, y = g_{k+1} - g_k.
+    std::deque<VectorXd> s;
+    std::deque<VectorXd> y;
+
+    // Parameters at the end of the last solve. If the next solve starts
+    // anywhere else, the parameters were moved by other means and the
+    // curvature pairs are discarded.
+    VectorXd parameters;
+
+    // Statistics from the last solve.
+    size_t iterations;
+    size_t num_evaluations;
+
+    LbfgsState()
+      : iterations(0),
+        num_evaluations(0) {}
+
+    // Forget everything.
+    void Reset() {
+      s.clear();
+      y.clear();
+      parameters.resize(0);
+      iterations = 0;
+      num_evaluations = 0;
+    }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  }; //\struct LbfgsState
+
+  class Lbfgs {
+  public:
+    struct Options {
+      // Maximum number of iterations and line search steps per iteration.
+      size_t max_iterations;
+      size_t max_line_search_iterations;
+
+      // Maximum number of curvature pairs.
+      size_t max_rank;
+
+      // Stop when the largest gradient component is below this (absolute)
+      // tolerance, or when the relative decrease in the objective is.
+      double gradient_tolerance;
+      double function_tolerance;
+
+      Options()
+        : max_iterations(100),
+          max_line_search_iterations(50),
+          max_rank(15),
+          gradient_tolerance(1e-6),
+          function_tolerance(1e-8) {}
+    }; //\struct Options
+
+    // Minimize starting from 'parameters', which holds the solution on
+    // return. The state is used to warm start and updated for the next call;
+    // it is discarded if the starting parameters are not where the last call
+    // finished. Callers must also Reset it whenever the objective changes
+    // other than through its data (e.g. a new noise level). Returns whether
+    // the solution is usable, i.e. the objective was finite at the start.
+    static bool Minimize(const ceres::FirstOrderFunction& function,
+                         const Options& options, double* parameters,
+                         LbfgsState* state);
+
+  private:
+    // Apply the inverse Hessian approximation to 'direction' (in place)
+    // using the two-loop recursion.
+    static void ApplyInverseHessian(const LbfgsState& state,
+                                    VectorXd& direction);
+  }; //\class Lbfgs
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ParallelTargetFitter class, which fits the training targets of
+// a GP from minibatches supplied by any number of threads at once, in the
+// style of Hogwild. Every thread computes its minibatch gradient against a
+// shared, read-only model snapshot (kernel, training points, and Cholesky
+// factor), and adds its step into the shared targets one stripe at a time,
+// so threads only contend when they write the same stripe simultaneously.
+// The errors at batch points are computed from regressed targets inv(K) t,
+// which are refreshed from the current targets every so many updates by
+// whichever thread gets there first, without stopping the others.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_PARALLEL_TARGET_FITTER_H
+#define GP_OPTIMIZATION_PARALLEL_TARGET_FITTER_H
+
+#include "../process/model_snapshot.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gp {
+
+  class ParallelTargetFitter {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<ParallelTargetFitter> Ptr;
+    typedef std::shared_ptr<const ParallelTargetFitter> ConstPtr;
+
+    ~ParallelTargetFitter() {}
+
+    // Factory method. Fits against the given snapshot, starting from the
+    // given training targets (e.g. from GaussianProcess::ImmutableTargets).
+    // Regressed targets are refreshed every 'refresh_interval' updates, and
+    // the targets are split into (at most) 'num_stripes' stripes.
+    static Ptr Create(const ModelSnapshot::ConstPtr& snapshot,
+                      const VectorXd& targets,
+                      size_t refresh_interval = 8,
+                      size_t num_stripes = 64);
+
+    // Take a gradient step on the mean squared error at the given points, and
+    // return the mean squared error. Safe to call from any number of threads.
+    double Update(const std::vector<VectorXd>& points,
+                  const std::vector<double>& targets, double step_size);
+
+    // Copy out the current training targets (e.g. for
+    // GaussianProcess::SetTargets). Safe to call while other threads update,
+    // in which case the copy may contain some of their steps but not others.
+    void Targets(VectorXd& targets) const;
+
+    // Accessors.
+    size_t NumUpdates() const { return num_updates_.load(); }
+    size_t NumPoints() const { return snapshot_->NumPoints(); }
+
+  private:
+    ParallelTargetFitter(const ModelSnapshot::ConstPtr& snapshot,
+                         const VectorXd& targets,
+                         size_t refresh_interval, size_t num_stripes);
+
+    // Recompute the regressed targets from the current targets.
+    void Refresh();
+
+    // Read-only model to fit against.
+    const ModelSnapshot::ConstPtr snapshot_;
+
+    // Training targets, and one lock per stripe of 'stripe_size_' entries.
+    VectorXd targets_;
+    const size_t stripe_size_;
+    mutable std::vector<std::mutex> stripe_mutexes_;
+
+    // Most recently refreshed regressed targets, swapped atomically.
+    std::shared_ptr<const VectorXd> regressed_;
+
+    // Number of updates so far, how often to refresh, and a lock which keeps
+    // more than one thread from refreshing at a time.
+    std::atomic<size_t> num_updates_;
+    const size_t refresh_interval_;
+    std::mutex refresh_mutex_;
+  }; //\class ParallelTargetFitter
+
+}  //\namespace gp
+
+#endif
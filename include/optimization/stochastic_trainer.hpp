@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the StochasticTrainer class, which learns kernel hyperparameters
+// from minibatches of the training data. Each step estimates the gradient of
+// the training log-likelihood from a subset of B points, either drawn at
+// random or clustered around a random point, so it costs O(B^3) rather than
+// O(N^3). Parameters are updated in log space (which keeps them positive)
+// with SGD with momentum or Adam.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_STOCHASTIC_TRAINER_H
+#define GP_OPTIMIZATION_STOCHASTIC_TRAINER_H
+
+#include "../kernels/kernel.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <random>
+
+namespace gp {
+
+  class StochasticTrainer {
+  public:
+    // How to draw minibatches: uniformly at random without replacement, or
+    // as the nearest neighbors of a random training point. Clustered batches
+    // keep the short range correlations which determine short length scales.
+    enum Sampling { RANDOM_SAMPLING, CLUSTERED_SAMPLING };
+
+    // Update rule.
+    enum Method { SGD, ADAM };
+
+    struct Options {
+      Sampling sampling;
+      Method method;
+
+      // Minibatch size, and number of steps.
+      size_t batch_size;
+      size_t num_steps;
+
+      // Step size in log space, and momentum (SGD only).
+      double learning_rate;
+      double momentum;
+
+      // Adam decay rates and regularization.
+      double beta1;
+      double beta2;
+      double epsilon;
+
+      Options()
+        : sampling(RANDOM_SAMPLING),
+          method(ADAM),
+          batch_size(64),
+          num_steps(200),
+          learning_rate(0.05),
+          momentum(0.9),
+          beta1(0.9),
+          beta2(0.999),
+          epsilon(1e-8) {}
+    }; //\struct Options
+
+    struct Summary {
+      // Number of minibatches whose covariance could not be factored.
+      size_t num_failed_batches;
+
+      // Exponential moving average of the minibatch objective, scaled up to
+      // the full training set.
+      double objective;
+
+      Summary()
+        : num_failed_batches(0),
+          objective(0.0) {}
+    }; //\struct Summary
+
+    // Optimize the parameters of the given kernel against the given training
+    // data. Returns whether at least one minibatch was usable.
+    static bool Minimize(const Kernel::Ptr& kernel, double noise,
+                         const PointSet& points, const VectorXd& targets,
+                         const Options& options, Summary* summary = NULL);
+
+  private:
+    // Draw a minibatch of (distinct) indices.
+    static void Sample(const std::vector<VectorXd>& points,
+                       const Options& options,
+                       std::default_random_engine& rng,
+                       std::vector<size_t>& batch);
+  }; //\class StochasticTrainer
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the StreamingTargetFitter class, which fits the training targets
+// of a GP to a (possibly very large) regression dataset in closed form, in a
+// single pass. The GP mean at x is r(x)^T t, where r(x) = inv(K) k(x) is the
+// regressed cross covariance against the fixed training inputs, so the least
+// squares problem in the targets t is linear. Chunks of B samples are
+// accumulated into the normal equations
+//   (sum_i r(x_i) r(x_i)^T + ridge I) t = sum_i r(x_i) y_i,
+// with one multiple right hand side solve and one rank-B update per chunk.
+// (Accumulating in the targets rather than in inv(K) t keeps the system well
+// conditioned enough to solve.) Memory is O(N^2) regardless of the number of
+// samples.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_STREAMING_TARGET_FITTER_H
+#define GP_OPTIMIZATION_STREAMING_TARGET_FITTER_H
+
+#include "../kernels/kernel.hpp"
+#include "../utils/types.hpp"
+
+#include <Eigen/Cholesky>
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace gp {
+
+  class StreamingTargetFitter {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<StreamingTargetFitter> Ptr;
+    typedef std::shared_ptr<const StreamingTargetFitter> ConstPtr;
+
+    ~StreamingTargetFitter() {}
+
+    // Factory method. Takes a copy of the kernel and training points. If
+    // 'dimensions' is set, the training points only hold those dimensions of
+    // the inputs, and samples are projected onto them.
+    static Ptr Create(const Kernel& kernel, double noise,
+                      const std::vector<VectorXd>& points,
+                      const ConstDimensions& dimensions = nullptr);
+
+    // Accumulate a chunk of samples into the normal equations.
+    void Add(const std::vector<VectorXd>& points,
+             const std::vector<double>& targets);
+
+    // Solve the normal equations for the training targets, with a ridge
+    // penalty on their squared norm. Returns false if the system is singular,
+    // which can happen without a ridge penalty if there are too few samples.
+    // If 'mse' is set, it is filled with the mean squared error of the fit
+    // over all samples.
+    bool Solve(double ridge, VectorXd& targets, double* mse = NULL) const;
+
+    // Forget all samples.
+    void Reset();
+
+    // Accessors.
+    size_t NumSamples() const { return num_samples_; }
+    size_t NumPoints() const { return points_.size(); }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  private:
+    StreamingTargetFitter(const Kernel& kernel, double noise,
+                          const std::vector<VectorXd>& points,
+                          const ConstDimensions& dimensions);
+
+    // Kernel, training points, active dimensions, and covariance factor.
+    const Kernel::ConstPtr kernel_;
+    const std::vector<VectorXd> points_;
+    const ConstDimensions dimensions_;
+    Eigen::LLT<MatrixXd> llt_;
+
+    // Accumulated normal equations (lower triangle of the sum of r r^T, and
+    // the sum of r y), along with the sum of squared sample targets.
+    MatrixXd gram_;
+    VectorXd moment_;
+    double sum_squared_targets_;
+    size_t num_samples_;
+
+    // Cross covariance workspace.
+    MatrixXd cross_;
+  }; //\class StreamingTargetFitter
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the CommitteeGaussianProcess class, which randomly partitions the
+// training data into K shards, each an exact GaussianProcess, and combines
+// the shards' predictions. All shards share one kernel, whose parameters are
+// learned by maximizing the sum of the shards' training log-likelihoods.
+// Shards are built, factored, and evaluated in parallel on a thread pool, so
+// building takes O(N^3 / K^2) time per thread rather than O(N^3), and memory
+// drops from O(N^2) to O(N^2 / K). Predictions are combined with either the
+// robust Bayesian committee machine (rBCM) or the generalized product of
+// experts (gPoE), following Deisenroth and Ng, "Distributed Gaussian
+// Processes" (ICML 2015).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_COMMITTEE_GAUSSIAN_PROCESS_H
+#define GP_PROCESS_COMMITTEE_GAUSSIAN_PROCESS_H
+
+#include "../kernels/kernel.hpp"
+#include "../optimization/lbfgs.hpp"
+#include "../process/gaussian_process.hpp"
+#include "../utils/thread_pool.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace gp {
+
+  class CommitteeGaussianProcess {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<CommitteeGaussianProcess> Ptr;
+    typedef std::shared_ptr<const CommitteeGaussianProcess> ConstPtr;
+
+    // How to combine shard predictions. Both weight each shard's precision
+    // by beta_k. The rBCM uses beta_k = (log(prior variance) - log(shard
+    // variance)) / 2, the shard's reduction in entropy, and corrects for
+    // counting the prior K times, so shards far from the query fall back to
+    // the prior. The gPoE uses beta_k = 1 / K, which keeps the variance
+    // calibrated as K grows.
+    enum Aggregation { ROBUST_BCM, GENERALIZED_POE };
+
+    // Factory method. Randomly partitions the training data into
+    // 'num_shards' shards of (nearly) equal size, and builds them on a thread
+    // pool. By default uses one thread per hardware thread.
+    static Ptr Create(const Kernel::Ptr& kernel, double noise,
+                      const std::vector<VectorXd>& points,
+                      const VectorXd& targets, size_t num_shards,
+                      Aggregation aggregation = ROBUST_BCM,
+                      size_t num_threads = 0);
+
+    // Evaluate mean and variance at a point. Shards are evaluated in parallel
+    // when they are large enough to be worth scheduling.
+    void Evaluate(const VectorXd& x, double& mean, double& variance) const;
+
+    // Evaluate means and variances at a batch of points, with each shard
+    // evaluating the whole batch in parallel.
+    void Evaluate(const std::vector<VectorXd>& points,
+                  std::vector<double>& means,
+                  std::vector<double>& variances) const;
+
+    // Learn the shared kernel parameters by maximizing the sum of the
+    // shards' training log-likelihoods with L-BFGS (shards are evaluated in
+    // parallel), then refit all shards. If 'warm_start' is set, resumes from
+    // the state of the previous warm started call. Returns whether the
+    // solution is usable.
+    bool LearnHyperparams(bool warm_start = false);
+
+    // Set how shard predictions are combined.
+    void SetAggregation(Aggregation aggregation) { aggregation_ = aggregation; }
+
+    // Immutable accessors.
+    Aggregation GetAggregation() const { return aggregation_; }
+    size_t NumShards() const { return shards_.size(); }
+    const GaussianProcess& Shard(size_t ii) const { return *shards_.at(ii); }
+    const Kernel::ConstPtr ImmutableKernel() const { return kernel_; }
+    double Noise() const { return noise_; }
+    size_t NumPoints() const { return num_points_; }
+
+  private:
+    explicit CommitteeGaussianProcess(const Kernel::Ptr& kernel, double noise,
+                                      const std::vector<VectorXd>& points,
+                                      const VectorXd& targets,
+                                      size_t num_shards,
+                                      Aggregation aggregation,
+                                      size_t num_threads);
+
+    // Combine shard means and variances at one point.
+    double Combine(const VectorXd& means, const VectorXd& variances,
+                   double& variance) const;
+
+    // Kernel (shared by all shards), and noise variance.
+    const Kernel::Ptr kernel_;
+    const double noise_;
+
+    // Shards, and the total number of training points.
+    std::vector<GaussianProcess::Ptr> shards_;
+    size_t num_points_;
+
+    // How shard predictions are combined.
+    Aggregation aggregation_;
+
+    // Thread pool for building, training, and evaluating shards.
+    const ThreadPool::Ptr pool_;
+
+    // Optimizer state for warm started hyperparameter learning.
+    LbfgsState hyperparam_state_;
+  }; //\class CommitteeGaussianProcess
+
+}  //\namespace gp
+
+#endif
@@ -44,17 +44,90 @@
 #define GP_PROCESS_GAUSSIAN_PROCESS_H
 
 #include "../kernels/kernel.hpp"
+#include "../optimization/fisher_scoring.hpp"
+#include "../optimization/lbfgs.hpp"
+#include "../optimization/stochastic_trainer.hpp"
+#include "../optimization/streaming_target_fitter.hpp"
+#include "../process/model_snapshot.hpp"
+#include "../process/noise_sweep.hpp"
+#include "../process/posterior_sampler.hpp"
+#include "../utils/kd_tree.hpp"
+#include "../utils/prediction_cache.hpp"
+#include "../utils/thread_pool.hpp"
 #include "../utils/types.hpp"
 
 #include <Eigen/Cholesky>
 #include <glog/logging.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
 #include <vector>
 
+namespace ceres {
+  class IterationCallback;
+} //\namespace ceres
+
 namespace gp {
 
   class GaussianProcess {
   public:
-    ~GaussianProcess() {}
+    // Typedefs.
+    typedef std::shared_ptr<GaussianProcess> Ptr;
+    typedef std::shared_ptr<const GaussianProcess> ConstPtr;
+
+    // Update rule for UpdateTargets: plain gradient descent, gradient descent
+    // with (heavy ball) momentum, or Adam.
+    enum TargetUpdateMethod {
+      TARGET_GRADIENT_DESCENT, TARGET_MOMENTUM, TARGET_ADAM
+    };
+
+    struct TargetUpdateOptions {
+      TargetUpdateMethod method;
+
+      // Momentum (TARGET_MOMENTUM only).
+      double momentum;
+
+      // Adam decay rates and regularization.
+      double beta1;
+      double beta2;
+      double epsilon;
+
+      // Whether to form inv(K) explicitly (once per factorization, in O(N^3)
+      // time and O(N^2) memory) so that each update multiplies by it rather
+      // than solving against the Cholesky factor. Pays off when there are
+      // many updates between changes to the factorization.
+      bool cache_inverse;
+
+      TargetUpdateOptions()
+        : method(TARGET_GRADIENT_DESCENT),
+          momentum(0.9),
+          beta1(0.9),
+          beta2(0.999),
+          epsilon(1e-8),
+          cache_inverse(false) {}
+    }; //\struct TargetUpdateOptions
+
+    // Report from Compress.
+    struct CompressionSummary {
+      // Number of training points kept.
+      size_t num_points;
+
+      // Largest variance of the (noise free) function at a training point,
+      // given its values at the kept points.
+      double max_residual_variance;
+
+      // Root mean square and largest absolute difference between the
+      // compressed and full predictive means at the training points.
+      double rms_mean_error;
+      double max_mean_error;
+    }; //\struct CompressionSummary
+
+    ~GaussianProcess();
 
     // Constructors. By default picks 10% of the maximum number of points
     // randomly within the unit box [-1, 1]^d.
@@ -68,34 +141,243 @@ namespace gp {
                              const VectorXd& targets,
                              size_t max_points = 100);
 
-    // Evaluate mean and variance at a point.
+    // Evaluate mean and variance at a point. These read the live model, so
+    // they must not race with Add, UpdateTargets, or LearnHyperparams. Use
+    // Snapshot() to evaluate from other threads. Evaluate goes through the
+    // prediction cache, if one is set. Truncated predictions (see
+    // SetTruncation) are cached apart from the exact ones snapshots use.
     void Evaluate(const VectorXd& x, double& mean, double& variance) const;
     void EvaluateTrainingPoint(size_t ii, double& mean, double& variance) const;
 
+    // Evaluate as above, and bound the error due to truncation (see
+    // SetTruncation), which is zero when not truncating. Bypasses the
+    // prediction cache.
+    void Evaluate(const VectorXd& x, double& mean, double& variance,
+                  double& mean_error, double& variance_error) const;
+
+    // Evaluate mean and variance at a point, along with their gradients and
+    // optionally their Hessians with respect to the point. These reuse the
+    // cross covariance and solve of Evaluate, so the gradients take another
+    // O(N d) time and the Hessians O(N^2 d + N d^2). Requires a kernel with
+    // input gradients (see Kernel::SupportsInputGradient). Bypasses the
+    // prediction cache and truncation.
+    void EvaluateWithGradient(const VectorXd& x, double& mean,
+                              double& variance, VectorXd& mean_gradient,
+                              VectorXd& variance_gradient,
+                              MatrixXd* mean_hessian = NULL,
+                              MatrixXd* variance_hessian = NULL) const;
+
+    // Joint predictive mean and covariance at a batch of points, either full
+    // or as a low rank factor plus diagonal. See ModelSnapshot for details.
+    void EvaluateJoint(const std::vector<VectorXd>& points, VectorXd& mean,
+                       MatrixXd& covariance) const;
+    void EvaluateJoint(const std::vector<VectorXd>& points, size_t max_rank,
+                       double tolerance, VectorXd& mean, MatrixXd& factor,
+                       VectorXd& diagonal) const;
+
+    // Draw joint samples of the function from the posterior at the given
+    // points, one column per sample, from the current snapshot. Unless the
+    // options give a pool or a thread count, samples are drawn on a pool
+    // owned by the model (created on first use), so that sampling in a loop
+    // does not start new threads every time. Safe to call from several
+    // threads at once. Returns whether sampling succeeded. See
+    // PosteriorSampler for details.
+    bool Sample(const std::vector<VectorXd>& points, size_t num_samples,
+                MatrixXd& samples, const PosteriorSampler::Options& options =
+                PosteriorSampler::Options()) const;
+
+    // Grab the most recently published snapshot of the model. Snapshots are
+    // immutable, so any number of threads may evaluate them without locking
+    // while a writer updates the model. Writers are serialized internally.
+    ModelSnapshot::ConstPtr Snapshot() const {
+      return std::atomic_load(&snapshot_);
+    }
+
     // Add new point(s). Returns whether or not points were added (points will
-    // only be added until 'max_points' is reached).
+    // only be added until 'max_points' is reached, unless budgeted).
     bool Add(const VectorXd& x, double target);
     bool Add(const std::vector<VectorXd>& points, const VectorXd& targets);
 
+    // Once 'max_points' is reached, have Add swap each new point for the
+    // least informative stored point, if the new point is more informative.
+    // A point's informativeness is the expected squared error of predicting
+    // its target without it (predictive variance plus squared error for new
+    // points, and leave-one-out variance plus squared error for stored
+    // points). Each replacement updates the Cholesky factor with a rank-2
+    // update in O(N^2) rather than refactoring, and Add then returns whether
+    // the point(s) were stored. Replacements cancel an asynchronous relearn.
+    void SetBudgeted(bool budgeted);
+    size_t NumReplacements() const { return num_replacements_; }
+
+    // Truncate the cross covariance in Evaluate to the training points where
+    // the kernel is at least 'cutoff' (RBF kernels only). These are found
+    // with a k-d tree over the training points scaled by the length scales,
+    // which is rebuilt (in O(N log N)) whenever the points or kernel change,
+    // e.g. by Add or LearnHyperparams. For M nearby points, the mean then
+    // takes O(M) time, and the variance O(M^2) if the inverse covariance is
+    // cached (see TargetUpdateOptions) or otherwise one O(N^2) triangular
+    // solve. A cutoff of zero disables truncation. Returns whether
+    // truncation is enabled.
+    bool SetTruncation(double cutoff);
+    double TruncationCutoff() const { return truncation_cutoff_; }
+
+    // Adapt kernel hyperparameters online as points are added. Each Add takes
+    // a stochastic gradient step (in log space, normalized as in RMSProp) on
+    // the negative predictive log-likelihood of the new point(s) under the
+    // current model, reusing the cross covariance computed for insertion and
+    // the existing factorization. Steps accumulate until the total change in
+    // some log parameter exceeds 'refit_threshold', and only then is the
+    // kernel updated and the covariance refactored. A learning rate of zero
+    // disables adaptation (the default).
+    void SetOnlineAdaptation(double learning_rate, double refit_threshold);
+
     // Update the training targets in the direction of the gradient of the
     // mean squared error at the given points. Returns the mean squared error.
     // If 'finalize' is set, computes regressed targets - only set to false if
     // you are doing repeated updates, and be sure to set true on final update.
+    // The whole minibatch is handled at once: its cross covariance is built
+    // as one N x B block, and the errors and gradient take two matrix-vector
+    // products and two solves against the Cholesky factor, regardless of B.
     double UpdateTargets(const std::vector<VectorXd>& points,
                          const std::vector<double>& targets,
                          double step_size, bool finalize = true);
 
+    // Set the update rule for UpdateTargets. Resets the optimizer state.
+    void SetTargetUpdateOptions(const TargetUpdateOptions& options);
+
+    // Create a fitter which accumulates a regression dataset in chunks and
+    // solves for the training targets in closed form, against the current
+    // kernel and training points. Pass its solution to SetTargets. See
+    // StreamingTargetFitter for details.
+    StreamingTargetFitter::Ptr TargetFitter() const;
+
+    // Replace all training targets, and recompute the regressed targets.
+    void SetTargets(const VectorXd& targets);
+
+    // Recompute the covariance, Cholesky, and regressed targets after the
+    // kernel parameters were changed from outside, e.g. through a kernel
+    // shared with other models.
+    void RefitKernel();
+
     // Learn kernel hyperparameters by maximizing log-likelihood of the
-    // training data.
-    bool LearnHyperparams();
+    // training data. If 'warm_start' is set, L-BFGS resumes from the state
+    // (curvature pairs) left by the previous warm started call, and stops
+    // right away if the gradient on the current data is already small. This
+    // makes periodic relearning on streaming data take only a few iterations.
+    // Anything else which changes the kernel or noise discards the state.
+    bool LearnHyperparams(bool warm_start = false);
+
+    // Learn kernel hyperparameters from several initial guesses in parallel,
+    // since the log-likelihood is multimodal in the kernel parameters. The
+    // first run starts from the current parameters. The others start from a
+    // Latin hypercube sample of [min_param, max_param]^p in log space. Each
+    // run optimizes its own copy of the kernel. Runs stop early once their
+    // objective cannot plausibly catch up with the best one seen so far.
+    // The solution with the lowest objective is kept. By default uses one
+    // thread per hardware thread. Returns whether any run succeeded.
+    bool LearnHyperparamsMultiStart(size_t num_starts, double min_param,
+                                    double max_param, size_t num_threads = 0);
+
+    // Learn kernel hyperparameters with Fisher scoring, a damped second order
+    // method which usually needs far fewer likelihood evaluations (and hence
+    // factorizations) than L-BFGS. See FisherScoring for details.
+    bool LearnHyperparamsFisherScoring(
+      const FisherScoring::Options& options = FisherScoring::Options());
+
+    // Learn kernel hyperparameters from minibatches of the training data, for
+    // models too large to factor more than once. If 'polish' is set, finish
+    // with a (usually short) L-BFGS run on the full data. See
+    // StochasticTrainer for details.
+    bool LearnHyperparamsStochastic(
+      const StochasticTrainer::Options& options = StochasticTrainer::Options(),
+      bool polish = false);
+
+    // Prune input dimensions which an RBF kernel effectively ignores, i.e.
+    // whose length scale is at least 'tolerance' times the range of the
+    // training points in that dimension. The kernel parameters and stored
+    // training points are compacted to the remaining dimensions, and queries
+    // (to Evaluate, Add, UpdateTargets, and snapshots) keep taking points
+    // with all of the original dimensions, which are projected transparently.
+    // The model compacts a private copy of its kernel, so the caller's kernel
+    // (and any other model sharing it) keeps all of its dimensions. Cancels
+    // any outstanding asynchronous relearn. Returns the number of dimensions
+    // pruned.
+    size_t PruneDimensions(double tolerance = 100.0);
+
+    // Eigendecompose the noise free covariance of the current training data,
+    // so that the likelihood, regressed targets, and predictions can be
+    // evaluated cheaply at many noise levels. See NoiseSweep for details.
+    NoiseSweep::Ptr SweepNoise() const;
+
+    // Set the noise variance. This is a refit: the covariance is
+    // refactored (O(N^3)).
+    void SetNoise(double noise);
+
+    // Learn the noise variance in [min_noise, max_noise] by maximizing the
+    // log-likelihood of the training data with a NoiseSweep, and set it
+    // without refactoring: the regressed targets and predictions come from
+    // the sweep's eigendecomposition in O(N^2), and the Cholesky factor is
+    // only recomputed once something needs it (e.g. the next Add).
+    // Returns the chosen noise variance.
+    double LearnNoise(double min_noise, double max_noise,
+                      size_t num_samples = 100);
+
+    // Build a smaller model for deployment from a representative subset of
+    // the training points, chosen by a pivoted Cholesky factorization of the
+    // noise free covariance (see PivotedCholesky). Points are picked until
+    // the function variance at every training point, given its values at
+    // the picked points, is at most 'tolerance', or until 'max_points' have
+    // been picked. The subset's targets are then refit by least squares so
+    // that its predictive mean matches this model's at all of the training
+    // points. The compressed model is full (it holds exactly the subset) and
+    // takes unprojected queries like this one. Takes O(N r^2) time for r kept
+    // points. If 'summary' is set, it is filled with the achieved error.
+    Ptr Compress(double tolerance,
+                 size_t max_points = std::numeric_limits<size_t>::max(),
+                 CompressionSummary* summary = NULL) const;
+
+    // Learn kernel hyperparameters on a worker thread from a copy of the
+    // current training data, then rebuild the factorization (also on the
+    // worker) and atomically swap in the new model. The returned future (and
+    // the optional callback, which runs on the worker thread) report whether
+    // the new model was installed. The result is discarded if more than
+    // 'max_staleness' points are added while the optimization is running, or
+    // if anything else changes the kernel parameters or noise in the meantime
+    // (e.g. LearnHyperparams, RefitKernel, online adaptation, or SetNoise).
+    // Starting a new relearn cancels the previous one. The callback must not
+    // start or cancel a relearn itself.
+    std::future<bool> LearnHyperparamsAsync(
+      size_t max_staleness = 0,
+      const std::function<void(bool)>& callback = nullptr);
+
+    // Cancel an outstanding asynchronous relearn, and wait for it to stop.
+    void CancelLearnHyperparams();
+
+    // Set (or clear, with a null pointer) a cache for predictions from
+    // Evaluate and from snapshots. Cached entries are invalidated whenever
+    // the model version changes. The cache may be shared with other models,
+    // since each model keys its entries on its own identity.
+    void SetPredictionCache(const PredictionCache::Ptr& cache);
+
+    // Model version. Bumped by Add, UpdateTargets, SetTargets,
+    // LearnHyperparams, SetNoise, and SetTruncation.
+    uint64_t Version() const { return version_.load(); }
 
     // Immutable accessors.
     const MatrixXd& ImmutableCovariance() const { return covariance_; }
     const VectorXd& ImmutableRegressedTargets() const { return regressed_; }
     const VectorXd& ImmutableTargets() const { return targets_; }
     const ConstPointSet ImmutablePoints() const { return points_; }
-    const Eigen::LLT<MatrixXd>& ImmutableCholesky() const { return llt_; }
+    const Eigen::LLT<MatrixXd>& ImmutableCholesky() const {
+      return Cholesky();
+    }
+    const Kernel::ConstPtr ImmutableKernel() const { return kernel_; }
+    double Noise() const { return noise_; }
     size_t Dimension() const { return dimension_; }
+    const ConstDimensions& ActiveDimensions() const {
+      return active_dimensions_;
+    }
+    const LbfgsState& HyperparamState() const { return hyperparam_state_; }
 
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   private:
@@ -103,24 +385,178 @@ namespace gp {
     void Covariance();
     void CrossCovariance(const VectorXd& x, VectorXd& cross) const;
 
-    // Kernel.
-    const Kernel::Ptr kernel_;
+    // Cross covariance of a batch of (unprojected) query points against the
+    // training points, one column per query point.
+    void CrossCovariance(const std::vector<VectorXd>& points,
+                         MatrixXd& cross) const;
+    static void BuildCovariance(const Kernel& kernel, double noise,
+                                const std::vector<VectorXd>& points,
+                                MatrixXd& covariance);
+
+    // Optimize the parameters of the given kernel against the given training
+    // data. Returns whether the solution is usable. The optional callback runs
+    // after every iteration and may abort the optimization. If 'cost' is set,
+    // it is filled with the final objective.
+    static bool OptimizeHyperparams(const Kernel::Ptr& kernel, double noise,
+                                    const PointSet& points,
+                                    const VectorXd& targets,
+                                    ceres::IterationCallback* callback,
+                                    double* cost);
+
+    // Recompute covariance, Cholesky, and regressed targets after the kernel
+    // changes, then bump the hyperparameter generation and version and
+    // publish for readers.
+    void Refit();
+
+    // Body of the worker thread for LearnHyperparamsAsync, which started from
+    // the given hyperparameter generation.
+    void Relearn(const Kernel::Ptr& kernel, double noise,
+                 const PointSet& points, const VectorXd& targets,
+                 uint64_t generation, size_t max_staleness,
+                 const std::shared_ptr< std::promise<bool> >& promise,
+                 const std::function<void(bool)>& callback);
+
+    // Cancel and join the relearn thread. Caller must hold 'relearn_mutex_'.
+    void StopRelearn();
+
+    // Gradient of the summed negative predictive log-likelihood of a batch of
+    // new (projected) points under the current model against the kernel
+    // parameters, given their cross covariance against the factored training
+    // points, one column per new point.
+    void PredictiveGradient(const std::vector<VectorXd>& points,
+                            const VectorXd& targets, const MatrixXd& cross,
+                            VectorXd& gradient) const;
+
+    // Accumulate an online adaptation step. If the accumulated step crosses
+    // the threshold, applies it to the kernel and returns true, in which case
+    // the caller must Refit().
+    bool Adapt(const VectorXd& gradient);
+
+    // Replace the least informative stored point with the given (projected)
+    // one, if it is more informative. Caller must hold 'mutex_'.
+    bool Replace(const VectorXd& x, double target);
+
+    // Evaluate at a (projected) point from the training points found by the
+    // truncation index. Optionally bounds the error due to truncation.
+    void EvaluateTruncated(const VectorXd& x, double& mean, double& variance,
+                           double* mean_error, double* variance_error) const;
+
+    // Rebuild the truncation index. Caller must hold 'mutex_'.
+    void BuildTruncationIndex();
+
+    // Publish a new snapshot of the model for readers. Only the pieces which
+    // have been reset since the last snapshot are copied; the rest are shared.
+    void Publish();
+
+    // Set the noise variance learned by the given sweep of the current
+    // training data, without refactoring. Caller must hold 'mutex_'.
+    void InstallNoise(double noise, const NoiseSweep::ConstPtr& sweep);
+
+    // Cholesky factor of the covariance. While 'llt_' is stale, this is the
+    // published snapshot's factor, computed on first use.
+    const Eigen::LLT<MatrixXd>& Cholesky() const {
+      return noise_sweep_ ? snapshot_->ImmutableCholesky() : llt_;
+    }
+
+    // Bring 'llt_' up to date, if it is stale, from the published snapshot.
+    // Caller must hold 'mutex_'.
+    void ResolveCholesky();
+
+    // Kernel. Replaced by a private copy when pruning dimensions.
+    Kernel::Ptr kernel_;
 
     // Noise variance.
-    const double noise_;
+    double noise_;
 
     // Training points, targets, and regressed targets (inv(cov) * targets).
+    // The points only hold the active input dimensions, if any have been
+    // pruned, while 'dimension_' is the dimension of the inputs.
     const PointSet points_;
     size_t dimension_;
+    ConstDimensions active_dimensions_;
     VectorXd targets_;
     VectorXd regressed_;
 
     // Maximum number of points.
     const size_t max_points_;
 
-    // Covariance matrix, with Cholesky decomposition.
+    // Covariance matrix, with Cholesky decomposition. After LearnNoise, the
+    // decomposition is stale and the sweep stands in for it until a writer
+    // needs it (or refactors).
     MatrixXd covariance_;
     Eigen::LLT<MatrixXd> llt_;
+    NoiseSweep::ConstPtr noise_sweep_;
+
+    // Serializes writers.
+    std::mutex mutex_;
+
+    // Optimizer state for warm started hyperparameter learning, and a
+    // counter bumped whenever the kernel parameters or noise change, which
+    // tells an asynchronous relearn whether its result is stale.
+    LbfgsState hyperparam_state_;
+    uint64_t hyperparam_generation_;
+
+    // Model version, optional prediction cache, and the owners of this
+    // model's exact and truncated entries in it.
+    std::atomic<uint64_t> version_;
+    PredictionCache::Ptr cache_;
+    const uint64_t cache_owner_;
+    const uint64_t truncated_cache_owner_;
+
+    // Most recently published snapshot, and the immutable pieces it shares
+    // with older snapshots. Writers reset a piece whenever they change it.
+    ModelSnapshot::ConstPtr snapshot_;
+    Kernel::ConstPtr published_kernel_;
+    ConstPointSet published_points_;
+    ModelSnapshot::ConstCholesky published_llt_;
+
+    // Thread pool for Sample, created on first use, and its mutex.
+    mutable ThreadPool::Ptr sampling_pool_;
+    mutable std::mutex sampling_mutex_;
+
+    // Asynchronous relearning thread, its cancellation flag, and a mutex
+    // serializing calls which start or stop it.
+    std::thread relearn_thread_;
+    std::atomic<bool> relearn_cancelled_;
+    std::mutex relearn_mutex_;
+
+    // Online adaptation learning rate and refit threshold, the step in log
+    // parameters accumulated since the kernel was last updated, and the
+    // running mean square of the gradient which normalizes each step.
+    double adaptation_rate_;
+    double adaptation_threshold_;
+    VectorXd pending_log_step_;
+    VectorXd adaptation_second_moment_;
+    size_t num_adaptation_steps_;
+
+    // UpdateTargets rule and optimizer state (velocity or Adam moments, one
+    // entry per training point), and workspaces reused across calls.
+    TargetUpdateOptions target_options_;
+    VectorXd target_first_moment_;
+    VectorXd target_second_moment_;
+    size_t num_target_updates_;
+    MatrixXd update_cross_;
+    VectorXd update_errors_;
+    VectorXd update_gradient_;
+
+    // Explicit inverse covariance for UpdateTargets and budgeted replacement,
+    // and the published Cholesky factor it was computed from. Every change to
+    // the factorization publishes a new factor, which invalidates the inverse
+    // (unless the inverse was updated along with it).
+    MatrixXd inverse_;
+    ModelSnapshot::ConstCholesky inverse_source_;
+
+    // Whether to replace points once the budget is reached, and how many
+    // points have been replaced.
+    bool budgeted_;
+    size_t num_replacements_;
+
+    // Kernel value below which cross covariances are truncated (zero if not
+    // truncating), and a k-d tree over the training points divided by the
+    // length scales, in which they are within the corresponding radius.
+    double truncation_cutoff_;
+    double truncation_radius_;
+    KdTree::ConstPtr truncation_index_;
   }; //\class GaussianProcess
 
 }  //\namespace gp
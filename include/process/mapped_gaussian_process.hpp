@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the MappedGaussianProcess class, a read-only GP backed by a model
+// file which is memory-mapped rather than read. The file stores the kernel
+// type and parameters, noise, training points and targets, the Cholesky
+// factor of the covariance, and the regressed targets, each in its own
+// 64-byte aligned section, so that loading only has to validate the header
+// and the model's Eigen maps point straight into the mapping.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_MAPPED_GAUSSIAN_PROCESS_H
+#define GP_PROCESS_MAPPED_GAUSSIAN_PROCESS_H
+
+#include "../kernels/kernel.hpp"
+#include "../process/gaussian_process.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <memory>
+#include <string>
+
+namespace gp {
+
+  class MappedGaussianProcess {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<const MappedGaussianProcess> ConstPtr;
+
+    ~MappedGaussianProcess();
+
+    // Write a model file. The model must not be updated concurrently.
+    // Returns whether or not the file was written successfully.
+    static bool Save(const GaussianProcess& gp, const std::string& file);
+
+    // Map a model file. Returns a null pointer if the file cannot be mapped,
+    // was written on a machine with different endianness, has an unknown
+    // version or kernel, or is truncated. Verifying the checksum requires
+    // reading the whole file, so it is optional.
+    static ConstPtr Load(const std::string& file,
+                         bool verify_checksum = false);
+
+    // Evaluate mean and variance at a point.
+    void Evaluate(const VectorXd& x, double& mean, double& variance) const;
+
+    // Immutable accessors. Points are stored one per column.
+    const Kernel::ConstPtr& ImmutableKernel() const { return kernel_; }
+    const Eigen::Map<const MatrixXd>& ImmutablePoints() const {
+      return points_;
+    }
+    const Eigen::Map<const VectorXd>& ImmutableTargets() const {
+      return targets_;
+    }
+    const Eigen::Map<const VectorXd>& ImmutableRegressedTargets() const {
+      return regressed_;
+    }
+    const Eigen::Map<const MatrixXd>& ImmutableCholeskyL() const {
+      return cholesky_;
+    }
+    double Noise() const { return noise_; }
+    size_t Dimension() const { return points_.rows(); }
+    size_t NumPoints() const { return points_.cols(); }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  private:
+    MappedGaussianProcess(void* data, size_t size,
+                          const Kernel::ConstPtr& kernel, double noise,
+                          const double* points, const double* targets,
+                          const double* regressed, const double* cholesky,
+                          size_t dimension, size_t num_points);
+
+    // Mapped file.
+    void* const data_;
+    const size_t size_;
+
+    // Kernel and noise variance.
+    const Kernel::ConstPtr kernel_;
+    const double noise_;
+
+    // Views into the mapping: training points, targets, regressed targets,
+    // and the lower triangular Cholesky factor of the covariance.
+    const Eigen::Map<const MatrixXd> points_;
+    const Eigen::Map<const VectorXd> targets_;
+    const Eigen::Map<const VectorXd> regressed_;
+    const Eigen::Map<const MatrixXd> cholesky_;
+  }; //\class MappedGaussianProcess
+
+}  //\namespace gp
+
+#endif
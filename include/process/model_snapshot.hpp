@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ModelSnapshot class, an immutable copy of everything needed to
+// evaluate a GaussianProcess (kernel parameters, noise variance, training
+// points, Cholesky factor, and regressed targets). Snapshots are published
+// atomically by the GaussianProcess every time a writer changes the model, so
+// that any number of reader threads can evaluate without locking against a
+// consistent state.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_MODEL_SNAPSHOT_H
+#define GP_PROCESS_MODEL_SNAPSHOT_H
+
+#include "../kernels/kernel.hpp"
+#include "../process/noise_sweep.hpp"
+#include "../utils/prediction_cache.hpp"
+#include "../utils/types.hpp"
+
+#include <Eigen/Cholesky>
+#include <glog/logging.h>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+namespace gp {
+
+  class ModelSnapshot {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<const ModelSnapshot> ConstPtr;
+    typedef std::shared_ptr<const Eigen::LLT<MatrixXd> > ConstCholesky;
+
+    ~ModelSnapshot() {}
+
+    // Constructor. None of the arguments may be modified after construction,
+    // so the kernel must be a private copy and the points and factorization
+    // must not be shared with the writer. The prediction cache is optional,
+    // and entries are stored in it under the given owner (see
+    // PredictionCache::NewOwner).
+    // If the model has pruned input dimensions, the training points only
+    // hold the active ones and queries are projected onto them.
+    // Instead of a factorization, the model may hold the eigendecomposition
+    // of its noise free covariance from a NoiseSweep over the same points
+    // (see GaussianProcess::LearnNoise), with a null 'llt'. Predictions then
+    // work from the eigendecomposition, and the Cholesky factor is only
+    // computed if it is asked for.
+    explicit ModelSnapshot(const Kernel::ConstPtr& kernel, double noise,
+                           const ConstPointSet& points,
+                           const ConstCholesky& llt,
+                           const VectorXd& regressed,
+                           uint64_t version,
+                           const PredictionCache::Ptr& cache,
+                           uint64_t cache_owner,
+                           const ConstDimensions& dimensions = nullptr,
+                           const NoiseSweep::ConstPtr& sweep = nullptr);
+
+    // Evaluate mean and variance at a point, through the prediction cache
+    // if the model has one.
+    void Evaluate(const VectorXd& x, double& mean, double& variance) const;
+
+    // Joint predictive mean and covariance at a batch of points. The prior
+    // covariance of the points takes one batch kernel call, V = inv(L) K_X*
+    // one triangular solve, and the covariance K_** - V^T V one symmetric
+    // rank-N update, for O(N^2 M + N M^2) time in all.
+    void EvaluateJoint(const std::vector<VectorXd>& queries, VectorXd& mean,
+                       MatrixXd& covariance) const;
+
+    // Same, but approximate the covariance as factor * factor^T +
+    // diag(diagonal), for batches too large to hold the M x M covariance. The
+    // factor is a pivoted Cholesky factorization of the covariance (see
+    // PivotedCholesky) with at most 'max_rank' columns, stopping early once
+    // every residual variance is at most 'tolerance'. The diagonal holds the
+    // residual variances, so marginal variances are exact. Takes
+    // O(N^2 M + (N + r) M r) time for rank r.
+    void EvaluateJoint(const std::vector<VectorXd>& queries, size_t max_rank,
+                       double tolerance, VectorXd& mean, MatrixXd& factor,
+                       VectorXd& diagonal) const;
+
+    // Cross covariance of a batch of query points against the training
+    // points, one column per query point.
+    void CrossCovariance(const std::vector<VectorXd>& queries,
+                         MatrixXd& cross) const {
+      CrossCovariance(*kernel_, *points_, dimensions_, queries, cross);
+    }
+
+    // Cross covariance of a batch of query points, projected onto the given
+    // active dimensions, against the given training points. Uses the
+    // kernel's squared difference evaluation, if it has one.
+    static void CrossCovariance(const Kernel& kernel,
+                                const std::vector<VectorXd>& points,
+                                const ConstDimensions& dimensions,
+                                const std::vector<VectorXd>& queries,
+                                MatrixXd& cross);
+
+    // Project a point onto the given active dimensions. Returns 'x' itself if
+    // 'dimensions' is null, and otherwise fills and returns 'projected'.
+    static const VectorXd& Project(const ConstDimensions& dimensions,
+                                   const VectorXd& x, VectorXd& projected);
+
+    // Immutable accessors.
+    const Kernel::ConstPtr& ImmutableKernel() const { return kernel_; }
+    double Noise() const { return noise_; }
+    const ConstPointSet& ImmutablePoints() const { return points_; }
+    const Eigen::LLT<MatrixXd>& ImmutableCholesky() const {
+      return *SharedCholesky();
+    }
+    const VectorXd& ImmutableRegressedTargets() const { return regressed_; }
+    const ConstDimensions& ActiveDimensions() const { return dimensions_; }
+    size_t NumPoints() const { return points_->size(); }
+    uint64_t Version() const { return version_; }
+
+    // Cholesky factor, computed on first use if the snapshot was published
+    // with an eigendecomposition instead. Safe to call from any thread.
+    const ConstCholesky& SharedCholesky() const;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  private:
+    // Whiten the columns of 'b' in place (b <- inv(L) b, or the
+    // eigendecomposition's equivalent).
+    void Whiten(MatrixXd& b) const;
+
+    // Kernel (private copy), noise variance, training points, and
+    // factorization, or else the eigendecomposition and a flag guarding the
+    // factorization's lazy computation.
+    const Kernel::ConstPtr kernel_;
+    const double noise_;
+    const ConstPointSet points_;
+    mutable ConstCholesky llt_;
+    const NoiseSweep::ConstPtr sweep_;
+    mutable std::once_flag llt_flag_;
+
+    // Regressed targets (inv(cov) * targets), one entry per training point.
+    const VectorXd regressed_;
+
+    // Model version at publication, and optional prediction cache with the
+    // owner of the model's entries.
+    const uint64_t version_;
+    const PredictionCache::Ptr cache_;
+    const uint64_t cache_owner_;
+
+    // Active input dimensions, or null if none have been pruned.
+    const ConstDimensions dimensions_;
+  }; //\class ModelSnapshot
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the NearestNeighborGaussianProcess class, a Vecchia approximation
+// to a GP for large training sets. Points are put in maxmin order (each point
+// is the one farthest from all of the points before it), and each target is
+// conditioned only on the targets of its m nearest earlier points, which
+// gives a sparse inverse Cholesky factor of the covariance with m entries per
+// column. Neighbors are found with k-d trees, and the log-likelihood (see
+// VecchiaLogLikelihood) costs O(N m^3) and is evaluated in parallel.
+// Predictions condition on the m nearest training points of each query.
+// See Katzfuss and Guinness, "A General Framework for Vecchia Approximations
+// of Gaussian Processes" (Statistical Science, 2021).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_NEAREST_NEIGHBOR_GAUSSIAN_PROCESS_H
+#define GP_PROCESS_NEAREST_NEIGHBOR_GAUSSIAN_PROCESS_H
+
+#include "../kernels/kernel.hpp"
+#include "../optimization/lbfgs.hpp"
+#include "../utils/kd_tree.hpp"
+#include "../utils/thread_pool.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace gp {
+
+  class NearestNeighborGaussianProcess {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<NearestNeighborGaussianProcess> Ptr;
+    typedef std::shared_ptr<const NearestNeighborGaussianProcess> ConstPtr;
+
+    // Factory method. Orders the points, and finds the conditioning sets in
+    // parallel on a thread pool. By default uses one thread per hardware
+    // thread.
+    static Ptr Create(const Kernel::Ptr& kernel, double noise,
+                      const std::vector<VectorXd>& points,
+                      const VectorXd& targets, size_t num_neighbors = 30,
+                      size_t num_threads = 0);
+
+    // Evaluate mean and variance at a point, conditioning on its nearest
+    // training points. Costs O(m^3).
+    void Evaluate(const VectorXd& x, double& mean, double& variance) const;
+
+    // Twice the negative Vecchia log-likelihood of the training data (leaving
+    // off the constant), and optionally its gradient against the kernel
+    // parameters. Fails if some local covariance cannot be factored.
+    bool Objective(double* cost, VectorXd* gradient = NULL) const;
+
+    // Learn kernel hyperparameters by minimizing the objective with L-BFGS.
+    // If 'warm_start' is set, resumes from the state of the previous warm
+    // started call. Returns whether the solution is usable.
+    bool LearnHyperparams(bool warm_start = false);
+
+    // Indices (into the given points) of the points in maxmin order.
+    const std::vector<size_t>& Ordering() const { return ordering_; }
+
+    // Conditioning sets, as positions in the ordering, nearest first.
+    const std::vector< std::vector<size_t> >& ConditioningSets() const {
+      return conditioning_;
+    }
+
+    // Immutable accessors. Points and targets are in maxmin order.
+    const ConstPointSet ImmutablePoints() const { return points_; }
+    const VectorXd& ImmutableTargets() const { return targets_; }
+    const Kernel::ConstPtr ImmutableKernel() const { return kernel_; }
+    double Noise() const { return noise_; }
+    size_t NumPoints() const { return points_->size(); }
+    size_t NumNeighbors() const { return num_neighbors_; }
+
+  private:
+    explicit NearestNeighborGaussianProcess(
+      const Kernel::Ptr& kernel, double noise,
+      const std::vector<VectorXd>& points, const VectorXd& targets,
+      size_t num_neighbors, size_t num_threads);
+
+    // Compute the maxmin ordering, starting from the point nearest the
+    // centroid, using the given tree over the points.
+    static void MaxMinOrdering(const std::vector<VectorXd>& points,
+                               const KdTree& tree,
+                               std::vector<size_t>& ordering);
+
+    // Find the conditioning set of each (ordered) point.
+    void FindConditioningSets();
+
+    // Kernel, noise variance, and number of neighbors.
+    const Kernel::Ptr kernel_;
+    const double noise_;
+    const size_t num_neighbors_;
+
+    // Training points and targets in maxmin order, the ordering, conditioning
+    // sets, and a tree over the ordered points for predictions.
+    const PointSet points_;
+    VectorXd targets_;
+    std::vector<size_t> ordering_;
+    std::vector< std::vector<size_t> > conditioning_;
+    KdTree::ConstPtr tree_;
+
+    // Thread pool for finding neighbors and evaluating the likelihood.
+    const ThreadPool::Ptr pool_;
+
+    // Optimizer state for warm started hyperparameter learning.
+    LbfgsState hyperparam_state_;
+  }; //\class NearestNeighborGaussianProcess
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the NoiseSweep class, which evaluates a GP at many noise levels
+// from one symmetric eigendecomposition of the noise free covariance matrix
+// K0 = Q diag(lambda) Q^T. Since K0 + noise I = Q diag(lambda + noise) Q^T,
+// the training log-likelihood costs O(N) per noise level, and the regressed
+// targets and predictions cost O(N^2), rather than an O(N^3) factorization.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_NOISE_SWEEP_H
+#define GP_PROCESS_NOISE_SWEEP_H
+
+#include "../kernels/kernel.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace gp {
+
+  class NoiseSweep {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<NoiseSweep> Ptr;
+    typedef std::shared_ptr<const NoiseSweep> ConstPtr;
+
+    ~NoiseSweep() {}
+
+    // Factory method. Decomposes the noise free covariance of the given
+    // training data, and keeps a copy of the kernel and training points.
+    static Ptr Create(const Kernel& kernel,
+                      const std::vector<VectorXd>& points,
+                      const VectorXd& targets);
+
+    // Twice the negative log-likelihood of the training data at the given
+    // noise variance, leaving off the constant (as in TrainingLogLikelihood,
+    // without the log barrier on the kernel parameters).
+    double Objective(double noise) const;
+    void Objectives(const std::vector<double>& noises,
+                    std::vector<double>& objectives) const;
+
+    // Find the noise variance in [min_noise, max_noise] which minimizes the
+    // objective: search a grid of 'num_samples' noise levels evenly spaced in
+    // log space, then refine around the best one with a golden section
+    // search.
+    double Learn(double min_noise, double max_noise,
+                 size_t num_samples = 100) const;
+
+    // Regressed targets, inv(K0 + noise I) targets.
+    void RegressedTargets(double noise, VectorXd& regressed) const;
+
+    // Evaluate mean and variance at a point for the given noise variance.
+    void Evaluate(const VectorXd& x, double noise,
+                  double& mean, double& variance) const;
+
+    // Quadratic form b^T inv(K0 + noise I) b, in O(N^2).
+    double InverseQuadratic(double noise, const VectorXd& b) const;
+
+    // Whiten the columns of 'b' in place, b <- diag(lambda + noise)^(-1/2)
+    // Q^T b. Like inv(L) b for the Cholesky factor L of K0 + noise I, the
+    // whitened columns' inner products are the quadratic forms against
+    // inv(K0 + noise I). Takes O(N^2) time per column.
+    void Whiten(double noise, MatrixXd& b) const;
+
+    // Accessors.
+    const VectorXd& Eigenvalues() const { return eigenvalues_; }
+    const MatrixXd& Eigenvectors() const { return eigenvectors_; }
+    const Kernel::ConstPtr ImmutableKernel() const { return kernel_; }
+    size_t NumPoints() const { return eigenvalues_.size(); }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  private:
+    NoiseSweep(const Kernel& kernel, const std::vector<VectorXd>& points,
+               const VectorXd& targets);
+
+    // Kernel and training points, for predictions.
+    const Kernel::ConstPtr kernel_;
+    const std::vector<VectorXd> points_;
+
+    // Eigendecomposition of the noise free covariance, and the targets in
+    // the eigenbasis.
+    VectorXd eigenvalues_;
+    MatrixXd eigenvectors_;
+    VectorXd projected_targets_;
+  }; //\class NoiseSweep
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PosteriorSampler class, which draws joint samples of the
+// (noise free) function from the posterior of a GP model snapshot at a batch
+// of M query points. For moderate M, samples are drawn exactly: one multi
+// RHS triangular solve gives the M x M predictive covariance, whose Cholesky
+// factor colors standard normal draws, for O(N^2 M + N M^2 + M^3) time.
+// For large M, samples are drawn pathwise with Matheron's rule: a sample f of
+// the prior, approximated with random Fourier features, is updated by the
+// posterior mean of the residuals y - f(X) - noise, so the cost is linear in
+// M. See Wilson et al., "Efficiently Sampling Functions from Gaussian Process
+// Posteriors" (ICML 2020). Either way, samples are drawn in batches in
+// parallel on a thread pool, which may be shared with other samplers.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_POSTERIOR_SAMPLER_H
+#define GP_PROCESS_POSTERIOR_SAMPLER_H
+
+#include "../process/model_snapshot.hpp"
+#include "../utils/thread_pool.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace gp {
+
+  class PosteriorSampler {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<PosteriorSampler> Ptr;
+    typedef std::shared_ptr<const PosteriorSampler> ConstPtr;
+
+    // Sampling method. Pathwise sampling needs an RBF kernel, and falls back
+    // to exact sampling otherwise. Automatic sampling is exact for up to
+    // 'max_exact_points' query points, and pathwise beyond. Exact sampling
+    // falls back to pathwise sampling if the predictive covariance cannot be
+    // factored (see 'jitter').
+    enum Method { AUTOMATIC, EXACT, PATHWISE };
+
+    struct Options {
+      Method method;
+
+      // Largest number of query points to sample exactly (AUTOMATIC only).
+      size_t max_exact_points;
+
+      // Number of random Fourier features for the prior (PATHWISE only).
+      size_t num_features;
+
+      // Number of samples drawn by each task.
+      size_t batch_size;
+
+      // Thread pool to draw samples on. If null, the sampler creates its own
+      // with 'num_threads' threads, by default one per hardware thread.
+      ThreadPool::Ptr pool;
+      size_t num_threads;
+
+      // Smallest multiple of the identity added to the predictive covariance
+      // (EXACT only) before factoring. It is increased tenfold as needed, and
+      // exact sampling gives up once it reaches one.
+      double jitter;
+
+      Options()
+        : method(AUTOMATIC),
+          max_exact_points(1000),
+          num_features(2048),
+          batch_size(64),
+          num_threads(0),
+          jitter(1e-10) {}
+    }; //\struct Options
+
+    // Factory method.
+    static Ptr Create(const ModelSnapshot::ConstPtr& snapshot,
+                      const Options& options = Options());
+
+    // Draw joint samples at the given points, one column per sample. Safe to
+    // call from several threads at once. Returns false if sampling exactly
+    // failed and pathwise sampling is not available, in which case the
+    // samples are undefined.
+    bool Sample(const std::vector<VectorXd>& points, size_t num_samples,
+                MatrixXd& samples) const;
+
+    // Which method would be used for the given number of query points.
+    Method Choose(size_t num_points) const;
+
+    // Immutable accessors.
+    const ModelSnapshot::ConstPtr& Snapshot() const { return snapshot_; }
+    const Options& GetOptions() const { return options_; }
+
+  private:
+    explicit PosteriorSampler(const ModelSnapshot::ConstPtr& snapshot,
+                              const Options& options);
+
+    // Whether the kernel supports pathwise sampling.
+    bool SupportsPathwise() const;
+
+    // Draw samples exactly, or pathwise. Exact sampling returns false if the
+    // predictive covariance could not be factored.
+    bool SampleExact(const std::vector<VectorXd>& points, size_t num_samples,
+                     MatrixXd& samples) const;
+    void SamplePathwise(const std::vector<VectorXd>& points,
+                        size_t num_samples, MatrixXd& samples) const;
+
+    // Model, and its training targets (recovered from the factorization).
+    const ModelSnapshot::ConstPtr snapshot_;
+    VectorXd targets_;
+
+    const Options options_;
+
+    // Thread pool for drawing batches of samples, possibly shared.
+    const ThreadPool::Ptr pool_;
+  }; //\class PosteriorSampler
+
+}  //\namespace gp
+
+#endif
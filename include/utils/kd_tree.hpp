@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the KdTree class, a static k-d tree over a set of points for k
+// nearest neighbor and fixed radius queries. Each node splits its points at
+// the median of the dimension in which they are most spread out, down to
+// small leaves which are searched exhaustively. Queries skip any subtree on
+// the far side of a splitting plane which is farther than the current
+// search radius, so they take roughly O(log N) time in moderate dimension.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_UTILS_KD_TREE_H
+#define GP_UTILS_KD_TREE_H
+
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace gp {
+
+  class KdTree {
+  public:
+    // Typedefs. Filters take the index of a point and return whether it may
+    // be returned by a query.
+    typedef std::shared_ptr<KdTree> Ptr;
+    typedef std::shared_ptr<const KdTree> ConstPtr;
+    typedef std::function<bool(size_t)> Filter;
+
+    // Factory method. Builds a tree over the first 'num_points' of the given
+    // points (all of them, by default), which are copied. Queries return
+    // indices into the given points.
+    static Ptr Create(const std::vector<VectorXd>& points,
+                      size_t num_points = std::numeric_limits<size_t>::max());
+
+    // Find the (up to) k nearest points to x which pass the optional filter,
+    // nearest first.
+    void Nearest(const VectorXd& x, size_t k, std::vector<size_t>& neighbors,
+                 const Filter& filter = nullptr) const;
+
+    // Find all points within the given distance of x, in no particular order.
+    void Radius(const VectorXd& x, double radius,
+                std::vector<size_t>& neighbors) const;
+
+    // Number of points, and their dimension.
+    size_t NumPoints() const { return points_.cols(); }
+    size_t Dimension() const { return points_.rows(); }
+
+    // The ii'th point.
+    VectorXd Point(size_t ii) const { return points_.col(ii); }
+
+  private:
+    // Maximum number of points in a leaf.
+    static const size_t kLeafSize = 16;
+
+    // Node of the tree. Leaves hold the points in [begin, end) of the index
+    // permutation, and internal nodes split at 'split' along 'dimension'.
+    struct Node {
+      size_t begin;
+      size_t end;
+      size_t dimension;
+      double split;
+      int left;
+      int right;
+    }; //\struct Node
+
+    explicit KdTree(const std::vector<VectorXd>& points, size_t num_points);
+
+    // Recursively build the subtree over [begin, end) of the permutation,
+    // and return the index of its root.
+    int Build(size_t begin, size_t end);
+
+    // Recursive queries. The heap holds the best (squared distance, index)
+    // pairs found so far, with the worst on top.
+    void Nearest(int node, const VectorXd& x, size_t k, const Filter& filter,
+                 std::vector< std::pair<double, size_t> >& heap) const;
+    void Radius(int node, const VectorXd& x, double squared_radius,
+                std::vector<size_t>& neighbors) const;
+
+    // Points, one per column, and the permutation which nodes index into.
+    MatrixXd points_;
+    std::vector<size_t> order_;
+
+    // Nodes, with the root first.
+    std::vector<Node> nodes_;
+  }; //\class KdTree
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PivotedCholesky class, a greedy low rank factorization
+// A ~= L L^T of a symmetric positive semidefinite matrix, which only needs
+// the diagonal of A and the columns of A at the chosen pivots. Each step
+// pivots on the largest remaining diagonal entry of the residual A - L L^T,
+// so rank r costs O(N r^2) time and r column evaluations. The residual
+// diagonal bounds the error: the residual is itself positive semidefinite,
+// so each of its entries is at most the geometric mean of its two diagonal
+// entries. For a covariance matrix, the residual diagonal is the variance of
+// each variable given the pivots, so the pivots form a representative subset.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_UTILS_PIVOTED_CHOLESKY_H
+#define GP_UTILS_PIVOTED_CHOLESKY_H
+
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace gp {
+
+  class PivotedCholesky {
+  public:
+    // Typedefs. The column function fills the given vector with the ii'th
+    // column of the matrix.
+    typedef std::shared_ptr<PivotedCholesky> Ptr;
+    typedef std::shared_ptr<const PivotedCholesky> ConstPtr;
+    typedef std::function<void(size_t, VectorXd&)> ColumnFunction;
+
+    // Factory method. Pivots until the largest residual diagonal entry is at
+    // most 'tolerance', or until 'max_rank' pivots have been chosen.
+    static Ptr Create(const VectorXd& diagonal, const ColumnFunction& column,
+                      double tolerance, size_t max_rank);
+
+    // Chosen pivots, in order.
+    const std::vector<size_t>& Pivots() const { return pivots_; }
+
+    // N x r factor, with A ~= L L^T. Rows of L at the pivots form a lower
+    // triangular matrix (in pivot order), and the columns of A at the pivots
+    // are reproduced exactly.
+    const MatrixXd& Factor() const { return factor_; }
+
+    // Diagonal of the residual A - L L^T, and its largest entry and trace.
+    const VectorXd& ResidualDiagonal() const { return residual_; }
+    double MaxResidual() const { return residual_.maxCoeff(); }
+    double ResidualTrace() const { return residual_.sum(); }
+
+    size_t Rank() const { return pivots_.size(); }
+    size_t Size() const { return residual_.size(); }
+
+  private:
+    explicit PivotedCholesky(const VectorXd& diagonal,
+                             const ColumnFunction& column,
+                             double tolerance, size_t max_rank);
+
+    std::vector<size_t> pivots_;
+    MatrixXd factor_;
+    VectorXd residual_;
+  }; //\class PivotedCholesky
+
+}  //\namespace gp
+
+#endif
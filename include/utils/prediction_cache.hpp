@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PredictionCache class, a bounded-memory concurrent cache of GP
+// predictions keyed on a quantization of the query point. Points which fall
+// in the same cell of a grid with the given resolution share a prediction.
+// The cache is split into independently locked shards, each with its own LRU
+// eviction list. Entries are keyed on their owner (e.g. a model) as well as
+// the point, so that several models may share a cache, and every entry is
+// tagged with the owner's version it was computed at so that updating the
+// model invalidates it automatically.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_UTILS_PREDICTION_CACHE_H
+#define GP_UTILS_PREDICTION_CACHE_H
+
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace gp {
+
+  class PredictionCache {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<PredictionCache> Ptr;
+
+    ~PredictionCache() {}
+
+    // Factory method. 'capacity' is the maximum total number of entries.
+    static Ptr Create(double resolution, size_t capacity,
+                      size_t num_shards = 16);
+
+    // Identity for a new owner of cache entries. Owners never see each
+    // other's entries, and each counts its own versions.
+    static uint64_t NewOwner();
+
+    // Look up the given owner's prediction for the cell containing 'x',
+    // computed at the given version. Entries from older versions are dropped,
+    // and points which cannot be quantized (e.g. NaN or inf) always miss.
+    bool Lookup(const VectorXd& x, uint64_t owner, uint64_t version,
+                double& mean, double& variance);
+
+    // Insert a prediction for the cell containing 'x', unless the owner's
+    // entry for the cell is from a newer version or 'x' cannot be quantized.
+    void Insert(const VectorXd& x, uint64_t owner, uint64_t version,
+                double mean, double variance);
+
+    // Drop all entries and reset counters.
+    void Clear();
+
+    // Accessors.
+    size_t Hits() const { return hits_.load(); }
+    size_t Misses() const { return misses_.load(); }
+    size_t Size() const;
+    double Resolution() const { return resolution_; }
+
+  private:
+    PredictionCache(double resolution, size_t capacity, size_t num_shards);
+
+    // Owner, followed by the quantized query point.
+    typedef std::vector<int64_t> Key;
+    struct KeyHash {
+      size_t operator()(const Key& key) const;
+    }; //\struct KeyHash
+
+    // Cached prediction.
+    struct Entry {
+      Key key;
+      uint64_t version;
+      double mean;
+      double variance;
+    }; //\struct Entry
+
+    // Independently locked part of the cache. The most recently used entry
+    // is at the front of 'lru'.
+    struct Shard {
+      std::mutex mutex;
+      std::list<Entry> lru;
+      std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    }; //\struct Shard
+
+    // Quantize an owner's point and find its shard. Quantize fails if the
+    // point is not finite or too far out.
+    bool Quantize(const VectorXd& x, uint64_t owner, Key& key) const;
+    Shard& FindShard(const Key& key);
+
+    // Cell size, and maximum number of entries per shard.
+    const double resolution_;
+    const size_t shard_capacity_;
+
+    // Shards.
+    std::vector< std::unique_ptr<Shard> > shards_;
+
+    // Counters.
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+  }; //\class PredictionCache
+
+}  //\namespace gp
+
+#endif
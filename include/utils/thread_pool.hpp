@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ThreadPool class, a fixed set of worker threads which run
+// scheduled tasks in FIFO order. Tasks are scheduled in groups, each of which
+// is waited on independently, so that several callers can share one pool.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_UTILS_THREAD_POOL_H
+#define GP_UTILS_THREAD_POOL_H
+
+#include <glog/logging.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gp {
+
+  class ThreadPool {
+  public:
+    // Typedefs.
+    typedef std::shared_ptr<ThreadPool> Ptr;
+
+    // A set of tasks which are waited on together. Must be waited on before
+    // it is destroyed, and only used with one pool.
+    class TaskGroup {
+    public:
+      TaskGroup() : num_unfinished_(0) {}
+
+    private:
+      friend class ThreadPool;
+
+      // Number of tasks in the group which are pending or running, guarded
+      // by the pool's mutex.
+      size_t num_unfinished_;
+    }; //\class TaskGroup
+
+    // Finishes all scheduled tasks, then joins the workers.
+    ~ThreadPool();
+
+    // Factory method. By default uses one thread per hardware thread.
+    static Ptr Create(size_t num_threads = 0);
+
+    // Schedule a task in the given group to run on one of the workers.
+    void Schedule(const std::function<void()>& task, TaskGroup& group);
+
+    // Block until all tasks in the group have finished, without waiting for
+    // any other tasks. While waiting, runs the group's pending tasks on the
+    // calling thread, so that tasks may themselves wait on (nested) groups.
+    void Wait(TaskGroup& group);
+
+    // Number of worker threads.
+    size_t NumThreads() const { return workers_.size(); }
+
+  private:
+    explicit ThreadPool(size_t num_threads);
+
+    // Body of each worker thread.
+    void Work();
+
+    // A scheduled task, and the group it belongs to.
+    struct Task {
+      std::function<void()> function;
+      TaskGroup* group;
+    }; //\struct Task
+
+    // Run a task which has been taken off the queue, and mark it finished.
+    // Called with 'lock' held, which is released while the task runs.
+    void Run(const Task& task, std::unique_lock<std::mutex>& lock);
+
+    // Pending tasks.
+    std::deque<Task> tasks_;
+    bool stopping_;
+
+    // Guards the above and the groups' counters, and signals new tasks and
+    // finished groups.
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable group_finished_;
+
+    // Worker threads.
+    std::vector<std::thread> workers_;
+  }; //\class ThreadPool
+
+}  //\namespace gp
+
+#endif
@@ -61,6 +61,10 @@ typedef ::Eigen::VectorXd VectorXd;
 typedef std::shared_ptr< std::vector<VectorXd> > PointSet;
 typedef std::shared_ptr< const std::vector<VectorXd> > ConstPointSet;
 
+// Indices of the input dimensions a model uses, after pruning. Null if none
+// have been pruned.
+typedef std::shared_ptr< const std::vector<size_t> > ConstDimensions;
+
 }  //\namespace gp
 
 #endif
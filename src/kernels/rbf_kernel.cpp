@@ -89,5 +89,49 @@ namespace gp {
       params_.cwiseProduct(params_).cwiseProduct(params_));
   }
 
+  Kernel::Ptr RbfKernel::Clone() const {
+    Kernel::Ptr ptr(new RbfKernel(params_));
+    return ptr;
+  }
+
+  // Evaluation from precomputed squared differences: one weighted sum and
+  // one exp per pair, and one multiply per pair for each partial.
+  void RbfKernel::EvaluateSquaredDifferences(
+    const Eigen::Ref<const MatrixXd>& squared_differences,
+    VectorXd& values) const {
+    CHECK_EQ(squared_differences.cols(), params_.size());
+    const VectorXd weights = -0.5 * params_.cwiseAbs2().cwiseInverse();
+
+    values.noalias() = squared_differences * weights;
+    values = values.array().exp();
+  }
+
+  void RbfKernel::PartialSquaredDifferences(
+    const Eigen::Ref<const MatrixXd>& squared_differences,
+    const VectorXd& values, size_t ii, VectorXd& partials) const {
+    CHECK_LT(ii, params_.size());
+    CHECK_EQ(squared_differences.cols(), params_.size());
+    CHECK_EQ(squared_differences.rows(), values.size());
+
+    const double scaling = 1.0 / (params_(ii) * params_(ii) * params_(ii));
+    partials = scaling * values.cwiseProduct(squared_differences.col(ii));
+  }
+
+  // Gradient and Hessian with respect to the first argument.
+  void RbfKernel::InputGradient(const VectorXd& x, const VectorXd& y,
+                                double value, VectorXd& gradient) const {
+    CHECK_EQ(x.size(), params_.size());
+    gradient = -value * (x - y).cwiseQuotient(params_.cwiseAbs2());
+  }
+
+  void RbfKernel::InputHessian(const VectorXd& x, const VectorXd& y,
+                               double value, MatrixXd& hessian) const {
+    CHECK_EQ(x.size(), params_.size());
+    const VectorXd u = (x - y).cwiseQuotient(params_.cwiseAbs2());
+
+    hessian = value * u * u.transpose();
+    hessian.diagonal() -= value * params_.cwiseAbs2().cwiseInverse();
+  }
+
 
 }  //\namespace gp
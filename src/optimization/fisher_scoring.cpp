@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the FisherScoring class, a second order minimizer for the training
+// log-likelihood of a GP. Each iteration solves a Levenberg-Marquardt damped
+// system with an information matrix standing in for the Hessian, formed from
+// the same quantities the gradient already needs: either the Fisher
+// information (the expected Hessian), or the average of the expected and
+// observed information, as in AI-REML. The Fisher information assumes the
+// targets are drawn from the GP, so when the fixed signal variance does not
+// match their scale it converges only linearly; the average information
+// adapts to the targets and usually converges in a handful of iterations.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <optimization/fisher_scoring.hpp>
+#include <optimization/cost_functors.hpp>
+
+#include <Eigen/Cholesky>
+#include <math.h>
+
+namespace gp {
+
+  // Evaluate objective, gradient, and the chosen information matrix.
+  bool FisherScoring::Information(const TrainingLogLikelihood& likelihood,
+                                  const Options& options,
+                                  const VectorXd& x,
+                                  double& objective, VectorXd& gradient,
+                                  MatrixXd& information) {
+    if (options.information == FISHER_INFORMATION)
+      return likelihood.EvaluateFisher(x.data(), &objective, gradient.data(),
+                                       information);
+
+    return likelihood.EvaluateAverageInformation(
+      x.data(), &objective, gradient.data(), information);
+  }
+
+  // Minimize starting from 'parameters'.
+  bool FisherScoring::Minimize(const TrainingLogLikelihood& likelihood,
+                               const Options& options, double* parameters,
+                               Summary* summary) {
+    CHECK_NOTNULL(parameters);
+
+    Summary local_summary;
+    if (!summary)
+      summary = &local_summary;
+
+    *summary = Summary();
+
+    // Evaluate at the starting point.
+    const size_t kNumParameters = likelihood.NumParameters();
+    VectorXd x = Eigen::Map<const VectorXd>(parameters, kNumParameters);
+    VectorXd gradient(kNumParameters);
+    MatrixXd information;
+    double objective;
+
+    if (!Information(likelihood, options, x, objective, gradient, information)
+        || !std::isfinite(objective))
+      return false;
+
+    summary->initial_objective = objective;
+
+    double damping = options.initial_damping;
+    VectorXd candidate(kNumParameters);
+    MatrixXd damped(kNumParameters, kNumParameters);
+    for (size_t ii = 0; ii < options.max_iterations; ii++) {
+      if (gradient.lpNorm<Eigen::Infinity>() < options.gradient_tolerance) {
+        summary->converged = true;
+        break;
+      }
+
+      summary->iterations++;
+
+      // Solve the damped system. Scaling the damping by the diagonal makes the
+      // step invariant to the units of each parameter.
+      damped = information;
+      damped.diagonal() *= 1.0 + damping;
+      candidate = x - damped.ldlt().solve(gradient);
+
+      // Try the step. The candidate factorization is memoized, so accepting
+      // the step and then computing the information matrix does not refactor.
+      double candidate_objective;
+      if (candidate.minCoeff() > 0.0 &&
+          likelihood.Evaluate(candidate.data(), &candidate_objective, NULL) &&
+          std::isfinite(candidate_objective) &&
+          candidate_objective < objective) {
+        const double decrease = objective - candidate_objective;
+
+        x = candidate;
+        CHECK(Information(likelihood, options, x, objective, gradient,
+                          information));
+        summary->num_accepted++;
+        damping /= options.damping_decrease;
+
+        if (decrease < options.function_tolerance * std::abs(objective)) {
+          summary->converged = true;
+          break;
+        }
+      } else {
+        damping *= options.damping_increase;
+        if (damping > options.max_damping)
+          break;
+      }
+    }
+
+    summary->final_objective = objective;
+
+    for (size_t ii = 0; ii < kNumParameters; ii++)
+      parameters[ii] = x(ii);
+
+    return true;
+  }
+
+}  //\namespace gp
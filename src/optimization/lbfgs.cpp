@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the Lbfgs class, a limited-memory BFGS minimizer for Ceres first
+// order functions whose state (curvature pairs and last parameters) persists
+// across calls. When the objective changes slightly between calls (e.g. a few
+// training points were added), restarting from the previous state usually
+// converges in a handful of iterations, where Ceres would start again from a
+// steepest descent step.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <optimization/lbfgs.hpp>
+
+#include <ceres/ceres.h>
+#include <math.h>
+
+namespace gp {
+
+  // Minimize starting from 'parameters'.
+  bool Lbfgs::Minimize(const ceres::FirstOrderFunction& function,
+                       const Options& options, double* parameters,
+                       LbfgsState* state) {
+    CHECK_NOTNULL(parameters);
+    CHECK_NOTNULL(state);
+
+    // Curvature pairs only describe the objective near where the last call
+    // finished.
+    const size_t kNumParameters = function.NumParameters();
+    Eigen::Map<VectorXd> x(parameters, kNumParameters);
+    if (state->parameters.size() != kNumParameters ||
+        state->parameters != x)
+      state->Reset();
+
+    state->iterations = 0;
+    state->num_evaluations = 0;
+
+    // Evaluate at the starting point. The data may have changed since the
+    // last call, so the objective and gradient there must be recomputed.
+    VectorXd gradient(kNumParameters);
+    double objective;
+
+    state->num_evaluations++;
+    if (!function.Evaluate(x.data(), &objective, gradient.data()) ||
+        !std::isfinite(objective))
+      return false;
+
+    // Iterate until converged. If the gradient is already small enough on
+    // the new data, this does nothing.
+    VectorXd direction(kNumParameters);
+    VectorXd candidate(kNumParameters);
+    VectorXd candidate_gradient(kNumParameters);
+    for (size_t ii = 0; ii < options.max_iterations; ii++) {
+      if (gradient.cwiseAbs().maxCoeff() < options.gradient_tolerance)
+        break;
+
+      // Quasi-Newton direction, falling back on (normalized) steepest
+      // descent without curvature information, or if it does not give a
+      // descent direction.
+      direction = -gradient;
+      ApplyInverseHessian(*state, direction);
+
+      double slope = direction.dot(gradient);
+      if (state->s.empty() || slope >= 0.0) {
+        state->s.clear();
+        state->y.clear();
+        direction = -gradient / std::max(1.0, gradient.norm());
+        slope = direction.dot(gradient);
+      }
+
+      // Backtracking line search with the Armijo condition. Non-finite
+      // objectives (e.g. from leaving the domain) count as failures.
+      const double kArmijo = 1e-4;
+      double step = 1.0;
+      double candidate_objective = objective;
+      bool accepted = false;
+      for (size_t jj = 0; jj < options.max_line_search_iterations; jj++) {
+        candidate = x + step * direction;
+
+        state->num_evaluations++;
+        if (function.Evaluate(candidate.data(), &candidate_objective,
+                              candidate_gradient.data()) &&
+            std::isfinite(candidate_objective) &&
+            candidate_objective <= objective + kArmijo * step * slope) {
+          accepted = true;
+          break;
+        }
+
+        step *= 0.5;
+      }
+
+      if (!accepted)
+        break;
+
+      // Store the curvature pair if it keeps the approximation positive
+      // definite, dropping the oldest one if full.
+      const VectorXd s = candidate - x;
+      const VectorXd y = candidate_gradient - gradient;
+      if (s.dot(y) > 1e-12 * s.norm() * y.norm()) {
+        state->s.push_back(s);
+        state->y.push_back(y);
+
+        if (state->s.size() > options.max_rank) {
+          state->s.pop_front();
+          state->y.pop_front();
+        }
+      }
+
+      const double decrease = objective - candidate_objective;
+      x = candidate;
+      gradient = candidate_gradient;
+      objective = candidate_objective;
+      state->iterations++;
+
+      if (decrease <= options.function_tolerance * std::abs(objective))
+        break;
+    }
+
+    // Save the final point for the next call.
+    state->parameters = x;
+    return true;
+  }
+
+  // Two-loop recursion. With no curvature pairs this is the identity.
+  void Lbfgs::ApplyInverseHessian(const LbfgsState& state,
+                                  VectorXd& direction) {
+    const size_t kRank = state.s.size();
+    if (kRank == 0)
+      return;
+
+    std::vector<double> alpha(kRank);
+    for (size_t ii = kRank; ii-- > 0; ) {
+      alpha[ii] = state.s[ii].dot(direction) / state.s[ii].dot(state.y[ii]);
+      direction -= alpha[ii] * state.y[ii];
+    }
+
+    // Scale by the most recent curvature estimate.
+    direction *= state.s.back().dot(state.y.back()) /
+      state.y.back().squaredNorm();
+
+    for (size_t ii = 0; ii < kRank; ii++) {
+      const double beta =
+        state.y[ii].dot(direction) / state.s[ii].dot(state.y[ii]);
+      direction += (alpha[ii] - beta) * state.s[ii];
+    }
+  }
+
+}  //\namespace gp
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ParallelTargetFitter class, which fits the training targets of
+// a GP from minibatches supplied by any number of threads at once, in the
+// style of Hogwild. Every thread computes its minibatch gradient against a
+// shared, read-only model snapshot (kernel, training points, and Cholesky
+// factor), and adds its step into the shared targets one stripe at a time,
+// so threads only contend when they write the same stripe simultaneously.
+// The errors at batch points are computed from regressed targets inv(K) t,
+// which are refreshed from the current targets every so many updates by
+// whichever thread gets there first, without stopping the others.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <optimization/parallel_target_fitter.hpp>
+
+#include <algorithm>
+
+namespace gp {
+
+  // Factory method.
+  ParallelTargetFitter::Ptr ParallelTargetFitter::Create(
+    const ModelSnapshot::ConstPtr& snapshot, const VectorXd& targets,
+    size_t refresh_interval, size_t num_stripes) {
+    Ptr ptr(new ParallelTargetFitter(snapshot, targets, refresh_interval,
+                                     num_stripes));
+    return ptr;
+  }
+
+  // Constructor.
+  ParallelTargetFitter::ParallelTargetFitter(
+    const ModelSnapshot::ConstPtr& snapshot, const VectorXd& targets,
+    size_t refresh_interval, size_t num_stripes)
+    : snapshot_(snapshot),
+      targets_(targets.head(snapshot->NumPoints())),
+      stripe_size_((snapshot->NumPoints() + std::max<size_t>(num_stripes, 1)
+                    - 1) / std::max<size_t>(num_stripes, 1)),
+      stripe_mutexes_((stripe_size_ > 0) ?
+                      (snapshot->NumPoints() + stripe_size_ - 1) /
+                      stripe_size_ : 0),
+      num_updates_(0),
+      refresh_interval_(refresh_interval) {
+    CHECK_GE(snapshot_->NumPoints(), 1);
+    CHECK_GE(targets.size(), snapshot_->NumPoints());
+    CHECK_GE(refresh_interval_, 1);
+
+    Refresh();
+  }
+
+  // Take a gradient step on the mean squared error at the given points.
+  double ParallelTargetFitter::Update(const std::vector<VectorXd>& points,
+                                      const std::vector<double>& targets,
+                                      double step_size) {
+    CHECK_EQ(points.size(), targets.size());
+    CHECK_GE(points.size(), 1);
+    const size_t N = snapshot_->NumPoints();
+    const size_t B = points.size();
+
+    // Errors at the batch points, e = C^T inv(K) t - y, against the last
+    // refreshed regressed targets.
+    MatrixXd cross;
+    snapshot_->CrossCovariance(points, cross);
+
+    const std::shared_ptr<const VectorXd> regressed =
+      std::atomic_load(&regressed_);
+    VectorXd errors = cross.transpose() * (*regressed);
+    for (size_t jj = 0; jj < B; jj++)
+      errors(jj) -= targets[jj];
+
+    const double mse = errors.squaredNorm() / static_cast<double>(B);
+
+    // Step -(2 / B) step_size inv(K) C e, applied one stripe at a time.
+    VectorXd step = cross * errors;
+    snapshot_->ImmutableCholesky().solveInPlace(step);
+    step *= -2.0 * step_size / static_cast<double>(B);
+
+    for (size_t ii = 0; ii < stripe_mutexes_.size(); ii++) {
+      const size_t start = ii * stripe_size_;
+      const size_t size = std::min(stripe_size_, N - start);
+
+      std::lock_guard<std::mutex> lock(stripe_mutexes_[ii]);
+      targets_.segment(start, size) += step.segment(start, size);
+    }
+
+    // Maybe refresh, unless another thread already is.
+    if (++num_updates_ % refresh_interval_ == 0) {
+      std::unique_lock<std::mutex> lock(refresh_mutex_, std::try_to_lock);
+      if (lock.owns_lock())
+        Refresh();
+    }
+
+    return mse;
+  }
+
+  // Copy out the current training targets.
+  void ParallelTargetFitter::Targets(VectorXd& targets) const {
+    const size_t N = snapshot_->NumPoints();
+    targets.resize(N);
+
+    for (size_t ii = 0; ii < stripe_mutexes_.size(); ii++) {
+      const size_t start = ii * stripe_size_;
+      const size_t size = std::min(stripe_size_, N - start);
+
+      std::lock_guard<std::mutex> lock(stripe_mutexes_[ii]);
+      targets.segment(start, size) = targets_.segment(start, size);
+    }
+  }
+
+  // Recompute the regressed targets from the current targets.
+  void ParallelTargetFitter::Refresh() {
+    VectorXd* regressed = new VectorXd;
+    Targets(*regressed);
+    snapshot_->ImmutableCholesky().solveInPlace(*regressed);
+
+    std::atomic_store(&regressed_,
+                      std::shared_ptr<const VectorXd>(regressed));
+  }
+
+}  //\namespace gp
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the StochasticTrainer class, which learns kernel hyperparameters
+// from minibatches of the training data. Each step estimates the gradient of
+// the training log-likelihood from a subset of B points, either drawn at
+// random or clustered around a random point, so it costs O(B^3) rather than
+// O(N^3). Parameters are updated in log space (which keeps them positive)
+// with SGD with momentum or Adam.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <optimization/stochastic_trainer.hpp>
+#include <optimization/cost_functors.hpp>
+
+#include <algorithm>
+#include <math.h>
+#include <numeric>
+
+namespace gp {
+
+  // Optimize the parameters of the given kernel.
+  bool StochasticTrainer::Minimize(const Kernel::Ptr& kernel, double noise,
+                                   const PointSet& points,
+                                   const VectorXd& targets,
+                                   const Options& options, Summary* summary) {
+    CHECK_NOTNULL(kernel.get());
+    CHECK_NOTNULL(points.get());
+    CHECK_EQ(points->size(), targets.size());
+    CHECK_GE(options.batch_size, 1);
+
+    Summary local_summary;
+    if (!summary)
+      summary = &local_summary;
+
+    *summary = Summary();
+
+    // Random number generator.
+    std::random_device rd;
+    std::default_random_engine rng(rd());
+
+    // Optimize log parameters.
+    const size_t kNumParameters = kernel->ImmutableParams().size();
+    VectorXd log_parameters = kernel->ImmutableParams().array().log();
+    VectorXd parameters(kNumParameters);
+    VectorXd gradient(kNumParameters);
+    VectorXd first_moment = VectorXd::Zero(kNumParameters);
+    VectorXd second_moment = VectorXd::Zero(kNumParameters);
+
+    // Minibatch data. A functor with memoized factorizations and cached
+    // squared differences is cheap to set up for B points, so we create a
+    // new one for each minibatch.
+    const size_t N = points->size();
+    const size_t B = std::min(options.batch_size, N);
+    std::vector<size_t> batch;
+    VectorXd batch_targets(B);
+
+    const double kAveraging = 0.1;
+    size_t num_usable = 0;
+    for (size_t step = 0; step < options.num_steps; step++) {
+      Sample(*points, options, rng, batch);
+
+      const PointSet batch_points(new std::vector<VectorXd>);
+      for (size_t ii = 0; ii < B; ii++) {
+        batch_points->push_back(points->at(batch[ii]));
+        batch_targets(ii) = targets(batch[ii]);
+      }
+
+      // Estimate the objective and gradient per training point. The gradient
+      // against log parameters is the gradient against parameters, scaled.
+      const TrainingLogLikelihood likelihood(batch_points, &batch_targets,
+                                             kernel, noise);
+      parameters = log_parameters.array().exp();
+
+      double objective;
+      if (!likelihood.Evaluate(parameters.data(), &objective,
+                               gradient.data()) || !std::isfinite(objective)) {
+        summary->num_failed_batches++;
+        continue;
+      }
+
+      gradient = gradient.cwiseProduct(parameters) / B;
+
+      summary->objective = (num_usable == 0) ? N * objective / B :
+        (1.0 - kAveraging) * summary->objective +
+        kAveraging * N * objective / B;
+      num_usable++;
+
+      // Update.
+      if (options.method == SGD) {
+        first_moment = options.momentum * first_moment + gradient;
+        log_parameters -= options.learning_rate * first_moment;
+      } else {
+        first_moment = options.beta1 * first_moment +
+          (1.0 - options.beta1) * gradient;
+        second_moment = options.beta2 * second_moment +
+          (1.0 - options.beta2) * gradient.cwiseAbs2();
+
+        // Bias correction.
+        const double t = static_cast<double>(num_usable);
+        const double corrected_rate = options.learning_rate *
+          std::sqrt(1.0 - std::pow(options.beta2, t)) /
+          (1.0 - std::pow(options.beta1, t));
+
+        log_parameters -= corrected_rate * first_moment.cwiseQuotient(
+          (second_moment.cwiseSqrt().array() + options.epsilon).matrix());
+      }
+    }
+
+    // Store the parameters back in the kernel.
+    kernel->Reset(log_parameters.array().exp().matrix());
+    return num_usable > 0;
+  }
+
+  // Draw a minibatch of (distinct) indices.
+  void StochasticTrainer::Sample(const std::vector<VectorXd>& points,
+                                 const Options& options,
+                                 std::default_random_engine& rng,
+                                 std::vector<size_t>& batch) {
+    const size_t N = points.size();
+    const size_t B = std::min(options.batch_size, N);
+
+    batch.resize(N);
+    std::iota(batch.begin(), batch.end(), 0);
+
+    if (options.sampling == RANDOM_SAMPLING) {
+      // Partial Fisher-Yates shuffle.
+      for (size_t ii = 0; ii < B; ii++) {
+        std::uniform_int_distribution<size_t> unif(ii, N - 1);
+        std::swap(batch[ii], batch[unif(rng)]);
+      }
+    } else {
+      // Nearest neighbors of a random point (including itself).
+      std::uniform_int_distribution<size_t> unif(0, N - 1);
+      const VectorXd& center = points[unif(rng)];
+
+      std::vector<double> distances(N);
+      for (size_t ii = 0; ii < N; ii++)
+        distances[ii] = (points[ii] - center).squaredNorm();
+
+      std::nth_element(batch.begin(), batch.begin() + B - 1, batch.end(),
+                       [&distances](size_t ii, size_t jj) {
+                         return distances[ii] < distances[jj]; });
+    }
+
+    batch.resize(B);
+  }
+
+}  //\namespace gp
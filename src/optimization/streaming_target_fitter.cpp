@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the StreamingTargetFitter class, which fits the training targets
+// of a GP to a (possibly very large) regression dataset in closed form, in a
+// single pass. The GP mean at x is r(x)^T t, where r(x) = inv(K) k(x) is the
+// regressed cross covariance against the fixed training inputs, so the least
+// squares problem in the targets t is linear. Chunks of B samples are
+// accumulated into the normal equations
+//   (sum_i r(x_i) r(x_i)^T + ridge I) t = sum_i r(x_i) y_i,
+// with one multiple right hand side solve and one rank-B update per chunk.
+// (Accumulating in the targets rather than in inv(K) t keeps the system well
+// conditioned enough to solve.) Memory is O(N^2) regardless of the number of
+// samples.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <optimization/streaming_target_fitter.hpp>
+#include <process/model_snapshot.hpp>
+
+#include <algorithm>
+
+namespace gp {
+
+  // Factory method.
+  StreamingTargetFitter::Ptr StreamingTargetFitter::Create(
+    const Kernel& kernel, double noise, const std::vector<VectorXd>& points,
+    const ConstDimensions& dimensions) {
+    Ptr ptr(new StreamingTargetFitter(kernel, noise, points, dimensions));
+    return ptr;
+  }
+
+  // Constructor.
+  StreamingTargetFitter::StreamingTargetFitter(
+    const Kernel& kernel, double noise, const std::vector<VectorXd>& points,
+    const ConstDimensions& dimensions)
+    : kernel_(kernel.Clone()),
+      points_(points),
+      dimensions_(dimensions) {
+    CHECK_GT(noise, 0.0);
+    CHECK_GE(points_.size(), 1);
+
+    // Covariance, as in GaussianProcess.
+    const size_t N = points_.size();
+    MatrixXd covariance(N, N);
+    for (size_t ii = 0; ii < N; ii++) {
+      covariance(ii, ii) = 1.0 + noise;
+
+      for (size_t jj = 0; jj < ii; jj++) {
+        covariance(ii, jj) = kernel_->Evaluate(points_[ii], points_[jj]);
+        covariance(jj, ii) = covariance(ii, jj);
+      }
+    }
+
+    llt_.compute(covariance);
+    CHECK(llt_.info() == Eigen::Success);
+
+    Reset();
+  }
+
+  // Accumulate a chunk of samples into the normal equations.
+  void StreamingTargetFitter::Add(const std::vector<VectorXd>& points,
+                                  const std::vector<double>& targets) {
+    CHECK_EQ(points.size(), targets.size());
+    const size_t B = points.size();
+
+    // Cross covariance of the chunk, one column per sample.
+    ModelSnapshot::CrossCovariance(*kernel_, points_, dimensions_, points,
+                                   cross_);
+
+    // Regressed cross covariances, then a rank-B update of the Gram matrix
+    // and a matrix-vector product for the right hand side.
+    llt_.solveInPlace(cross_);
+
+    const Eigen::Map<const VectorXd> y(targets.data(), B);
+    gram_.selfadjointView<Eigen::Lower>().rankUpdate(cross_);
+    moment_.noalias() += cross_ * y;
+    sum_squared_targets_ += y.squaredNorm();
+    num_samples_ += B;
+  }
+
+  // Solve the normal equations for the training targets.
+  bool StreamingTargetFitter::Solve(double ridge, VectorXd& targets,
+                                    double* mse) const {
+    CHECK_GE(ridge, 0.0);
+
+    MatrixXd system = gram_.selfadjointView<Eigen::Lower>();
+    system.diagonal().array() += ridge;
+
+    const Eigen::LLT<MatrixXd> llt(system);
+    if (llt.info() != Eigen::Success)
+      return false;
+
+    targets = llt.solve(moment_);
+    if (!targets.allFinite())
+      return false;
+
+    // Sum of squared errors is y^T y - 2 t^T (sum r y) + t^T (sum r r^T) t.
+    if (mse) {
+      const double sum_squared_errors = sum_squared_targets_ -
+        2.0 * targets.dot(moment_) +
+        targets.dot(gram_.selfadjointView<Eigen::Lower>() * targets);
+      *mse = (num_samples_ > 0) ?
+        std::max(sum_squared_errors, 0.0) / num_samples_ : 0.0;
+    }
+
+    return true;
+  }
+
+  // Forget all samples.
+  void StreamingTargetFitter::Reset() {
+    gram_ = MatrixXd::Zero(points_.size(), points_.size());
+    moment_ = VectorXd::Zero(points_.size());
+    sum_squared_targets_ = 0.0;
+    num_samples_ = 0;
+  }
+
+}  //\namespace gp
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the CommitteeGaussianProcess class, which randomly partitions the
+// training data into K shards, each an exact GaussianProcess, and combines
+// the shards' predictions. All shards share one kernel, whose parameters are
+// learned by maximizing the sum of the shards' training log-likelihoods.
+// Shards are built, factored, and evaluated in parallel on a thread pool, so
+// building takes O(N^3 / K^2) time per thread rather than O(N^3), and memory
+// drops from O(N^2) to O(N^2 / K). Predictions are combined with either the
+// robust Bayesian committee machine (rBCM) or the generalized product of
+// experts (gPoE), following Deisenroth and Ng, "Distributed Gaussian
+// Processes" (ICML 2015).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/committee_gaussian_process.hpp>
+#include <optimization/cost_functors.hpp>
+
+#include <algorithm>
+#include <math.h>
+#include <numeric>
+#include <random>
+
+namespace gp {
+
+  // Variances are clamped to at least this, since roundoff can push the
+  // predictive variance of a shard to (or below) zero near its points.
+  static const double kMinVariance = 1e-12;
+
+  // Factory method.
+  CommitteeGaussianProcess::Ptr CommitteeGaussianProcess::Create(
+    const Kernel::Ptr& kernel, double noise,
+    const std::vector<VectorXd>& points, const VectorXd& targets,
+    size_t num_shards, Aggregation aggregation, size_t num_threads) {
+    Ptr ptr(new CommitteeGaussianProcess(kernel, noise, points, targets,
+                                         num_shards, aggregation,
+                                         num_threads));
+    return ptr;
+  }
+
+  // Constructor. Partitions the data and builds the shards in parallel.
+  CommitteeGaussianProcess::CommitteeGaussianProcess(
+    const Kernel::Ptr& kernel, double noise,
+    const std::vector<VectorXd>& points, const VectorXd& targets,
+    size_t num_shards, Aggregation aggregation, size_t num_threads)
+    : kernel_(kernel),
+      noise_(noise),
+      shards_(num_shards),
+      num_points_(points.size()),
+      aggregation_(aggregation),
+      pool_(ThreadPool::Create(num_threads)) {
+    CHECK_NOTNULL(kernel_.get());
+    CHECK_GE(num_shards, 1);
+    CHECK_GE(points.size(), num_shards);
+    CHECK_EQ(points.size(), targets.size());
+
+    // Random number generator.
+    std::random_device rd;
+    std::default_random_engine rng(rd());
+
+    // Deal a random permutation of the points into the shards.
+    std::vector<size_t> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    ThreadPool::TaskGroup group;
+    for (size_t ii = 0; ii < num_shards; ii++) {
+      pool_->Schedule([&, ii]() {
+        PointSet shard_points(new std::vector<VectorXd>);
+        std::vector<double> shard_targets;
+        for (size_t jj = ii; jj < order.size(); jj += num_shards) {
+          shard_points->push_back(points[order[jj]]);
+          shard_targets.push_back(targets(order[jj]));
+        }
+
+        shards_[ii].reset(new GaussianProcess(
+          kernel_, noise_, shard_points,
+          Eigen::Map<const VectorXd>(shard_targets.data(),
+                                     shard_targets.size()),
+          shard_points->size()));
+      }, group);
+    }
+
+    pool_->Wait(group);
+  }
+
+  // Evaluate mean and variance at a point. Each shard takes O(n^2) time for
+  // n points, so only hand shards to the pool when that outweighs the cost
+  // of scheduling, splitting them into one contiguous chunk per thread.
+  void CommitteeGaussianProcess::Evaluate(const VectorXd& x, double& mean,
+                                          double& variance) const {
+    const size_t kMinParallelShardSize = 256;
+    const size_t K = shards_.size();
+
+    VectorXd means(K);
+    VectorXd variances(K);
+    const size_t num_chunks = std::min(K, pool_->NumThreads());
+    if (num_chunks < 2 || NumPoints() < kMinParallelShardSize * K) {
+      for (size_t ii = 0; ii < K; ii++)
+        shards_[ii]->Evaluate(x, means(ii), variances(ii));
+    } else {
+      ThreadPool::TaskGroup group;
+      for (size_t ii = 0; ii < num_chunks; ii++) {
+        pool_->Schedule([&, ii]() {
+          for (size_t jj = ii * K / num_chunks;
+               jj < (ii + 1) * K / num_chunks; jj++)
+            shards_[jj]->Evaluate(x, means(jj), variances(jj));
+        }, group);
+      }
+
+      pool_->Wait(group);
+    }
+
+    mean = Combine(means, variances, variance);
+  }
+
+  // Evaluate means and variances at a batch of points.
+  void CommitteeGaussianProcess::Evaluate(const std::vector<VectorXd>& points,
+                                          std::vector<double>& means,
+                                          std::vector<double>& variances)
+    const {
+    const size_t K = shards_.size();
+
+    // One column per shard.
+    MatrixXd shard_means(points.size(), K);
+    MatrixXd shard_variances(points.size(), K);
+    ThreadPool::TaskGroup group;
+    for (size_t ii = 0; ii < K; ii++) {
+      pool_->Schedule([&, ii]() {
+        for (size_t jj = 0; jj < points.size(); jj++)
+          shards_[ii]->Evaluate(points[jj], shard_means(jj, ii),
+                                shard_variances(jj, ii));
+      }, group);
+    }
+
+    pool_->Wait(group);
+
+    means.resize(points.size());
+    variances.resize(points.size());
+    for (size_t jj = 0; jj < points.size(); jj++)
+      means[jj] = Combine(shard_means.row(jj).transpose(),
+                          shard_variances.row(jj).transpose(), variances[jj]);
+  }
+
+  // Learn the shared kernel parameters.
+  bool CommitteeGaussianProcess::LearnHyperparams(bool warm_start) {
+    if (!warm_start)
+      hyperparam_state_.Reset();
+
+    std::vector<PointSet> points;
+    std::vector<VectorXd> targets;
+    for (size_t ii = 0; ii < shards_.size(); ii++) {
+      const size_t N = shards_[ii]->ImmutablePoints()->size();
+      points.push_back(PointSet(
+        new std::vector<VectorXd>(*shards_[ii]->ImmutablePoints())));
+      targets.push_back(shards_[ii]->ImmutableTargets().head(N));
+    }
+
+    const CommitteeLogLikelihood likelihood(points, targets, *kernel_,
+                                            noise_, pool_);
+    VectorXd parameters = kernel_->ImmutableParams();
+    const bool success = Lbfgs::Minimize(likelihood, Lbfgs::Options(),
+                                         parameters.data(),
+                                         &hyperparam_state_);
+
+    // Refit all shards against the new (shared) kernel.
+    kernel_->Reset(parameters);
+    ThreadPool::TaskGroup group;
+    for (size_t ii = 0; ii < shards_.size(); ii++)
+      pool_->Schedule([this, ii]() { shards_[ii]->RefitKernel(); }, group);
+
+    pool_->Wait(group);
+    return success;
+  }
+
+  // Combine shard means and variances at one point. The prior variance of
+  // the (noise free) function is one.
+  double CommitteeGaussianProcess::Combine(const VectorXd& means,
+                                           const VectorXd& variances,
+                                           double& variance) const {
+    const size_t K = means.size();
+
+    double precision = 0.0;
+    double weighted_mean = 0.0;
+    double total_weight = 0.0;
+    for (size_t ii = 0; ii < K; ii++) {
+      const double shard_variance = std::max(variances(ii), kMinVariance);
+      const double weight = (aggregation_ == ROBUST_BCM) ?
+        -0.5 * std::log(std::min(shard_variance, 1.0)) : 1.0 / K;
+
+      precision += weight / shard_variance;
+      weighted_mean += weight * means(ii) / shard_variance;
+      total_weight += weight;
+    }
+
+    // The rBCM adds the prior precision back in, once in total.
+    if (aggregation_ == ROBUST_BCM)
+      precision += 1.0 - total_weight;
+
+    precision = std::max(precision, kMinVariance);
+    variance = 1.0 / precision;
+    return weighted_mean / precision;
+  }
+
+}  //\namespace gp
@@ -41,13 +41,111 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <process/gaussian_process.hpp>
+#include <kernels/rbf_kernel.hpp>
 #include <optimization/cost_functors.hpp>
 
+#include <utils/pivoted_cholesky.hpp>
+#include <utils/thread_pool.hpp>
+
+#include <Eigen/LU>
+#include <Eigen/QR>
 #include <ceres/ceres.h>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <numeric>
 #include <random>
 
 namespace gp {
 
+  namespace {
+    // Ceres callback which aborts the solve once cancellation is requested.
+    class CancellationCallback : public ceres::IterationCallback {
+    public:
+      explicit CancellationCallback(const std::atomic<bool>* cancelled)
+        : cancelled_(cancelled) {
+        CHECK_NOTNULL(cancelled);
+      }
+
+      ceres::CallbackReturnType operator()(
+        const ceres::IterationSummary& summary) {
+        return (cancelled_->load()) ?
+          ceres::SOLVER_ABORT : ceres::SOLVER_CONTINUE;
+      }
+
+    private:
+      const std::atomic<bool>* const cancelled_;
+    }; //\class CancellationCallback
+
+    // Lowest objective seen so far by any of a set of concurrent runs.
+    class SharedBestCost {
+    public:
+      SharedBestCost()
+        : cost_(std::numeric_limits<double>::infinity()) {}
+
+      // Record a new objective, and return the lowest one so far.
+      double Update(double cost) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cost_ = std::min(cost_, cost);
+        return cost_;
+      }
+
+    private:
+      std::mutex mutex_;
+      double cost_;
+    }; //\class SharedBestCost
+
+    // Ceres callback for one run of a multi-start optimization. It aborts
+    // the run once it is dominated, i.e. its objective is above the best one
+    // seen by any run by more than it could recover over the remaining
+    // iterations if it kept decreasing at its current rate.
+    class MultiStartCallback : public ceres::IterationCallback {
+    public:
+      MultiStartCallback(size_t max_iterations, size_t min_iterations,
+                         SharedBestCost* best)
+        : max_iterations_(max_iterations),
+          min_iterations_(min_iterations),
+          best_(best),
+          last_cost_(std::numeric_limits<double>::infinity()) {
+        CHECK_NOTNULL(best);
+      }
+
+      ceres::CallbackReturnType operator()(
+        const ceres::IterationSummary& summary) {
+        const double best = best_->Update(summary.cost);
+        const double decrease = last_cost_ - summary.cost;
+        last_cost_ = summary.cost;
+
+        if (summary.iteration < min_iterations_ ||
+            summary.iteration >= max_iterations_)
+          return ceres::SOLVER_CONTINUE;
+
+        const size_t remaining = max_iterations_ - summary.iteration;
+        return (summary.cost - best > remaining * decrease) ?
+          ceres::SOLVER_ABORT : ceres::SOLVER_CONTINUE;
+      }
+
+    private:
+      const size_t max_iterations_;
+      const size_t min_iterations_;
+      SharedBestCost* const best_;
+      double last_cost_;
+    }; //\class MultiStartCallback
+
+    // Maximum number of iterations when optimizing hyperparameters, and the
+    // number of iterations a multi-start run gets before it may be aborted.
+    const size_t kMaxHyperparamIterations = 100;
+    const size_t kMinMultiStartIterations = 3;
+
+    // Number of times the relearn thread will try to catch up with newly
+    // added points outside the lock before it factors while holding it.
+    const size_t kMaxRefactorAttempts = 3;
+  } //\namespace
+
+  GaussianProcess::~GaussianProcess() {
+    CancelLearnHyperparams();
+  }
+
   GaussianProcess::GaussianProcess(const Kernel::Ptr& kernel, double noise,
                                    size_t dimension, size_t max_points)
     : kernel_(kernel),
@@ -57,7 +155,20 @@ namespace gp {
       max_points_(max_points),
       targets_(max_points),
       regressed_(max_points),
-      covariance_(max_points, max_points) {
+      covariance_(max_points, max_points),
+      hyperparam_generation_(0),
+      version_(0),
+      cache_owner_(PredictionCache::NewOwner()),
+      truncated_cache_owner_(PredictionCache::NewOwner()),
+      relearn_cancelled_(false),
+      adaptation_rate_(0.0),
+      adaptation_threshold_(0.0),
+      num_adaptation_steps_(0),
+      num_target_updates_(0),
+      budgeted_(false),
+      num_replacements_(0),
+      truncation_cutoff_(0.0),
+      truncation_radius_(0.0) {
     CHECK_NOTNULL(kernel_.get());
     CHECK_GE(max_points_, 1);
     CHECK_GE(dimension_, 1);
@@ -94,6 +205,9 @@ namespace gp {
     // Compute regressed targets.
     regressed_.head(points_->size()) =
       llt_.solve(targets_.head(points_->size()));
+
+    // Publish for readers.
+    Publish();
   }
 
   GaussianProcess::GaussianProcess(const Kernel::Ptr& kernel, double noise,
@@ -105,7 +219,20 @@ namespace gp {
       max_points_(max_points),
       targets_(max_points),
       regressed_(max_points),
-      covariance_(max_points, max_points) {
+      covariance_(max_points, max_points),
+      hyperparam_generation_(0),
+      version_(0),
+      cache_owner_(PredictionCache::NewOwner()),
+      truncated_cache_owner_(PredictionCache::NewOwner()),
+      relearn_cancelled_(false),
+      adaptation_rate_(0.0),
+      adaptation_threshold_(0.0),
+      num_adaptation_steps_(0),
+      num_target_updates_(0),
+      budgeted_(false),
+      num_replacements_(0),
+      truncation_cutoff_(0.0),
+      truncation_radius_(0.0) {
     CHECK_NOTNULL(kernel_.get());
     CHECK_NOTNULL(points_.get());
     CHECK_GE(points_->size(), 1);
@@ -136,6 +263,9 @@ namespace gp {
     // Compute regressed targets.
     regressed_.head(points_->size()) =
       llt_.solve(targets_.head(points_->size()));
+
+    // Publish for readers.
+    Publish();
   }
 
   GaussianProcess::GaussianProcess(const Kernel::Ptr& kernel, double noise,
@@ -148,7 +278,20 @@ namespace gp {
       max_points_(max_points),
       targets_(max_points),
       regressed_(max_points),
-      covariance_(max_points, max_points) {
+      covariance_(max_points, max_points),
+      hyperparam_generation_(0),
+      version_(0),
+      cache_owner_(PredictionCache::NewOwner()),
+      truncated_cache_owner_(PredictionCache::NewOwner()),
+      relearn_cancelled_(false),
+      adaptation_rate_(0.0),
+      adaptation_threshold_(0.0),
+      num_adaptation_steps_(0),
+      num_target_updates_(0),
+      budgeted_(false),
+      num_replacements_(0),
+      truncation_cutoff_(0.0),
+      truncation_radius_(0.0) {
     CHECK_NOTNULL(kernel_.get());
     CHECK_GE(max_points_, 1);
     CHECK_GE(points_->size(), 1);
@@ -173,19 +316,253 @@ namespace gp {
     // Compute regressed targets.
     regressed_.head(points_->size()) =
       llt_.solve(targets_.head(points_->size()));
+
+    // Publish for readers.
+    Publish();
   }
 
   // Evaluate mean and variance at a point.
   void GaussianProcess::Evaluate(const VectorXd& x,
                                  double& mean, double& variance) const {
-    // Compute cross covariance.
-    VectorXd cross(points_->size());
-    cross.setZero();
-    CrossCovariance(x, cross);
+    // Truncated predictions are approximate, so they must not be served to
+    // snapshots as exact ones.
+    const uint64_t version = version_.load();
+    const uint64_t owner =
+      truncation_index_ ? truncated_cache_owner_ : cache_owner_;
+    if (cache_ && cache_->Lookup(x, owner, version, mean, variance))
+      return;
+
+    // Maybe only visit nearby training points.
+    VectorXd projected;
+    if (truncation_index_) {
+      EvaluateTruncated(ModelSnapshot::Project(active_dimensions_, x,
+                                               projected),
+                        mean, variance, NULL, NULL);
+    } else {
+      // Compute cross covariance.
+      VectorXd cross(points_->size());
+      cross.setZero();
+      CrossCovariance(ModelSnapshot::Project(active_dimensions_, x, projected),
+                      cross);
+
+      // Compute mean and variance.
+      mean = cross.dot(regressed_.head(points_->size()));
+      variance = 1.0 - (noise_sweep_ ?
+                        noise_sweep_->InverseQuadratic(noise_, cross) :
+                        cross.dot(llt_.solve(cross)));
+    }
 
-    // Compute mean and variance.
-    mean = cross.dot(regressed_.head(points_->size()));
-    variance = 1.0 - cross.dot(llt_.solve(cross));
+    if (cache_)
+      cache_->Insert(x, owner, version, mean, variance);
+  }
+
+  // Evaluate, bounding the error due to truncation.
+  void GaussianProcess::Evaluate(const VectorXd& x, double& mean,
+                                 double& variance, double& mean_error,
+                                 double& variance_error) const {
+    mean_error = 0.0;
+    variance_error = 0.0;
+
+    VectorXd projected;
+    if (truncation_index_) {
+      EvaluateTruncated(ModelSnapshot::Project(active_dimensions_, x,
+                                               projected),
+                        mean, variance, &mean_error, &variance_error);
+    } else {
+      VectorXd cross(points_->size());
+      CrossCovariance(ModelSnapshot::Project(active_dimensions_, x, projected),
+                      cross);
+
+      mean = cross.dot(regressed_.head(points_->size()));
+      variance = 1.0 - (noise_sweep_ ?
+                        noise_sweep_->InverseQuadratic(noise_, cross) :
+                        cross.dot(llt_.solve(cross)));
+    }
+  }
+
+  // Evaluate, with gradients and Hessians with respect to the point. With
+  // k the cross covariance, J its Jacobian, w = inv(K) k, and H_i the
+  // Hessian of k_i, the mean k^T alpha has gradient J^T alpha and Hessian
+  // sum_i alpha_i H_i, and the variance 1 - k^T w has gradient -2 J^T w and
+  // Hessian -2 (J^T inv(K) J + sum_i w_i H_i).
+  void GaussianProcess::EvaluateWithGradient(const VectorXd& x, double& mean,
+                                             double& variance,
+                                             VectorXd& mean_gradient,
+                                             VectorXd& variance_gradient,
+                                             MatrixXd* mean_hessian,
+                                             MatrixXd* variance_hessian)
+    const {
+    CHECK(kernel_->SupportsInputGradient());
+    CHECK_EQ(mean_hessian == NULL, variance_hessian == NULL);
+    const size_t N = points_->size();
+
+    VectorXd projected;
+    const VectorXd& point =
+      ModelSnapshot::Project(active_dimensions_, x, projected);
+    const size_t D = point.size();
+
+    VectorXd cross(N);
+    CrossCovariance(point, cross);
+
+    const VectorXd weights = Cholesky().solve(cross);
+    const VectorXd regressed = regressed_.head(N);
+    mean = cross.dot(regressed);
+    variance = 1.0 - cross.dot(weights);
+
+    // Gradients, in the active dimensions.
+    MatrixXd jacobian(N, D);
+    VectorXd gradient;
+    for (size_t ii = 0; ii < N; ii++) {
+      kernel_->InputGradient(point, points_->at(ii), cross(ii), gradient);
+      jacobian.row(ii) = gradient.transpose();
+    }
+
+    VectorXd active_mean_gradient = jacobian.transpose() * regressed;
+    VectorXd active_variance_gradient = -2.0 * jacobian.transpose() * weights;
+
+    // Hessians, in the active dimensions.
+    MatrixXd active_mean_hessian, active_variance_hessian;
+    if (mean_hessian) {
+      active_mean_hessian = MatrixXd::Zero(D, D);
+      active_variance_hessian = MatrixXd::Zero(D, D);
+
+      MatrixXd hessian;
+      for (size_t ii = 0; ii < N; ii++) {
+        kernel_->InputHessian(point, points_->at(ii), cross(ii), hessian);
+        active_mean_hessian += regressed(ii) * hessian;
+        active_variance_hessian += weights(ii) * hessian;
+      }
+
+      Cholesky().matrixL().solveInPlace(jacobian);
+      active_variance_hessian.noalias() += jacobian.transpose() * jacobian;
+      active_variance_hessian *= -2.0;
+    }
+
+    // Scatter into the full input space. Pruned dimensions have no effect.
+    if (!active_dimensions_) {
+      mean_gradient.swap(active_mean_gradient);
+      variance_gradient.swap(active_variance_gradient);
+      if (mean_hessian) {
+        mean_hessian->swap(active_mean_hessian);
+        variance_hessian->swap(active_variance_hessian);
+      }
+
+      return;
+    }
+
+    const std::vector<size_t>& dimensions = *active_dimensions_;
+    mean_gradient = VectorXd::Zero(x.size());
+    variance_gradient = VectorXd::Zero(x.size());
+    for (size_t ii = 0; ii < D; ii++) {
+      mean_gradient(dimensions[ii]) = active_mean_gradient(ii);
+      variance_gradient(dimensions[ii]) = active_variance_gradient(ii);
+    }
+
+    if (mean_hessian) {
+      *mean_hessian = MatrixXd::Zero(x.size(), x.size());
+      *variance_hessian = MatrixXd::Zero(x.size(), x.size());
+      for (size_t ii = 0; ii < D; ii++) {
+        for (size_t jj = 0; jj < D; jj++) {
+          (*mean_hessian)(dimensions[ii], dimensions[jj]) =
+            active_mean_hessian(ii, jj);
+          (*variance_hessian)(dimensions[ii], dimensions[jj]) =
+            active_variance_hessian(ii, jj);
+        }
+      }
+    }
+  }
+
+  // Evaluate from the training points found by the truncation index. Each
+  // dropped cross covariance is below the cutoff, so the mean is off by at
+  // most the cutoff times the sum of the dropped regressed targets' absolute
+  // values. Writing the dropped part of the cross covariance as e, the
+  // variance is off by 2 c^T inv(K) e + e^T inv(K) e, and since the largest
+  // eigenvalue of inv(K) is at most 1 / noise, this is at most
+  // (2 |c| |e| + |e|^2) / noise.
+  void GaussianProcess::EvaluateTruncated(const VectorXd& x, double& mean,
+                                          double& variance,
+                                          double* mean_error,
+                                          double* variance_error) const {
+    const size_t N = points_->size();
+    const VectorXd& lengths = kernel_->ImmutableParams();
+
+    std::vector<size_t> neighbors;
+    truncation_index_->Radius(x.cwiseQuotient(lengths), truncation_radius_,
+                              neighbors);
+    const size_t M = neighbors.size();
+
+    VectorXd cross(M);
+    mean = 0.0;
+    for (size_t ii = 0; ii < M; ii++) {
+      cross(ii) = kernel_->Evaluate(points_->at(neighbors[ii]), x);
+      mean += cross(ii) * regressed_(neighbors[ii]);
+    }
+
+    // Use the inverse covariance if it is up to date. Otherwise, the
+    // quadratic form is the squared norm of inv(L) c.
+    double quadratic = 0.0;
+    if (inverse_source_ && inverse_source_ == published_llt_) {
+      for (size_t ii = 0; ii < M; ii++) {
+        for (size_t jj = 0; jj < M; jj++)
+          quadratic += cross(ii) * cross(jj) *
+            inverse_(neighbors[ii], neighbors[jj]);
+      }
+    } else {
+      VectorXd dense = VectorXd::Zero(N);
+      for (size_t ii = 0; ii < M; ii++)
+        dense(neighbors[ii]) = cross(ii);
+
+      quadratic = Cholesky().matrixL().solve(dense).squaredNorm();
+    }
+
+    variance = 1.0 - quadratic;
+
+    if (mean_error) {
+      double dropped = regressed_.head(N).lpNorm<1>();
+      for (size_t ii = 0; ii < M; ii++)
+        dropped -= std::abs(regressed_(neighbors[ii]));
+
+      *mean_error = truncation_cutoff_ * std::max(dropped, 0.0);
+    }
+
+    if (variance_error) {
+      const double dropped = truncation_cutoff_ * std::sqrt(N - M);
+      *variance_error =
+        (2.0 * cross.norm() * dropped + dropped * dropped) / noise_;
+    }
+  }
+
+  // Draw joint samples from the posterior.
+  bool GaussianProcess::Sample(const std::vector<VectorXd>& points,
+                               size_t num_samples, MatrixXd& samples,
+                               const PosteriorSampler::Options& options)
+    const {
+    PosteriorSampler::Options shared = options;
+    if (!shared.pool && shared.num_threads == 0) {
+      std::lock_guard<std::mutex> lock(sampling_mutex_);
+      if (!sampling_pool_)
+        sampling_pool_ = ThreadPool::Create();
+
+      shared.pool = sampling_pool_;
+    }
+
+    return PosteriorSampler::Create(Snapshot(), shared)->Sample(
+      points, num_samples, samples);
+  }
+
+  // Joint predictive mean and covariance at a batch of points.
+  void GaussianProcess::EvaluateJoint(const std::vector<VectorXd>& points,
+                                      VectorXd& mean,
+                                      MatrixXd& covariance) const {
+    Snapshot()->EvaluateJoint(points, mean, covariance);
+  }
+
+  void GaussianProcess::EvaluateJoint(const std::vector<VectorXd>& points,
+                                      size_t max_rank, double tolerance,
+                                      VectorXd& mean, MatrixXd& factor,
+                                      VectorXd& diagonal) const {
+    Snapshot()->EvaluateJoint(points, max_rank, tolerance, mean, factor,
+                              diagonal);
   }
 
   // Evaluate at the ii'th training point.
@@ -199,17 +576,21 @@ namespace gp {
 
     // Compute mean and variance.
     mean = cross.dot(regressed_);
-    variance = 1.0 - cross.dot(llt_.solve(cross));
+    variance = 1.0 - cross.dot(Cholesky().solve(cross));
   }
 
   // Add new point(s). Returns whether or not points were added (points will
   // only be added until 'max_points' is reached).
-  bool GaussianProcess::Add(const VectorXd& x, double target) {
+  bool GaussianProcess::Add(const VectorXd& query, double target) {
+    CHECK_EQ(query.size(), dimension_);
+    std::lock_guard<std::mutex> lock(mutex_);
     const size_t N = points_->size();
 
-    if (N < max_points_) {
-      CHECK_EQ(x.size(), dimension_);
+    VectorXd projected;
+    const VectorXd& x =
+      ModelSnapshot::Project(active_dimensions_, query, projected);
 
+    if (N < max_points_) {
       // Add a row/column to the covariance matrix.
       for (size_t ii = 0; ii < N; ii++) {
         covariance_(ii, N) = kernel_->Evaluate(x, points_->at(ii));
@@ -218,17 +599,46 @@ namespace gp {
 
       covariance_(N, N) = 1.0 + noise_;
 
+      // Maybe take an online adaptation step, before the model changes.
+      bool refit = false;
+      if (adaptation_rate_ > 0.0 && N > 0) {
+        ResolveCholesky();
+
+        VectorXd gradient;
+        PredictiveGradient(std::vector<VectorXd>(1, x),
+                           VectorXd::Constant(1, target),
+                           covariance_.col(N).head(N), gradient);
+        refit = Adapt(gradient);
+      }
+
       // Add the new point/target.
       targets_(N) = target;
       points_->push_back(x);
+      published_points_.reset();
+
+      // If the kernel changed, recompute everything.
+      if (refit) {
+        Refit();
+        return true;
+      }
 
       // Recompute Cholesky decomposition and regressed targets.
       llt_.compute(covariance_.topLeftCorner(N + 1, N + 1));
+      noise_sweep_.reset();
       regressed_.head(N + 1) = llt_.solve(targets_.head(N + 1));
 
+      // Bump the version and publish for readers.
+      version_++;
+      published_llt_.reset();
+      Publish();
+
       return true;
     }
 
+    // Maybe replace a stored point.
+    if (budgeted_ && N > 0)
+      return Replace(x, target);
+
     return false;
   }
 
@@ -237,19 +647,29 @@ namespace gp {
   bool GaussianProcess::Add(const std::vector<VectorXd>& points,
                             const VectorXd& targets) {
     CHECK_EQ(points.size(), targets.size());
+    std::lock_guard<std::mutex> lock(mutex_);
     const bool has_room = points_->size() + points.size() <= max_points_;
 
+    // Online adaptation takes a single step for the whole batch, averaging
+    // the gradients for the new points under the model before the batch.
+    const size_t num_factored = points_->size();
+
     // Add points one at a time.
-    for (size_t ii = 0; ii < points.size(); ii++) {
+    VectorXd projected;
+    size_t ii = 0;
+    for (; ii < points.size(); ii++) {
       CHECK_EQ(points[ii].size(), dimension_);
       const size_t N = points_->size();
 
       if (N >= max_points_)
         break;
 
+      const VectorXd& x =
+        ModelSnapshot::Project(active_dimensions_, points[ii], projected);
+
       // Add a row/column to the covariance matrix.
       for (size_t jj = 0; jj < N; jj++) {
-        covariance_(jj, N) = kernel_->Evaluate(points[ii], points_->at(jj));
+        covariance_(jj, N) = kernel_->Evaluate(x, points_->at(jj));
         covariance_(N, jj) = covariance_(jj, N);
       }
 
@@ -257,16 +677,369 @@ namespace gp {
 
       // Add the new point/target.
       targets_(N) = targets(ii);
-      points_->push_back(points[ii]);
+      points_->push_back(x);
     }
 
-    // Recompute Cholesky decomposition and regressed targets.
-    llt_.compute(covariance_.topLeftCorner(points_->size(), points_->size()));
+    published_points_.reset();
+
+    // Average over the points actually added, reusing their cross covariance
+    // against the points factored before the batch.
+    VectorXd gradient;
+    if (adaptation_rate_ > 0.0 && num_factored > 0 && ii > 0) {
+      ResolveCholesky();
+      PredictiveGradient(
+        std::vector<VectorXd>(points_->begin() + num_factored,
+                              points_->end()),
+        targets_.segment(num_factored, ii),
+        covariance_.block(0, num_factored, num_factored, ii), gradient);
+    }
 
-    regressed_.head(points_->size()) =
-      llt_.solve(targets_.head(points_->size()));
+    if (gradient.size() > 0 &&
+        Adapt(gradient / static_cast<double>(ii))) {
+      // If the kernel changed, recompute everything.
+      Refit();
+    } else {
+      // Recompute Cholesky decomposition and regressed targets.
+      llt_.compute(
+        covariance_.topLeftCorner(points_->size(), points_->size()));
+      noise_sweep_.reset();
+
+      regressed_.head(points_->size()) =
+        llt_.solve(targets_.head(points_->size()));
+
+      // Bump the version and publish for readers.
+      version_++;
+      published_llt_.reset();
+      Publish();
+    }
+
+    // Points which did not fit may replace stored ones, in budgeted mode.
+    if (!budgeted_ || points_->empty())
+      return has_room;
+
+    bool stored_all = true;
+    for (; ii < points.size(); ii++) {
+      CHECK_EQ(points[ii].size(), dimension_);
+      const VectorXd& x =
+        ModelSnapshot::Project(active_dimensions_, points[ii], projected);
+      stored_all &= Replace(x, targets(ii));
+    }
+
+    return stored_all;
+  }
+
+  // Replace the least informative stored point, once the budget is reached.
+  void GaussianProcess::SetBudgeted(bool budgeted) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budgeted_ = budgeted;
+  }
+
+  // Replace the least informative stored point with a new one, if the new
+  // one is more informative. Informativeness is the expected squared error
+  // of predicting a point's target without it: for the new point, its
+  // predictive variance plus squared error under the current model, and for
+  // stored points, their leave-one-out variance 1 / Q_ii plus squared
+  // leave-one-out error (alpha_i / Q_ii)^2, where Q = inv(K).
+  bool GaussianProcess::Replace(const VectorXd& x, double target) {
+    ResolveCholesky();
+    const size_t N = points_->size();
+
+    // Predictive mean and variance of the new point.
+    VectorXd cross(N);
+    CrossCovariance(x, cross);
+
+    const VectorXd regressed_cross = llt_.solve(cross);
+    const double error = target - cross.dot(regressed_.head(N));
+    const double variance =
+      std::max(1.0 + noise_ - cross.dot(regressed_cross), noise_);
+
+    // Leave-one-out scores of the stored points, from the inverse covariance
+    // (formed once per factorization, then maintained across replacements).
+    if (!inverse_source_ || inverse_source_ != published_llt_) {
+      inverse_ = llt_.solve(MatrixXd::Identity(N, N));
+      inverse_source_ = published_llt_;
+    }
+
+    size_t replaced = 0;
+    double min_score = std::numeric_limits<double>::infinity();
+    for (size_t ii = 0; ii < N; ii++) {
+      const double loo_variance = 1.0 / inverse_(ii, ii);
+      const double loo_error = regressed_(ii) * loo_variance;
+      const double score = loo_variance + loo_error * loo_error;
+
+      if (score < min_score) {
+        min_score = score;
+        replaced = ii;
+      }
+    }
+
+    if (variance + error * error <= min_score)
+      return false;
+
+    // Maybe take an online adaptation step, before the model changes.
+    bool refit = false;
+    if (adaptation_rate_ > 0.0) {
+      VectorXd gradient;
+      PredictiveGradient(std::vector<VectorXd>(1, x),
+                         VectorXd::Constant(1, target), cross, gradient);
+      refit = Adapt(gradient);
+    }
+
+    // Swap in the new point. The covariance changes by e d^T + d e^T, where
+    // e is the replaced coordinate vector and d is the change in its column
+    // (zero on the diagonal).
+    VectorXd difference = cross - covariance_.col(replaced).head(N);
+    difference(replaced) = 0.0;
+
+    cross(replaced) = 1.0 + noise_;
+    covariance_.col(replaced).head(N) = cross;
+    covariance_.row(replaced).head(N) = cross.transpose();
+
+    points_->at(replaced) = x;
+    targets_(replaced) = target;
+    published_points_.reset();
+
+    if (target_first_moment_.size() > replaced) {
+      target_first_moment_(replaced) = 0.0;
+      target_second_moment_(replaced) = 0.0;
+    }
+
+    // Training data copied by an asynchronous relearn is now stale.
+    relearn_cancelled_ = true;
+    num_replacements_++;
+
+    if (refit) {
+      Refit();
+      return true;
+    }
+
+    // e d^T + d e^T = u u^T - w w^T, with u = (s e + d / s) / sqrt(2) and
+    // w = (s e - d / s) / sqrt(2) for any s. Pick s to balance the two terms.
+    // Both the factorization and the inverse (by Woodbury) are updated in
+    // O(N^2). Refactor periodically so that roundoff does not accumulate, or
+    // if the downdate fails.
+    const double scale = std::sqrt(std::max(difference.norm(), 1e-12));
+    MatrixXd updates(N, 2);
+    updates.col(0) = difference / scale;
+    updates.col(1) = -updates.col(0);
+    updates(replaced, 0) += scale;
+    updates(replaced, 1) += scale;
+    updates *= std::sqrt(0.5);
+
+    bool refactor = (num_replacements_ % max_points_ == 0);
+    if (!refactor) {
+      llt_.rankUpdate(updates.col(0), 1.0);
+      llt_.rankUpdate(updates.col(1), -1.0);
+      refactor = (llt_.info() != Eigen::Success);
+    }
+
+    if (refactor) {
+      llt_.compute(covariance_.topLeftCorner(N, N));
+      inverse_source_.reset();
+    } else {
+      // With C = diag(1, -1),
+      //   inv(K + U C U^T) = Q - Q U inv(inv(C) + U^T Q U) U^T Q.
+      const MatrixXd inverse_updates = inverse_ * updates;
+      Eigen::Matrix2d capacitance = updates.transpose() * inverse_updates;
+      capacitance(0, 0) += 1.0;
+      capacitance(1, 1) -= 1.0;
+      inverse_.noalias() -=
+        inverse_updates * capacitance.inverse() * inverse_updates.transpose();
+    }
+
+    regressed_.head(N) = llt_.solve(targets_.head(N));
+
+    // Bump the version and publish for readers. The inverse stays valid for
+    // the new factorization, unless it was refactored.
+    version_++;
+    published_llt_.reset();
+    Publish();
+
+    if (!refactor)
+      inverse_source_ = published_llt_;
+
+    return true;
+  }
+
+  // Truncate the cross covariance in Evaluate.
+  bool GaussianProcess::SetTruncation(double cutoff) {
+    CHECK_GE(cutoff, 0.0);
+    CHECK_LT(cutoff, 1.0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cutoff > 0.0 && !dynamic_cast<const RbfKernel*>(kernel_.get())) {
+      LOG(WARNING) << "Can only truncate the cross covariance of an RBF "
+                   << "kernel.";
+      return false;
+    }
+
+    // The kernel is at least the cutoff within this radius, in coordinates
+    // scaled by the length scales.
+    truncation_cutoff_ = cutoff;
+    truncation_radius_ = (cutoff > 0.0) ? std::sqrt(-2.0 * std::log(cutoff))
+      : 0.0;
+
+    truncation_index_.reset();
+    if (truncation_cutoff_ > 0.0)
+      BuildTruncationIndex();
+
+    // Evaluate now returns different predictions, so invalidate any cached
+    // ones.
+    version_++;
+    Publish();
+
+    return truncation_cutoff_ > 0.0;
+  }
+
+  // Rebuild the truncation index.
+  void GaussianProcess::BuildTruncationIndex() {
+    const size_t N = points_->size();
+    if (N == 0) {
+      truncation_index_.reset();
+      return;
+    }
+
+    const VectorXd& lengths = kernel_->ImmutableParams();
+    std::vector<VectorXd> scaled(N);
+    for (size_t ii = 0; ii < N; ii++)
+      scaled[ii] = points_->at(ii).cwiseQuotient(lengths);
+
+    truncation_index_ = KdTree::Create(scaled);
+  }
+
+  // Adapt kernel hyperparameters online as points are added.
+  void GaussianProcess::SetOnlineAdaptation(double learning_rate,
+                                            double refit_threshold) {
+    CHECK_GE(learning_rate, 0.0);
+    CHECK_GT(refit_threshold, 0.0);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    adaptation_rate_ = learning_rate;
+    adaptation_threshold_ = refit_threshold;
+    pending_log_step_ = VectorXd::Zero(kernel_->ImmutableParams().size());
+    adaptation_second_moment_ =
+      VectorXd::Zero(kernel_->ImmutableParams().size());
+    num_adaptation_steps_ = 0;
+  }
+
+  // Gradient of the summed negative predictive log-likelihood of a batch of
+  // new points. With cross covariance k, the predictive mean and variance of
+  // each are mu = k^T alpha and var = 1 + noise - k^T v, where
+  // alpha = inv(K) y and v = inv(K) k. Their derivatives are
+  //   dmu = dk^T alpha - v^T dK alpha,  dvar = -2 dk^T v + v^T dK v.
+  // The dk terms take O(N B) kernel gradients, like the cross covariance. The
+  // dK terms of the whole batch collapse into one weighted sum over pairs,
+  // sum_ij W_ij dK_ij, with W = V diag(a) V^T - (V b) alpha^T for per-point
+  // weights a, b, so they take one sweep over the stored pairs per batch
+  // rather than per point. If the kernel supports squared differences, the
+  // sweep reuses the kernel values in the stored covariance instead of
+  // evaluating kernel gradients. The diagonal of K is fixed at 1 + noise, so
+  // only off-diagonal pairs contribute.
+  void GaussianProcess::PredictiveGradient(const std::vector<VectorXd>& points,
+                                           const VectorXd& targets,
+                                           const MatrixXd& cross,
+                                           VectorXd& gradient) const {
+    const size_t N = cross.rows();
+    const size_t B = cross.cols();
+    const size_t kNumParameters = kernel_->ImmutableParams().size();
+    CHECK_EQ(points.size(), B);
+    CHECK_EQ(targets.size(), B);
+    const VectorXd alpha = regressed_.head(N);
+
+    // Predictive means and variances, and the weights of dvar and dmu in the
+    // negative log-likelihood 0.5 log(var) + 0.5 error^2 / var.
+    const MatrixXd v = llt_.solve(cross);
+    VectorXd variance_weights(B);
+    VectorXd mean_weights(B);
+    for (size_t ii = 0; ii < B; ii++) {
+      const double variance =
+        std::max(1.0 + noise_ - cross.col(ii).dot(v.col(ii)), noise_);
+      const double error = targets(ii) - cross.col(ii).dot(alpha);
+
+      variance_weights(ii) =
+        0.5 / variance - 0.5 * error * error / (variance * variance);
+      mean_weights(ii) = -error / variance;
+    }
+
+    // Cross covariance terms.
+    gradient = VectorXd::Zero(kNumParameters);
+    VectorXd partials(kNumParameters);
+    for (size_t ii = 0; ii < B; ii++) {
+      for (size_t jj = 0; jj < N; jj++) {
+        kernel_->Gradient(points[ii], points_->at(jj), partials);
+        gradient += (mean_weights(ii) * alpha(jj) -
+                     2.0 * variance_weights(ii) * v(jj, ii)) * partials;
+      }
+    }
+
+    // Covariance terms, with symmetrized weights. Off-diagonal pairs count
+    // twice.
+    const VectorXd weighted_v = v * mean_weights;
+    MatrixXd weights = v * variance_weights.asDiagonal() * v.transpose();
+    weights -= 0.5 * (weighted_v * alpha.transpose() +
+                      alpha * weighted_v.transpose());
+
+    if (!kernel_->SupportsSquaredDifferences()) {
+      for (size_t ii = 1; ii < N; ii++) {
+        for (size_t jj = 0; jj < ii; jj++) {
+          kernel_->Gradient(points_->at(ii), points_->at(jj), partials);
+          gradient += 2.0 * weights(jj, ii) * partials;
+        }
+      }
+
+      return;
+    }
+
+    const size_t D = points_->at(0).size();
+    MatrixXd rows(N, D);
+    for (size_t ii = 0; ii < N; ii++)
+      rows.row(ii) = points_->at(ii).transpose();
+
+    MatrixXd squared_differences;
+    VectorXd pair_partials;
+    for (size_t ii = 1; ii < N; ii++) {
+      squared_differences =
+        (rows.topRows(ii).rowwise() - rows.row(ii)).cwiseAbs2();
+      const VectorXd values = covariance_.col(ii).head(ii);
+
+      for (size_t kk = 0; kk < kNumParameters; kk++) {
+        kernel_->PartialSquaredDifferences(squared_differences, values, kk,
+                                           pair_partials);
+        gradient(kk) += 2.0 * weights.col(ii).head(ii).dot(pair_partials);
+      }
+    }
+  }
 
-    return has_room;
+  // Accumulate an online adaptation step, and maybe apply it. The predictive
+  // log-likelihood of a single point is very noisy (and its gradient blows up
+  // when the predictive variance is small), so each step is normalized by a
+  // running RMS of the gradient, as in RMSProp, to have size about
+  // 'adaptation_rate_'.
+  bool GaussianProcess::Adapt(const VectorXd& gradient) {
+    const double kDecay = 0.99;
+    const double kEpsilon = 1e-8;
+
+    const VectorXd& params = kernel_->ImmutableParams();
+    const VectorXd log_gradient = gradient.cwiseProduct(params);
+    adaptation_second_moment_ = kDecay * adaptation_second_moment_ +
+      (1.0 - kDecay) * log_gradient.cwiseAbs2();
+    num_adaptation_steps_++;
+
+    // Bias correction.
+    const VectorXd rms = (adaptation_second_moment_ /
+      (1.0 - std::pow(kDecay, static_cast<double>(num_adaptation_steps_))))
+      .cwiseSqrt();
+    pending_log_step_ -= adaptation_rate_ * log_gradient.cwiseQuotient(
+      (rms.array() + kEpsilon).matrix());
+
+    if (pending_log_step_.lpNorm<Eigen::Infinity>() < adaptation_threshold_)
+      return false;
+
+    kernel_->Reset(params.cwiseProduct(
+      pending_log_step_.array().exp().matrix()));
+    pending_log_step_.setZero();
+    hyperparam_state_.Reset();
+    return true;
   }
 
   // Update the training targets in the direction of the gradient of the
@@ -277,55 +1050,670 @@ namespace gp {
                                         const std::vector<double>& targets,
                                         double step_size, bool finalize) {
     CHECK_EQ(points.size(), targets.size());
+    CHECK_GE(points.size(), 1);
+    std::lock_guard<std::mutex> lock(mutex_);
+    ResolveCholesky();
+    const size_t N = points_->size();
+    const size_t B = points.size();
 
-    // Initialize 'mse' and 'grad' to zero.
-    double mse = 0.0;
-    VectorXd grad(VectorXd::Zero(targets_.size()));
+    // Cross covariance C of the whole batch against the training points.
+    CrossCovariance(points, update_cross_);
 
-    // Accumulate across all points/targets.
-    VectorXd cross(points_->size());
-    VectorXd regressed_cross(points_->size());
-    for (size_t ii = 0; ii < points.size(); ii++) {
-      // Get the cross covariance against the training points.
-      CrossCovariance(points[ii], cross);
+    // Maybe form the inverse covariance, if the factorization has changed.
+    const bool use_inverse = target_options_.cache_inverse;
+    if (use_inverse && inverse_source_ != published_llt_) {
+      inverse_ = llt_.solve(MatrixXd::Identity(N, N));
+      inverse_source_ = published_llt_;
+    }
 
-      // Compute regressed cross covariance.
-      regressed_cross = llt_.solve(cross);
+    // With regressed cross covariances R = inv(K) C, the errors at the batch
+    // points are e = R^T t - y = C^T inv(K) t - y, and the gradient of the
+    // mean squared error is (2 / B) R e = (2 / B) inv(K) (C e). Grouping the
+    // products this way needs two solves in all, rather than one per point.
+    if (use_inverse)
+      update_gradient_.noalias() =
+        inverse_.selfadjointView<Eigen::Lower>() * targets_.head(N);
+    else
+      update_gradient_ = llt_.solve(targets_.head(N));
+
+    update_errors_.noalias() = update_cross_.transpose() * update_gradient_;
+    for (size_t jj = 0; jj < B; jj++)
+      update_errors_(jj) -= targets[jj];
+
+    const double mse = update_errors_.squaredNorm() / static_cast<double>(B);
+
+    update_errors_ *= 2.0 / static_cast<double>(B);
+    if (use_inverse) {
+      update_gradient_.noalias() = inverse_.selfadjointView<Eigen::Lower>() *
+        (update_cross_ * update_errors_);
+    } else {
+      update_gradient_.noalias() = update_cross_ * update_errors_;
+      llt_.solveInPlace(update_gradient_);
+    }
 
-      // Compute error and accumulate MSE and gradient.
-      const double error =
-        regressed_cross.dot(targets_.head(points_->size())) - targets[ii];
+    // Optimizer state only grows with the training set (new entries start at
+    // zero), so points added in between updates are handled gracefully.
+    if (target_options_.method != TARGET_GRADIENT_DESCENT &&
+        target_first_moment_.size() < N) {
+      const size_t M = target_first_moment_.size();
+      target_first_moment_.conservativeResize(N);
+      target_first_moment_.tail(N - M).setZero();
+      target_second_moment_.conservativeResize(N);
+      target_second_moment_.tail(N - M).setZero();
+    }
 
-      mse += error * error;
-      grad += error * regressed_cross;
+    // Gradient update.
+    switch (target_options_.method) {
+    case TARGET_GRADIENT_DESCENT:
+      targets_.head(N) -= step_size * update_gradient_;
+      break;
+
+    case TARGET_MOMENTUM:
+      target_first_moment_.head(N) =
+        target_options_.momentum * target_first_moment_.head(N) -
+        step_size * update_gradient_;
+      targets_.head(N) += target_first_moment_.head(N);
+      break;
+
+    case TARGET_ADAM: {
+      num_target_updates_++;
+      const double beta1 = target_options_.beta1;
+      const double beta2 = target_options_.beta2;
+      target_first_moment_.head(N) =
+        beta1 * target_first_moment_.head(N) + (1.0 - beta1) * update_gradient_;
+      target_second_moment_.head(N) =
+        beta2 * target_second_moment_.head(N) +
+        (1.0 - beta2) * update_gradient_.cwiseAbs2();
+
+      // Bias corrected step.
+      const double scaling = step_size *
+        std::sqrt(1.0 - std::pow(beta2, num_target_updates_)) /
+        (1.0 - std::pow(beta1, num_target_updates_));
+      targets_.head(N).array() -= scaling *
+        target_first_moment_.head(N).array() /
+        (target_second_moment_.head(N).array().sqrt() +
+         target_options_.epsilon);
+      break;
+    }
     }
 
-    // Tack on constants.
-    mse /= static_cast<double>(points.size());
-    grad *= 2.0 / static_cast<double>(points.size());
+    version_++;
 
-    // Gradient update.
-    targets_.head(points_->size()) -= step_size * grad;
+    // Maybe update regressed targets and publish for readers.
+    if (finalize) {
+      if (use_inverse)
+        regressed_.head(N).noalias() =
+          inverse_.selfadjointView<Eigen::Lower>() * targets_.head(N);
+      else
+        regressed_.head(N) = llt_.solve(targets_.head(N));
 
-    // Maybe update regressed targets.
-    if (finalize)
-      regressed_.head(points_->size()) =
-        llt_.solve(targets_.head(points_->size()));
+      Publish();
+    }
 
     return mse;
   }
 
+  // Set the update rule for UpdateTargets.
+  void GaussianProcess::SetTargetUpdateOptions(
+    const TargetUpdateOptions& options) {
+    CHECK_GE(options.momentum, 0.0);
+    CHECK_LT(options.momentum, 1.0);
+    CHECK_GE(options.beta1, 0.0);
+    CHECK_LT(options.beta1, 1.0);
+    CHECK_GE(options.beta2, 0.0);
+    CHECK_LT(options.beta2, 1.0);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    target_options_ = options;
+    target_first_moment_.resize(0);
+    target_second_moment_.resize(0);
+    num_target_updates_ = 0;
+
+    if (!options.cache_inverse) {
+      inverse_.resize(0, 0);
+      inverse_source_.reset();
+    }
+  }
+
+  // Create a closed form target fitter for the current model.
+  StreamingTargetFitter::Ptr GaussianProcess::TargetFitter() const {
+    return StreamingTargetFitter::Create(*kernel_, noise_, *points_,
+                                         active_dimensions_);
+  }
+
+  // Replace all training targets.
+  void GaussianProcess::SetTargets(const VectorXd& targets) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ResolveCholesky();
+    const size_t N = points_->size();
+    CHECK_EQ(targets.size(), N);
+
+    targets_.head(N) = targets;
+    regressed_.head(N) = llt_.solve(targets);
+
+    // Bump the version and publish for readers.
+    version_++;
+    Publish();
+  }
+
+  // Refit after the kernel parameters were changed from outside.
+  void GaussianProcess::RefitKernel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Refit();
+  }
 
   // Learn kernel hyperparameters by maximizing the log-likelihood of the
   // training data.
-  bool GaussianProcess::LearnHyperparams() {
+  bool GaussianProcess::LearnHyperparams(bool warm_start) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Optimize. Only the first N targets are valid.
+    const VectorXd targets = targets_.head(points_->size());
+    bool success;
+    if (warm_start) {
+      const TrainingLogLikelihood cost(points_, &targets, kernel_, noise_);
+      VectorXd parameters = kernel_->ImmutableParams();
+      success = Lbfgs::Minimize(cost, Lbfgs::Options(), parameters.data(),
+                                &hyperparam_state_);
+      kernel_->Reset(parameters);
+    } else {
+      success = OptimizeHyperparams(kernel_, noise_, points_, targets,
+                                    NULL, NULL);
+      hyperparam_state_.Reset();
+    }
+
+    Refit();
+    return success;
+  }
+
+  // Learn kernel hyperparameters with Fisher scoring.
+  bool GaussianProcess::LearnHyperparamsFisherScoring(
+    const FisherScoring::Options& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Optimize. Only the first N targets are valid.
+    const VectorXd targets = targets_.head(points_->size());
+    const TrainingLogLikelihood likelihood(points_, &targets, kernel_, noise_);
+
+    VectorXd parameters = kernel_->ImmutableParams();
+    const bool success =
+      FisherScoring::Minimize(likelihood, options, parameters.data());
+    kernel_->Reset(parameters);
+    hyperparam_state_.Reset();
+
+    Refit();
+    return success;
+  }
+
+  // Learn kernel hyperparameters from minibatches of the training data.
+  bool GaussianProcess::LearnHyperparamsStochastic(
+    const StochasticTrainer::Options& options, bool polish) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Optimize. Only the first N targets are valid.
+    const VectorXd targets = targets_.head(points_->size());
+    bool success =
+      StochasticTrainer::Minimize(kernel_, noise_, points_, targets, options);
+
+    if (success && polish)
+      success = OptimizeHyperparams(kernel_, noise_, points_, targets,
+                                    NULL, NULL);
+
+    hyperparam_state_.Reset();
+    Refit();
+    return success;
+  }
+
+  // Learn kernel hyperparameters from several initial guesses in parallel,
+  // and keep the solution with the lowest objective.
+  bool GaussianProcess::LearnHyperparamsMultiStart(size_t num_starts,
+                                                   double min_param,
+                                                   double max_param,
+                                                   size_t num_threads) {
+    CHECK_GE(num_starts, 1);
+    CHECK_GT(min_param, 0.0);
+    CHECK_GT(max_param, min_param);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Only the first N targets are valid.
+    const VectorXd targets = targets_.head(points_->size());
+
+    // One kernel per run. The first starts from the current parameters, and
+    // the rest from a Latin hypercube in log space: along each dimension,
+    // every run falls in a different one of 'num_starts - 1' equal strata.
+    std::vector<Kernel::Ptr> kernels;
+    for (size_t ii = 0; ii < num_starts; ii++)
+      kernels.push_back(kernel_->Clone());
+
+    std::random_device rd;
+    std::default_random_engine rng(rd());
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    const double log_min = std::log(min_param);
+    const double log_range = std::log(max_param) - log_min;
+    std::vector<size_t> strata(num_starts - 1);
+    for (size_t jj = 0; jj < kernel_->ImmutableParams().size(); jj++) {
+      std::iota(strata.begin(), strata.end(), 0);
+      std::shuffle(strata.begin(), strata.end(), rng);
+
+      for (size_t ii = 1; ii < num_starts; ii++) {
+        const double u = (strata[ii - 1] + unif(rng)) / (num_starts - 1);
+        kernels[ii]->Params()(jj) = std::exp(log_min + log_range * u);
+      }
+    }
+
+    // Run all optimizations on a thread pool.
+    SharedBestCost best;
+    std::vector<double> costs(num_starts);
+    std::vector<char> usable(num_starts, false);
+    {
+      const ThreadPool::Ptr pool = ThreadPool::Create(num_threads);
+      ThreadPool::TaskGroup group;
+      for (size_t ii = 0; ii < num_starts; ii++) {
+        pool->Schedule([&, ii]() {
+            MultiStartCallback callback(kMaxHyperparamIterations,
+                                        kMinMultiStartIterations, &best);
+            usable[ii] = OptimizeHyperparams(kernels[ii], noise_, points_,
+                                             targets, &callback, &costs[ii]);
+          }, group);
+      }
+
+      pool->Wait(group);
+    }
+
+    // Keep the best usable solution.
+    int best_run = -1;
+    for (size_t ii = 0; ii < num_starts; ii++) {
+      if (usable[ii] && (best_run < 0 || costs[ii] < costs[best_run]))
+        best_run = static_cast<int>(ii);
+    }
+
+    if (best_run < 0) {
+      LOG(WARNING) << "All " << num_starts << " hyperparameter optimization "
+                   << "runs failed.";
+      return false;
+    }
+
+    kernel_->Reset(kernels[best_run]->ImmutableParams());
+    hyperparam_state_.Reset();
+    Refit();
+    return true;
+  }
+
+  // Learn kernel hyperparameters on a worker thread from a copy of the
+  // current training data, and swap in the new model when done.
+  std::future<bool> GaussianProcess::LearnHyperparamsAsync(
+    size_t max_staleness, const std::function<void(bool)>& callback) {
+    std::lock_guard<std::mutex> relearn_lock(relearn_mutex_);
+
+    // Only one relearn may be outstanding at a time.
+    StopRelearn();
+    relearn_cancelled_ = false;
+
+    // Copy the training data and kernel.
+    PointSet points(new std::vector<VectorXd>);
+    VectorXd targets;
+    Kernel::Ptr kernel;
+    double noise;
+    uint64_t generation;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      points->assign(points_->begin(), points_->end());
+      targets = targets_.head(points_->size());
+      kernel = kernel_->Clone();
+      noise = noise_;
+      generation = hyperparam_generation_;
+    }
+
+    // Launch the worker.
+    const std::shared_ptr< std::promise<bool> > promise(
+      new std::promise<bool>);
+    std::future<bool> future = promise->get_future();
+
+    relearn_thread_ = std::thread(&GaussianProcess::Relearn, this,
+                                  kernel, noise, points, targets, generation,
+                                  max_staleness, promise, callback);
+    return future;
+  }
+
+  // Prune input dimensions which an RBF kernel effectively ignores.
+  size_t GaussianProcess::PruneDimensions(double tolerance) {
+    CHECK_GT(tolerance, 0.0);
+
+    // An outstanding relearn would install parameters for all dimensions.
+    std::lock_guard<std::mutex> relearn_lock(relearn_mutex_);
+    StopRelearn();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dynamic_cast<const RbfKernel*>(kernel_.get())) {
+      LOG(WARNING) << "Can only prune dimensions of an RBF kernel.";
+      return 0;
+    }
+
+    const size_t N = points_->size();
+    if (N == 0)
+      return 0;
+
+    // Range of the training points in each dimension.
+    VectorXd lower = points_->at(0);
+    VectorXd upper = points_->at(0);
+    for (size_t ii = 1; ii < N; ii++) {
+      lower = lower.cwiseMin(points_->at(ii));
+      upper = upper.cwiseMax(points_->at(ii));
+    }
+
+    // Keep dimensions with a length scale below the tolerance. If the points
+    // do not vary along a dimension, it still matters for queries. Keep at
+    // least the most relevant dimension.
+    const VectorXd& lengths = kernel_->ImmutableParams();
+    const VectorXd ranges = upper - lower;
+    std::vector<size_t> kept;
+    size_t most_relevant = 0;
+    for (size_t ii = 0; ii < lengths.size(); ii++) {
+      if (ranges(ii) <= 0.0 ||
+          std::abs(lengths(ii)) < tolerance * ranges(ii))
+        kept.push_back(ii);
+
+      if (std::abs(lengths(ii)) * ranges(most_relevant) <
+          std::abs(lengths(most_relevant)) * ranges(ii))
+        most_relevant = ii;
+    }
+
+    if (kept.empty())
+      kept.push_back(most_relevant);
+
+    const size_t num_pruned = lengths.size() - kept.size();
+    if (num_pruned == 0)
+      return 0;
+
+    // Compact the kernel parameters, online adaptation state, and training
+    // points, and record the active dimensions in terms of the inputs.
+    VectorXd kept_lengths(kept.size());
+    VectorXd kept_log_step(kept.size());
+    VectorXd kept_second_moment(kept.size());
+    std::vector<size_t>* dimensions = new std::vector<size_t>(kept.size());
+    for (size_t ii = 0; ii < kept.size(); ii++) {
+      kept_lengths(ii) = lengths(kept[ii]);
+      (*dimensions)[ii] = (active_dimensions_) ?
+        active_dimensions_->at(kept[ii]) : kept[ii];
+
+      if (pending_log_step_.size() > 0) {
+        kept_log_step(ii) = pending_log_step_(kept[ii]);
+        kept_second_moment(ii) = adaptation_second_moment_(kept[ii]);
+      }
+    }
+
+    // The kernel may be shared with the caller or other models, e.g. the
+    // shards of a committee, so compact a private copy.
+    kernel_ = kernel_->Clone();
+    kernel_->Params() = kept_lengths;
+    active_dimensions_.reset(dimensions);
+
+    if (pending_log_step_.size() > 0) {
+      pending_log_step_ = kept_log_step;
+      adaptation_second_moment_ = kept_second_moment;
+    }
+
+    const ConstDimensions kept_dimensions(new std::vector<size_t>(kept));
+    VectorXd projected;
+    for (size_t ii = 0; ii < N; ii++) {
+      points_->at(ii) =
+        ModelSnapshot::Project(kept_dimensions, points_->at(ii), projected);
+    }
+
+    // Warm start curvature pairs are for the old parameters.
+    hyperparam_state_.Reset();
+
+    // Recompute everything with the compacted kernel.
+    published_points_.reset();
+    Refit();
+
+    return num_pruned;
+  }
+
+  // Eigendecompose the noise free covariance of the current training data.
+  NoiseSweep::Ptr GaussianProcess::SweepNoise() const {
+    return NoiseSweep::Create(*kernel_, *points_,
+                              targets_.head(points_->size()));
+  }
+
+  // Set the noise variance, and refactor.
+  void GaussianProcess::SetNoise(double noise) {
+    CHECK_GT(noise, 0.0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t N = points_->size();
+
+    noise_ = noise;
+    covariance_.diagonal().head(N).setConstant(1.0 + noise_);
+
+    // Warm start curvature pairs are for the old objective, and a relearn
+    // started before now would undo the new noise.
+    hyperparam_state_.Reset();
+    hyperparam_generation_++;
+
+    llt_.compute(covariance_.topLeftCorner(N, N));
+    noise_sweep_.reset();
+    regressed_.head(N) = llt_.solve(targets_.head(N));
+
+    // Bump the version and publish for readers.
+    version_++;
+    published_llt_.reset();
+    Publish();
+  }
+
+  // Learn the noise variance by maximizing the training log-likelihood.
+  double GaussianProcess::LearnNoise(double min_noise, double max_noise,
+                                     size_t num_samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const NoiseSweep::ConstPtr sweep = SweepNoise();
+    const double noise = sweep->Learn(min_noise, max_noise, num_samples);
+
+    InstallNoise(noise, sweep);
+    return noise;
+  }
+
+  // Set the noise variance from a sweep, without refactoring. Caller must
+  // hold 'mutex_'.
+  void GaussianProcess::InstallNoise(double noise,
+                                     const NoiseSweep::ConstPtr& sweep) {
+    CHECK_GT(noise, 0.0);
+    const size_t N = points_->size();
+    CHECK_EQ(sweep->NumPoints(), N);
+
+    noise_ = noise;
+    covariance_.diagonal().head(N).setConstant(1.0 + noise_);
+
+    // As in SetNoise.
+    hyperparam_state_.Reset();
+    hyperparam_generation_++;
+
+    // Regressed targets from the eigendecomposition. The Cholesky factor is
+    // now stale, and the sweep stands in for it.
+    VectorXd regressed;
+    sweep->RegressedTargets(noise_, regressed);
+    regressed_.head(N) = regressed;
+    noise_sweep_ = sweep;
+
+    // Bump the version and publish for readers.
+    version_++;
+    published_llt_.reset();
+    Publish();
+  }
+
+  // Bring the Cholesky factor up to date, if it is stale. The published
+  // snapshot computes it (once), and both share the result.
+  void GaussianProcess::ResolveCholesky() {
+    if (!noise_sweep_)
+      return;
+
+    published_llt_ = snapshot_->SharedCholesky();
+    llt_ = *published_llt_;
+    noise_sweep_.reset();
+  }
+
+  // Build a smaller model from a representative subset of the training points.
+  GaussianProcess::Ptr GaussianProcess::Compress(
+    double tolerance, size_t max_points, CompressionSummary* summary) const {
+    const size_t N = points_->size();
+
+    // Pick the subset from the noise free covariance, whose diagonal is one.
+    const PivotedCholesky::ConstPtr cholesky = PivotedCholesky::Create(
+      VectorXd::Ones(N), [this, N](size_t ii, VectorXd& column) {
+        column = covariance_.col(ii).head(N);
+        column(ii) = 1.0;
+      }, tolerance, max_points);
+    const std::vector<size_t>& pivots = cholesky->Pivots();
+    const size_t M = pivots.size();
+    CHECK_GE(M, 1);
+
+    // Since the pivot columns are reproduced exactly, the cross covariance
+    // of all points against the subset is L * L_s^T, where L_s holds the rows
+    // of L at the pivots (lower triangular). The full model's mean at the
+    // training points is K0 * inv(K) * targets = targets - noise * regressed.
+    const MatrixXd& factor = cholesky->Factor();
+    MatrixXd subset_factor(M, M);
+    for (size_t ii = 0; ii < M; ii++)
+      subset_factor.row(ii) = factor.row(pivots[ii]);
+
+    const VectorXd mean =
+      targets_.head(N) - noise_ * regressed_.head(N);
+
+    // Fit the subset's regressed targets 'beta' to the full mean by least
+    // squares, in terms of gamma = L_s^T * beta.
+    const VectorXd gamma = factor.colPivHouseholderQr().solve(mean);
+    const VectorXd beta =
+      subset_factor.triangularView<Eigen::Lower>().transpose().solve(gamma);
+
+    // The subset's targets reproduce 'beta' as its regressed targets.
+    PointSet subset_points(new std::vector<VectorXd>);
+    subset_points->reserve(M);
+    for (size_t ii = 0; ii < M; ii++)
+      subset_points->push_back(points_->at(pivots[ii]));
+
+    const VectorXd subset_targets = subset_factor * gamma + noise_ * beta;
+    const Ptr compressed(new GaussianProcess(
+      kernel_->Clone(), noise_, subset_points, subset_targets, M));
+
+    // Take unprojected queries, like this model.
+    if (active_dimensions_) {
+      compressed->dimension_ = dimension_;
+      compressed->active_dimensions_ = active_dimensions_;
+      compressed->Publish();
+    }
+
+    if (summary) {
+      const VectorXd error = factor * gamma - mean;
+      summary->num_points = M;
+      summary->max_residual_variance = cholesky->MaxResidual();
+      summary->rms_mean_error = std::sqrt(error.squaredNorm() / N);
+      summary->max_mean_error = error.lpNorm<Eigen::Infinity>();
+    }
+
+    return compressed;
+  }
+
+  // Cancel an outstanding asynchronous relearn, and wait for it to stop.
+  void GaussianProcess::CancelLearnHyperparams() {
+    std::lock_guard<std::mutex> relearn_lock(relearn_mutex_);
+    StopRelearn();
+  }
+
+  void GaussianProcess::StopRelearn() {
+    relearn_cancelled_ = true;
+
+    if (relearn_thread_.joinable())
+      relearn_thread_.join();
+  }
+
+  // Body of the worker thread for LearnHyperparamsAsync.
+  void GaussianProcess::Relearn(
+    const Kernel::Ptr& kernel, double noise, const PointSet& points,
+    const VectorXd& targets, uint64_t generation, size_t max_staleness,
+    const std::shared_ptr< std::promise<bool> >& promise,
+    const std::function<void(bool)>& callback) {
+    const size_t num_optimized = points->size();
+    CancellationCallback cancellation(&relearn_cancelled_);
+    bool success = OptimizeHyperparams(kernel, noise, points, targets,
+                                       &cancellation, NULL);
+
+    // Factor the covariance with the new parameters outside the lock. Points
+    // added in the meantime are copied and we try again; if we keep falling
+    // behind, we eventually factor while holding the lock.
+    MatrixXd covariance;
+    Eigen::LLT<MatrixXd> llt;
+    size_t num_factored = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    for (size_t attempt = 1; success; attempt++) {
+      if (!lock.owns_lock())
+        lock.lock();
+
+      // Give up if the kernel parameters or noise were changed in the
+      // meantime, since installing ours would silently undo that.
+      const size_t N = points_->size();
+      if (relearn_cancelled_ || hyperparam_generation_ != generation ||
+          N - num_optimized > max_staleness) {
+        success = false;
+        break;
+      }
+
+      // Up to date. Install below, while still holding the lock.
+      if (num_factored == N)
+        break;
+
+      for (size_t ii = points->size(); ii < N; ii++)
+        points->push_back(points_->at(ii));
+
+      if (attempt < kMaxRefactorAttempts)
+        lock.unlock();
+
+      BuildCovariance(*kernel, noise, *points, covariance);
+      llt.compute(covariance);
+      num_factored = N;
+    }
+
+    // Swap in the new model.
+    if (success) {
+      const size_t N = num_factored;
+      kernel_->Reset(kernel->ImmutableParams());
+      hyperparam_state_.Reset();
+      hyperparam_generation_++;
+      covariance_.topLeftCorner(N, N) = covariance;
+      llt_ = llt;
+      noise_sweep_.reset();
+      regressed_.head(N) = llt_.solve(targets_.head(N));
+
+      // Bump the version and publish for readers.
+      version_++;
+      published_kernel_.reset();
+      published_llt_.reset();
+      Publish();
+    }
+
+    if (lock.owns_lock())
+      lock.unlock();
+
+    // Notify the callback first, so it has run once the future is ready.
+    if (callback)
+      callback(success);
+    promise->set_value(success);
+  }
+
+  // Optimize the parameters of the given kernel against the given training
+  // data. Returns whether the solution is usable.
+  bool GaussianProcess::OptimizeHyperparams(
+    const Kernel::Ptr& kernel, double noise, const PointSet& points,
+    const VectorXd& targets, ceres::IterationCallback* callback,
+    double* cost) {
     // Create a Ceres problem.
-    TrainingLogLikelihood* cost =
-      new TrainingLogLikelihood(points_, &targets_, kernel_, noise_);
-    ceres::GradientProblem problem(cost);
+    TrainingLogLikelihood* likelihood =
+      new TrainingLogLikelihood(points, &targets, kernel, noise);
+    ceres::GradientProblem problem(likelihood);
 
     // Create a parameter vector.
-    VectorXd& kernel_params = kernel_->Params();
+    VectorXd& kernel_params = kernel->Params();
     double parameters[kernel_params.size()];
     for (size_t ii = 0; ii < kernel_params.size(); ii++)
       parameters[ii] = kernel_params(ii);
@@ -334,28 +1722,46 @@ namespace gp {
     ceres::GradientProblemSolver::Summary summary;
     ceres::GradientProblemSolver::Options options;
     options.minimizer_progress_to_stdout = false;
-    options.max_num_iterations = 100;
+    options.max_num_iterations = kMaxHyperparamIterations;
     options.max_num_line_search_step_size_iterations = 50;
     options.max_num_line_search_direction_restarts = 25;
     options.max_lbfgs_rank = 15;
     //    options.line_search_type = ceres::ARMIJO;
     //    options.line_search_direction_type = ceres::NONLINEAR_CONJUGATE_GRADIENT;
 
+    // Maybe stop early.
+    if (callback)
+      options.callbacks.push_back(callback);
+
     ceres::Solve(options, problem, parameters, &summary);
 
     // Store the parameters back in the kernel.
     for (size_t ii = 0; ii < kernel_params.size(); ii++)
       kernel_params(ii) = parameters[ii];
 
-    // Recompute covariance, cholesky, and regressed targets.
+    if (cost)
+      *cost = summary.final_cost;
+
+    return summary.IsSolutionUsable();
+  }
+
+  // Recompute covariance, Cholesky, and regressed targets after the kernel
+  // changes. Caller must hold 'mutex_'.
+  void GaussianProcess::Refit() {
+    hyperparam_generation_++;
     Covariance();
 
     llt_.compute(covariance_.topLeftCorner(points_->size(), points_->size()));
+    noise_sweep_.reset();
 
     regressed_.head(points_->size()) =
       llt_.solve(targets_.head(points_->size()));
 
-    return summary.IsSolutionUsable();
+    // Bump the version and publish for readers.
+    version_++;
+    published_kernel_.reset();
+    published_llt_.reset();
+    Publish();
   }
 
   // Compute the covariance and cross covariance against the training points.
@@ -375,4 +1781,58 @@ namespace gp {
     for (size_t ii = 0; ii < points_->size(); ii++)
       cross(ii) = kernel_->Evaluate(points_->at(ii), x);
   }
+
+  void GaussianProcess::CrossCovariance(const std::vector<VectorXd>& points,
+                                        MatrixXd& cross) const {
+    ModelSnapshot::CrossCovariance(*kernel_, *points_, active_dimensions_,
+                                   points, cross);
+  }
+
+  void GaussianProcess::BuildCovariance(const Kernel& kernel, double noise,
+                                        const std::vector<VectorXd>& points,
+                                        MatrixXd& covariance) {
+    covariance.resize(points.size(), points.size());
+
+    for (size_t ii = 0; ii < points.size(); ii++) {
+      covariance(ii, ii) = 1.0 + noise;
+
+      for (size_t jj = 0; jj < ii; jj++) {
+        covariance(ii, jj) = kernel.Evaluate(points[ii], points[jj]);
+        covariance(jj, ii) = covariance(ii, jj);
+      }
+    }
+  }
+
+  // Set (or clear) the prediction cache.
+  void GaussianProcess::SetPredictionCache(const PredictionCache::Ptr& cache) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_ = cache;
+    Publish();
+  }
+
+  // Publish a new snapshot of the model for readers. Only the pieces which
+  // have been reset since the last snapshot are copied; the rest are shared.
+  void GaussianProcess::Publish() {
+    const size_t N = points_->size();
+
+    // Keep the truncation index in sync with the points and kernel.
+    if (truncation_cutoff_ > 0.0 && (!published_points_ || !published_kernel_))
+      BuildTruncationIndex();
+
+    if (!published_kernel_)
+      published_kernel_ = kernel_->Clone();
+
+    if (!published_points_)
+      published_points_.reset(new std::vector<VectorXd>(*points_));
+
+    // While the factor is stale, the snapshot works from the noise sweep.
+    if (!published_llt_ && !noise_sweep_)
+      published_llt_.reset(new Eigen::LLT<MatrixXd>(llt_));
+
+    const ModelSnapshot::ConstPtr snapshot(new ModelSnapshot(
+      published_kernel_, noise_, published_points_, published_llt_,
+      regressed_.head(N), version_, cache_, cache_owner_,
+      active_dimensions_, noise_sweep_));
+    std::atomic_store(&snapshot_, snapshot);
+  }
 }  //\namespace gp
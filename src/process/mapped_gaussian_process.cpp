@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the MappedGaussianProcess class, a read-only GP backed by a model
+// file which is memory-mapped rather than read. The file stores the kernel
+// type and parameters, noise, training points and targets, the Cholesky
+// factor of the covariance, and the regressed targets, each in its own
+// 64-byte aligned section, so that loading only has to validate the header
+// and the model's Eigen maps point straight into the mapping.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/mapped_gaussian_process.hpp>
+#include <kernels/rbf_kernel.hpp>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+
+namespace gp {
+
+  namespace {
+    // File identification.
+    const char kMagic[8] = { 'G', 'P', 'M', 'O', 'D', 'E', 'L', '\0' };
+    const uint32_t kEndianTag = 0x01020304;
+    const uint32_t kVersion = 1;
+
+    // Section alignment, in bytes.
+    const uint64_t kAlignment = 64;
+
+    // Known kernel types.
+    enum KernelType { RBF_KERNEL = 0 };
+
+    // Fixed-size file header. All offsets are in bytes from the start of the
+    // file, and the checksum covers everything after the header.
+    struct ModelFileHeader {
+      char magic[8];
+      uint32_t endian_tag;
+      uint32_t version;
+      uint32_t kernel_type;
+      uint32_t reserved;
+      uint64_t dimension;
+      uint64_t num_points;
+      uint64_t num_params;
+      double noise;
+      uint64_t params_offset;
+      uint64_t points_offset;
+      uint64_t targets_offset;
+      uint64_t regressed_offset;
+      uint64_t cholesky_offset;
+      uint64_t file_size;
+      uint64_t checksum;
+    }; //\struct ModelFileHeader
+
+    // Round up to the section alignment.
+    uint64_t Align(uint64_t offset) {
+      return (offset + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    // Lay out the sections given the sizes stored in the header.
+    void LayOut(ModelFileHeader& header) {
+      const uint64_t N = header.num_points;
+      const uint64_t D = header.dimension;
+
+      header.params_offset = Align(sizeof(header));
+      header.points_offset =
+        Align(header.params_offset + sizeof(double) * header.num_params);
+      header.targets_offset =
+        Align(header.points_offset + sizeof(double) * D * N);
+      header.regressed_offset =
+        Align(header.targets_offset + sizeof(double) * N);
+      header.cholesky_offset =
+        Align(header.regressed_offset + sizeof(double) * N);
+      header.file_size = header.cholesky_offset + sizeof(double) * N * N;
+    }
+
+    // 64-bit FNV-1a hash, which can be accumulated in pieces.
+    const uint64_t kChecksumSeed = 0xcbf29ce484222325ULL;
+    uint64_t Checksum(const void* data, size_t size, uint64_t hash) {
+      const unsigned char* bytes = static_cast<const unsigned char*>(data);
+      for (size_t ii = 0; ii < size; ii++) {
+        hash ^= bytes[ii];
+        hash *= 0x100000001b3ULL;
+      }
+
+      return hash;
+    }
+
+    // Write 'size' bytes at the current position, accumulating the checksum.
+    void Write(std::ofstream& stream, const void* data, size_t size,
+               uint64_t& checksum) {
+      stream.write(static_cast<const char*>(data), size);
+      checksum = Checksum(data, size, checksum);
+    }
+
+    // Pad with zeros up to the given offset.
+    void Pad(std::ofstream& stream, uint64_t offset, uint64_t& checksum) {
+      const char zeros[kAlignment] = { 0 };
+      const uint64_t position = static_cast<uint64_t>(stream.tellp());
+      CHECK_LE(position, offset);
+      CHECK_LT(offset - position, kAlignment);
+      Write(stream, zeros, offset - position, checksum);
+    }
+  } //\namespace
+
+  MappedGaussianProcess::MappedGaussianProcess(
+    void* data, size_t size, const Kernel::ConstPtr& kernel, double noise,
+    const double* points, const double* targets, const double* regressed,
+    const double* cholesky, size_t dimension, size_t num_points)
+    : data_(data),
+      size_(size),
+      kernel_(kernel),
+      noise_(noise),
+      points_(points, dimension, num_points),
+      targets_(targets, num_points),
+      regressed_(regressed, num_points),
+      cholesky_(cholesky, num_points, num_points) {
+    CHECK_NOTNULL(data_);
+    CHECK_NOTNULL(kernel_.get());
+  }
+
+  MappedGaussianProcess::~MappedGaussianProcess() {
+    munmap(data_, size_);
+  }
+
+  // Write a model file.
+  bool MappedGaussianProcess::Save(const GaussianProcess& gp,
+                                   const std::string& file) {
+    const Kernel::ConstPtr kernel = gp.ImmutableKernel();
+    if (!dynamic_cast<const RbfKernel*>(kernel.get())) {
+      LOG(WARNING) << "Cannot save a model with an unknown kernel type.";
+      return false;
+    }
+
+    if (gp.ActiveDimensions()) {
+      LOG(WARNING) << "Cannot save a model with pruned input dimensions.";
+      return false;
+    }
+
+    const ConstPointSet points = gp.ImmutablePoints();
+    const uint64_t N = points->size();
+    const uint64_t D = gp.Dimension();
+    const VectorXd& params = kernel->ImmutableParams();
+
+    // Lay out the sections.
+    ModelFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.endian_tag = kEndianTag;
+    header.version = kVersion;
+    header.kernel_type = RBF_KERNEL;
+    header.dimension = D;
+    header.num_points = N;
+    header.num_params = params.size();
+    header.noise = gp.Noise();
+    LayOut(header);
+
+    std::ofstream stream(file.c_str(), std::ios::binary | std::ios::trunc);
+    if (!stream.is_open()) {
+      LOG(WARNING) << "Could not open " << file << " for writing.";
+      return false;
+    }
+
+    // Write a placeholder header; it is rewritten once the checksum is known.
+    uint64_t checksum = kChecksumSeed;
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Kernel parameters.
+    Pad(stream, header.params_offset, checksum);
+    Write(stream, params.data(), sizeof(double) * params.size(), checksum);
+
+    // Training points, one per column.
+    Pad(stream, header.points_offset, checksum);
+    for (size_t ii = 0; ii < N; ii++) {
+      CHECK_EQ(points->at(ii).size(), D);
+      Write(stream, points->at(ii).data(), sizeof(double) * D, checksum);
+    }
+
+    // Targets and regressed targets.
+    const VectorXd targets = gp.ImmutableTargets().head(N);
+    const VectorXd regressed = gp.ImmutableRegressedTargets().head(N);
+    Pad(stream, header.targets_offset, checksum);
+    Write(stream, targets.data(), sizeof(double) * N, checksum);
+    Pad(stream, header.regressed_offset, checksum);
+    Write(stream, regressed.data(), sizeof(double) * N, checksum);
+
+    // Lower triangular Cholesky factor, column-major (upper part is zero).
+    const MatrixXd L = gp.ImmutableCholesky().matrixL();
+    Pad(stream, header.cholesky_offset, checksum);
+    Write(stream, L.data(), sizeof(double) * N * N, checksum);
+
+    // Rewrite the header with the checksum.
+    header.checksum = checksum;
+    stream.seekp(0);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    stream.close();
+    if (stream.fail()) {
+      LOG(WARNING) << "Error writing " << file << ".";
+      return false;
+    }
+
+    return true;
+  }
+
+  // Map a model file.
+  MappedGaussianProcess::ConstPtr MappedGaussianProcess::Load(
+    const std::string& file, bool verify_checksum) {
+    const int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+      LOG(WARNING) << "Could not open " << file << " for reading.";
+      return ConstPtr();
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+        static_cast<size_t>(status.st_size) < sizeof(ModelFileHeader)) {
+      LOG(WARNING) << file << " is too small to be a model file.";
+      close(fd);
+      return ConstPtr();
+    }
+
+    const size_t size = status.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      LOG(WARNING) << "Could not map " << file << ".";
+      return ConstPtr();
+    }
+
+    // Validate the header. Sizes are bounded by the file size before the
+    // layout is recomputed, so that corrupt sizes cannot overflow.
+    ModelFileHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    const uint64_t max_doubles = size / sizeof(double);
+    ModelFileHeader expected = header;
+    const bool sizes_valid = header.num_params <= max_doubles &&
+      header.num_points < (1ULL << 32) && header.dimension < (1ULL << 32) &&
+      header.dimension * header.num_points <= max_doubles &&
+      header.num_points * header.num_points <= max_doubles;
+    if (sizes_valid)
+      LayOut(expected);
+
+    const char* error = NULL;
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+      error = "not a model file";
+    else if (header.endian_tag != kEndianTag)
+      error = "written with different endianness";
+    else if (header.version != kVersion)
+      error = "unsupported version";
+    else if (header.kernel_type != RBF_KERNEL ||
+             header.num_params != header.dimension)
+      error = "unknown kernel";
+    else if (!sizes_valid || header.file_size != size ||
+             memcmp(&header, &expected, sizeof(header)) != 0)
+      error = "truncated or corrupt header";
+    else if (verify_checksum &&
+             Checksum(static_cast<const char*>(data) + sizeof(header),
+                      size - sizeof(header), kChecksumSeed) !=
+             header.checksum)
+      error = "checksum mismatch";
+
+    if (error) {
+      LOG(WARNING) << "Could not load " << file << ": " << error << ".";
+      munmap(data, size);
+      return ConstPtr();
+    }
+
+    // Build the model.
+    const char* bytes = static_cast<const char*>(data);
+    const double* params =
+      reinterpret_cast<const double*>(bytes + header.params_offset);
+    const Kernel::ConstPtr kernel = RbfKernel::Create(
+      Eigen::Map<const VectorXd>(params, header.num_params));
+
+    return ConstPtr(new MappedGaussianProcess(
+      data, size, kernel, header.noise,
+      reinterpret_cast<const double*>(bytes + header.points_offset),
+      reinterpret_cast<const double*>(bytes + header.targets_offset),
+      reinterpret_cast<const double*>(bytes + header.regressed_offset),
+      reinterpret_cast<const double*>(bytes + header.cholesky_offset),
+      header.dimension, header.num_points));
+  }
+
+  // Evaluate mean and variance at a point.
+  void MappedGaussianProcess::Evaluate(const VectorXd& x, double& mean,
+                                       double& variance) const {
+    CHECK_EQ(x.size(), Dimension());
+
+    // Compute cross covariance.
+    VectorXd cross(NumPoints());
+    VectorXd point(Dimension());
+    for (size_t ii = 0; ii < NumPoints(); ii++) {
+      point = points_.col(ii);
+      cross(ii) = kernel_->Evaluate(point, x);
+    }
+
+    // Compute mean and variance.
+    mean = cross.dot(regressed_);
+    variance = 1.0 -
+      cholesky_.triangularView<Eigen::Lower>().solve(cross).squaredNorm();
+  }
+
+}  //\namespace gp
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ModelSnapshot class, an immutable copy of everything needed to
+// evaluate a GaussianProcess (kernel parameters, noise variance, training
+// points, Cholesky factor, and regressed targets). Snapshots are published
+// atomically by the GaussianProcess every time a writer changes the model, so
+// that any number of reader threads can evaluate without locking against a
+// consistent state.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/model_snapshot.hpp>
+#include <utils/pivoted_cholesky.hpp>
+
+namespace gp {
+
+  ModelSnapshot::ModelSnapshot(const Kernel::ConstPtr& kernel, double noise,
+                               const ConstPointSet& points,
+                               const ConstCholesky& llt,
+                               const VectorXd& regressed,
+                               uint64_t version,
+                               const PredictionCache::Ptr& cache,
+                               uint64_t cache_owner,
+                               const ConstDimensions& dimensions,
+                               const NoiseSweep::ConstPtr& sweep)
+    : kernel_(kernel),
+      noise_(noise),
+      points_(points),
+      llt_(llt),
+      sweep_(sweep),
+      regressed_(regressed),
+      version_(version),
+      cache_(cache),
+      cache_owner_(cache_owner),
+      dimensions_(dimensions) {
+    CHECK_NOTNULL(kernel_.get());
+    CHECK_GT(noise_, 0.0);
+    CHECK_NOTNULL(points_.get());
+    CHECK_EQ(points_->size(), regressed_.size());
+    CHECK_NE(llt_ == nullptr, sweep_ == nullptr);
+
+    if (llt_)
+      CHECK_EQ(llt_->rows(), regressed_.size());
+    else
+      CHECK_EQ(sweep_->NumPoints(), regressed_.size());
+  }
+
+  // Cholesky factor, computed on first use.
+  const ModelSnapshot::ConstCholesky& ModelSnapshot::SharedCholesky() const {
+    std::call_once(llt_flag_, [this]() {
+        if (llt_)
+          return;
+
+        // As in GaussianProcess, the diagonal is one plus the noise.
+        MatrixXd covariance;
+        CrossCovariance(*kernel_, *points_, nullptr, *points_, covariance);
+        covariance.diagonal().setConstant(1.0 + noise_);
+        llt_.reset(new Eigen::LLT<MatrixXd>(covariance));
+      });
+
+    return llt_;
+  }
+
+  // Whiten the columns of 'b' in place.
+  void ModelSnapshot::Whiten(MatrixXd& b) const {
+    if (sweep_)
+      sweep_->Whiten(noise_, b);
+    else
+      llt_->matrixL().solveInPlace(b);
+  }
+
+  // Evaluate mean and variance at a point.
+  void ModelSnapshot::Evaluate(const VectorXd& x,
+                               double& mean, double& variance) const {
+    if (cache_ && cache_->Lookup(x, cache_owner_, version_, mean, variance))
+      return;
+
+    // Compute cross covariance.
+    VectorXd projected;
+    const VectorXd& point = Project(dimensions_, x, projected);
+
+    VectorXd cross(points_->size());
+    for (size_t ii = 0; ii < points_->size(); ii++)
+      cross(ii) = kernel_->Evaluate(points_->at(ii), point);
+
+    // Compute mean and variance.
+    mean = cross.dot(regressed_);
+    variance = 1.0 - (sweep_ ? sweep_->InverseQuadratic(noise_, cross) :
+                      cross.dot(llt_->solve(cross)));
+
+    if (cache_)
+      cache_->Insert(x, cache_owner_, version_, mean, variance);
+  }
+
+  // Joint predictive mean and covariance at a batch of points.
+  void ModelSnapshot::EvaluateJoint(const std::vector<VectorXd>& queries,
+                                    VectorXd& mean,
+                                    MatrixXd& covariance) const {
+    const size_t M = queries.size();
+
+    // Prior covariance of the (projected) queries. As for the training
+    // points, the diagonal is one.
+    std::vector<VectorXd> projected(dimensions_ ? M : 0);
+    for (size_t ii = 0; ii < projected.size(); ii++)
+      Project(dimensions_, queries[ii], projected[ii]);
+
+    CrossCovariance(*kernel_, dimensions_ ? projected : queries, nullptr,
+                    dimensions_ ? projected : queries, covariance);
+    covariance.diagonal().setOnes();
+
+    // Mean, and V = inv(L) K_X*.
+    MatrixXd cross;
+    CrossCovariance(queries, cross);
+    mean.noalias() = cross.transpose() * regressed_;
+    Whiten(cross);
+
+    // Subtract V^T V from the lower triangle, and mirror it.
+    covariance.selfadjointView<Eigen::Lower>().rankUpdate(
+      cross.transpose(), -1.0);
+    covariance.triangularView<Eigen::StrictlyUpper>() =
+      covariance.transpose();
+  }
+
+  // Low rank joint predictive covariance at a batch of points.
+  void ModelSnapshot::EvaluateJoint(const std::vector<VectorXd>& queries,
+                                    size_t max_rank, double tolerance,
+                                    VectorXd& mean, MatrixXd& factor,
+                                    VectorXd& diagonal) const {
+    const size_t M = queries.size();
+
+    std::vector<VectorXd> projected(dimensions_ ? M : 0);
+    for (size_t ii = 0; ii < projected.size(); ii++)
+      Project(dimensions_, queries[ii], projected[ii]);
+    const std::vector<VectorXd>& points = dimensions_ ? projected : queries;
+
+    // Mean, V = inv(L) K_X*, and the marginal variances.
+    MatrixXd cross;
+    CrossCovariance(queries, cross);
+    mean.noalias() = cross.transpose() * regressed_;
+    Whiten(cross);
+
+    const VectorXd variances =
+      VectorXd::Ones(M) - cross.colwise().squaredNorm().transpose();
+
+    // Columns of the covariance are only formed at the pivots.
+    const PivotedCholesky::ConstPtr cholesky = PivotedCholesky::Create(
+      variances, [&](size_t jj, VectorXd& column) {
+        MatrixXd prior;
+        CrossCovariance(*kernel_, points, nullptr,
+                        std::vector<VectorXd>(1, points[jj]), prior);
+        prior(jj, 0) = 1.0;
+
+        column.noalias() = prior.col(0) - cross.transpose() * cross.col(jj);
+      }, tolerance, max_rank);
+
+    factor = cholesky->Factor();
+    diagonal = cholesky->ResidualDiagonal();
+  }
+
+  // Cross covariance of a batch of query points against training points.
+  void ModelSnapshot::CrossCovariance(const Kernel& kernel,
+                                      const std::vector<VectorXd>& points,
+                                      const ConstDimensions& dimensions,
+                                      const std::vector<VectorXd>& queries,
+                                      MatrixXd& cross) {
+    const size_t N = points.size();
+    cross.resize(N, queries.size());
+    if (N == 0)
+      return;
+
+    VectorXd projected;
+    if (!kernel.SupportsSquaredDifferences()) {
+      for (size_t jj = 0; jj < queries.size(); jj++) {
+        const VectorXd& x = Project(dimensions, queries[jj], projected);
+
+        for (size_t ii = 0; ii < N; ii++)
+          cross(ii, jj) = kernel.Evaluate(points[ii], x);
+      }
+
+      return;
+    }
+
+    // Training points as rows, so that the squared differences against each
+    // query are computed (and the kernel evaluated) a whole column at once.
+    const size_t D = points[0].size();
+    MatrixXd rows(N, D);
+    for (size_t ii = 0; ii < N; ii++)
+      rows.row(ii) = points[ii].transpose();
+
+    MatrixXd squared_differences(N, D);
+    VectorXd values(N);
+    for (size_t jj = 0; jj < queries.size(); jj++) {
+      const VectorXd& x = Project(dimensions, queries[jj], projected);
+
+      squared_differences = (rows.rowwise() - x.transpose()).cwiseAbs2();
+      kernel.EvaluateSquaredDifferences(squared_differences, values);
+      cross.col(jj) = values;
+    }
+  }
+
+  // Project a point onto the given active dimensions.
+  const VectorXd& ModelSnapshot::Project(const ConstDimensions& dimensions,
+                                         const VectorXd& x,
+                                         VectorXd& projected) {
+    if (!dimensions)
+      return x;
+
+    projected.resize(dimensions->size());
+    for (size_t ii = 0; ii < dimensions->size(); ii++)
+      projected(ii) = x(dimensions->at(ii));
+
+    return projected;
+  }
+
+}  //\namespace gp
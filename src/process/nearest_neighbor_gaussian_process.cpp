@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the NearestNeighborGaussianProcess class, a Vecchia approximation
+// to a GP for large training sets. Points are put in maxmin order (each point
+// is the one farthest from all of the points before it), and each target is
+// conditioned only on the targets of its m nearest earlier points, which
+// gives a sparse inverse Cholesky factor of the covariance with m entries per
+// column. Neighbors are found with k-d trees, and the log-likelihood (see
+// VecchiaLogLikelihood) costs O(N m^3) and is evaluated in parallel.
+// Predictions condition on the m nearest training points of each query.
+// See Katzfuss and Guinness, "A General Framework for Vecchia Approximations
+// of Gaussian Processes" (Statistical Science, 2021).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/nearest_neighbor_gaussian_process.hpp>
+#include <optimization/cost_functors.hpp>
+
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <queue>
+#include <utility>
+
+namespace gp {
+
+  // Factory method.
+  NearestNeighborGaussianProcess::Ptr NearestNeighborGaussianProcess::Create(
+    const Kernel::Ptr& kernel, double noise,
+    const std::vector<VectorXd>& points, const VectorXd& targets,
+    size_t num_neighbors, size_t num_threads) {
+    Ptr ptr(new NearestNeighborGaussianProcess(kernel, noise, points, targets,
+                                               num_neighbors, num_threads));
+    return ptr;
+  }
+
+  // Constructor.
+  NearestNeighborGaussianProcess::NearestNeighborGaussianProcess(
+    const Kernel::Ptr& kernel, double noise,
+    const std::vector<VectorXd>& points, const VectorXd& targets,
+    size_t num_neighbors, size_t num_threads)
+    : kernel_(kernel),
+      noise_(noise),
+      num_neighbors_(num_neighbors),
+      points_(new std::vector<VectorXd>),
+      targets_(targets.size()),
+      pool_(ThreadPool::Create(num_threads)) {
+    CHECK_NOTNULL(kernel_.get());
+    CHECK_GT(noise_, 0.0);
+    CHECK_GE(num_neighbors_, 1);
+    CHECK_GE(points.size(), 1);
+    CHECK_EQ(points.size(), targets.size());
+
+    // Order the points.
+    MaxMinOrdering(points, *KdTree::Create(points), ordering_);
+
+    points_->reserve(points.size());
+    for (size_t ii = 0; ii < ordering_.size(); ii++) {
+      points_->push_back(points[ordering_[ii]]);
+      targets_(ii) = targets(ordering_[ii]);
+    }
+
+    tree_ = KdTree::Create(*points_);
+    FindConditioningSets();
+  }
+
+  // Evaluate mean and variance at a point.
+  void NearestNeighborGaussianProcess::Evaluate(const VectorXd& x,
+                                                double& mean,
+                                                double& variance) const {
+    std::vector<size_t> neighbors;
+    tree_->Nearest(x, num_neighbors_, neighbors);
+
+    // Exact GP prediction from the neighbors.
+    const size_t M = neighbors.size();
+    MatrixXd covariance(M, M);
+    VectorXd cross(M);
+    VectorXd targets(M);
+    for (size_t ii = 0; ii < M; ii++) {
+      const VectorXd& point = points_->at(neighbors[ii]);
+      covariance(ii, ii) = 1.0 + noise_;
+      cross(ii) = kernel_->Evaluate(point, x);
+      targets(ii) = targets_(neighbors[ii]);
+
+      for (size_t jj = 0; jj < ii; jj++) {
+        covariance(ii, jj) =
+          kernel_->Evaluate(point, points_->at(neighbors[jj]));
+        covariance(jj, ii) = covariance(ii, jj);
+      }
+    }
+
+    const Eigen::LLT<MatrixXd> llt(covariance);
+    mean = cross.dot(llt.solve(targets));
+    variance = 1.0 - cross.dot(llt.solve(cross));
+  }
+
+  // Twice the negative Vecchia log-likelihood.
+  bool NearestNeighborGaussianProcess::Objective(double* cost,
+                                                 VectorXd* gradient) const {
+    CHECK_NOTNULL(cost);
+    const VecchiaLogLikelihood likelihood(points_, targets_, conditioning_,
+                                          *kernel_, noise_, pool_);
+    if (gradient)
+      gradient->resize(likelihood.NumParameters());
+
+    return likelihood.Objective(kernel_->ImmutableParams().data(), cost,
+                                gradient ? gradient->data() : NULL);
+  }
+
+  // Learn kernel hyperparameters.
+  bool NearestNeighborGaussianProcess::LearnHyperparams(bool warm_start) {
+    if (!warm_start)
+      hyperparam_state_.Reset();
+
+    const VecchiaLogLikelihood likelihood(points_, targets_, conditioning_,
+                                          *kernel_, noise_, pool_);
+    VectorXd parameters = kernel_->ImmutableParams();
+    const bool success = Lbfgs::Minimize(likelihood, Lbfgs::Options(),
+                                         parameters.data(),
+                                         &hyperparam_state_);
+    kernel_->Reset(parameters);
+    return success;
+  }
+
+  // Compute the maxmin ordering. Each point's distance to the nearest
+  // ordered point only changes when a point within that distance is ordered,
+  // and since points are ordered in decreasing order of that distance, only
+  // points within the distance of the newly ordered point need updating.
+  // Outdated entries are left in the queue and skipped.
+  void NearestNeighborGaussianProcess::MaxMinOrdering(
+    const std::vector<VectorXd>& points, const KdTree& tree,
+    std::vector<size_t>& ordering) {
+    const size_t N = points.size();
+
+    VectorXd centroid = VectorXd::Zero(points.front().size());
+    for (size_t ii = 0; ii < N; ii++)
+      centroid += points[ii] / N;
+
+    std::vector<size_t> neighbors;
+    tree.Nearest(centroid, 1, neighbors);
+
+    VectorXd distances =
+      VectorXd::Constant(N, std::numeric_limits<double>::infinity());
+    std::vector<bool> ordered(N, false);
+    std::priority_queue< std::pair<double, size_t> > queue;
+    queue.push(std::make_pair(distances(neighbors[0]), neighbors[0]));
+
+    ordering.clear();
+    ordering.reserve(N);
+    while (ordering.size() < N) {
+      CHECK(!queue.empty());
+      const double distance = queue.top().first;
+      const size_t point = queue.top().second;
+      queue.pop();
+
+      if (ordered[point] || distance != distances(point))
+        continue;
+
+      ordered[point] = true;
+      ordering.push_back(point);
+
+      tree.Radius(points[point], distance, neighbors);
+      for (size_t ii = 0; ii < neighbors.size(); ii++) {
+        const size_t neighbor = neighbors[ii];
+        if (ordered[neighbor])
+          continue;
+
+        const double neighbor_distance =
+          (points[neighbor] - points[point]).norm();
+        if (neighbor_distance < distances(neighbor)) {
+          distances(neighbor) = neighbor_distance;
+          queue.push(std::make_pair(neighbor_distance, neighbor));
+        }
+      }
+    }
+  }
+
+  // Find the conditioning sets. Points in [2^k, 2^(k+1)) search a tree over
+  // the first 2^(k+1) points for their nearest earlier points, so at least
+  // half of the points in each tree are eligible, and building all of the
+  // trees takes O(N log N) time.
+  void NearestNeighborGaussianProcess::FindConditioningSets() {
+    const size_t N = points_->size();
+    conditioning_.resize(N);
+
+    // The first few points condition on all of the earlier points.
+    size_t begin = std::min(N, num_neighbors_ + 1);
+    for (size_t ii = 0; ii < begin; ii++) {
+      conditioning_[ii].resize(ii);
+      for (size_t jj = 0; jj < ii; jj++)
+        conditioning_[ii][jj] = jj;
+    }
+
+    while (begin < N) {
+      const size_t end = std::min(N, 2 * begin);
+      const KdTree::ConstPtr tree = KdTree::Create(*points_, end);
+
+      const size_t num_chunks = std::min(end - begin, pool_->NumThreads());
+      ThreadPool::TaskGroup group;
+      for (size_t ii = 0; ii < num_chunks; ii++) {
+        pool_->Schedule([&, ii]() {
+          for (size_t jj = begin + ii * (end - begin) / num_chunks;
+               jj < begin + (ii + 1) * (end - begin) / num_chunks; jj++)
+            tree->Nearest(points_->at(jj), num_neighbors_, conditioning_[jj],
+                          [jj](size_t kk) { return kk < jj; });
+        }, group);
+      }
+
+      pool_->Wait(group);
+      begin = end;
+    }
+  }
+
+}  //\namespace gp
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the NoiseSweep class, which evaluates a GP at many noise levels
+// from one symmetric eigendecomposition of the noise free covariance matrix
+// K0 = Q diag(lambda) Q^T. Since K0 + noise I = Q diag(lambda + noise) Q^T,
+// the training log-likelihood costs O(N) per noise level, and the regressed
+// targets and predictions cost O(N^2), rather than an O(N^3) factorization.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/noise_sweep.hpp>
+
+#include <Eigen/Eigenvalues>
+#include <math.h>
+
+namespace gp {
+
+  // Factory method.
+  NoiseSweep::Ptr NoiseSweep::Create(const Kernel& kernel,
+                                     const std::vector<VectorXd>& points,
+                                     const VectorXd& targets) {
+    Ptr ptr(new NoiseSweep(kernel, points, targets));
+    return ptr;
+  }
+
+  // Constructor.
+  NoiseSweep::NoiseSweep(const Kernel& kernel,
+                         const std::vector<VectorXd>& points,
+                         const VectorXd& targets)
+    : kernel_(kernel.Clone()),
+      points_(points) {
+    CHECK_GE(points_.size(), 1);
+    CHECK_EQ(points_.size(), targets.size());
+
+    // Noise free covariance. As in GaussianProcess, the diagonal is one.
+    const size_t N = points_.size();
+    MatrixXd covariance(N, N);
+    for (size_t ii = 0; ii < N; ii++) {
+      covariance(ii, ii) = 1.0;
+
+      for (size_t jj = 0; jj < ii; jj++) {
+        covariance(ii, jj) = kernel_->Evaluate(points_[ii], points_[jj]);
+        covariance(jj, ii) = covariance(ii, jj);
+      }
+    }
+
+    // Decompose. Clamp eigenvalues which are slightly negative due to
+    // roundoff, since the covariance is positive semidefinite.
+    const Eigen::SelfAdjointEigenSolver<MatrixXd> eigen(covariance);
+    CHECK(eigen.info() == Eigen::Success);
+
+    eigenvalues_ = eigen.eigenvalues().cwiseMax(0.0);
+    eigenvectors_ = eigen.eigenvectors();
+    projected_targets_.noalias() = eigenvectors_.transpose() * targets;
+  }
+
+  // Twice the negative log-likelihood at the given noise variance.
+  double NoiseSweep::Objective(double noise) const {
+    CHECK_GT(noise, 0.0);
+
+    double objective = 0.0;
+    for (size_t ii = 0; ii < NumPoints(); ii++) {
+      const double eigenvalue = eigenvalues_(ii) + noise;
+      objective += projected_targets_(ii) * projected_targets_(ii) /
+        eigenvalue + std::log(eigenvalue);
+    }
+
+    return objective;
+  }
+
+  void NoiseSweep::Objectives(const std::vector<double>& noises,
+                              std::vector<double>& objectives) const {
+    objectives.resize(noises.size());
+    for (size_t ii = 0; ii < noises.size(); ii++)
+      objectives[ii] = Objective(noises[ii]);
+  }
+
+  // Find the best noise variance in the given range.
+  double NoiseSweep::Learn(double min_noise, double max_noise,
+                           size_t num_samples) const {
+    CHECK_GT(min_noise, 0.0);
+    CHECK_GT(max_noise, min_noise);
+    CHECK_GE(num_samples, 2);
+
+    // Grid search in log space.
+    const double log_min = std::log(min_noise);
+    const double log_step =
+      (std::log(max_noise) - log_min) / static_cast<double>(num_samples - 1);
+
+    size_t best = 0;
+    double best_objective = Objective(min_noise);
+    for (size_t ii = 1; ii < num_samples; ii++) {
+      const double objective = Objective(std::exp(log_min + ii * log_step));
+      if (objective < best_objective) {
+        best = ii;
+        best_objective = objective;
+      }
+    }
+
+    // Golden section search between the neighbors of the best grid point.
+    const double kGoldenRatio = 0.5 * (std::sqrt(5.0) - 1.0);
+    const double kTolerance = 1e-6;
+
+    double lower = log_min + log_step * ((best > 0) ? best - 1 : 0);
+    double upper = log_min + log_step *
+      ((best + 1 < num_samples) ? best + 1 : num_samples - 1);
+    double left = upper - kGoldenRatio * (upper - lower);
+    double right = lower + kGoldenRatio * (upper - lower);
+    double left_objective = Objective(std::exp(left));
+    double right_objective = Objective(std::exp(right));
+
+    while (upper - lower > kTolerance) {
+      if (left_objective < right_objective) {
+        upper = right;
+        right = left;
+        right_objective = left_objective;
+        left = upper - kGoldenRatio * (upper - lower);
+        left_objective = Objective(std::exp(left));
+      } else {
+        lower = left;
+        left = right;
+        left_objective = right_objective;
+        right = lower + kGoldenRatio * (upper - lower);
+        right_objective = Objective(std::exp(right));
+      }
+    }
+
+    // The grid point may still be better if the minimum is on the boundary.
+    const double refined = std::exp(0.5 * (lower + upper));
+    return (Objective(refined) < best_objective) ?
+      refined : std::exp(log_min + best * log_step);
+  }
+
+  // Regressed targets, inv(K0 + noise I) targets.
+  void NoiseSweep::RegressedTargets(double noise, VectorXd& regressed) const {
+    CHECK_GT(noise, 0.0);
+
+    const VectorXd scaled = projected_targets_.cwiseQuotient(
+      (eigenvalues_.array() + noise).matrix());
+    regressed.noalias() = eigenvectors_ * scaled;
+  }
+
+  // Evaluate mean and variance at a point for the given noise variance.
+  void NoiseSweep::Evaluate(const VectorXd& x, double noise,
+                            double& mean, double& variance) const {
+    CHECK_GT(noise, 0.0);
+
+    // Cross covariance, in the eigenbasis.
+    VectorXd cross(NumPoints());
+    for (size_t ii = 0; ii < NumPoints(); ii++)
+      cross(ii) = kernel_->Evaluate(points_[ii], x);
+
+    const VectorXd projected_cross = eigenvectors_.transpose() * cross;
+    const VectorXd inverse_eigenvalues =
+      (eigenvalues_.array() + noise).inverse().matrix();
+
+    mean = projected_cross.dot(
+      projected_targets_.cwiseProduct(inverse_eigenvalues));
+    variance = 1.0 - projected_cross.cwiseAbs2().dot(inverse_eigenvalues);
+  }
+
+  // Quadratic form against the inverse covariance.
+  double NoiseSweep::InverseQuadratic(double noise, const VectorXd& b) const {
+    CHECK_GT(noise, 0.0);
+    CHECK_EQ(b.size(), NumPoints());
+
+    const VectorXd projected = eigenvectors_.transpose() * b;
+    return projected.cwiseAbs2().dot(
+      (eigenvalues_.array() + noise).inverse().matrix());
+  }
+
+  // Whiten the columns of 'b' in place.
+  void NoiseSweep::Whiten(double noise, MatrixXd& b) const {
+    CHECK_GT(noise, 0.0);
+    CHECK_EQ(b.rows(), NumPoints());
+
+    const VectorXd scales =
+      (eigenvalues_.array() + noise).sqrt().inverse().matrix();
+    const MatrixXd projected = eigenvectors_.transpose() * b;
+    b.noalias() = scales.asDiagonal() * projected;
+  }
+
+}  //\namespace gp
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PosteriorSampler class, which draws joint samples of the
+// (noise free) function from the posterior of a GP model snapshot at a batch
+// of M query points. For moderate M, samples are drawn exactly: one multi
+// RHS triangular solve gives the M x M predictive covariance, whose Cholesky
+// factor colors standard normal draws, for O(N^2 M + N M^2 + M^3) time.
+// For large M, samples are drawn pathwise with Matheron's rule: a sample f of
+// the prior, approximated with random Fourier features, is updated by the
+// posterior mean of the residuals y - f(X) - noise, so the cost is linear in
+// M. See Wilson et al., "Efficiently Sampling Functions from Gaussian Process
+// Posteriors" (ICML 2020). Either way, samples are drawn in batches in
+// parallel on a thread pool, which may be shared with other samplers.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/posterior_sampler.hpp>
+#include <kernels/rbf_kernel.hpp>
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+
+namespace gp {
+
+  // Factory method.
+  PosteriorSampler::Ptr PosteriorSampler::Create(
+    const ModelSnapshot::ConstPtr& snapshot, const Options& options) {
+    Ptr ptr(new PosteriorSampler(snapshot, options));
+    return ptr;
+  }
+
+  // Constructor.
+  PosteriorSampler::PosteriorSampler(const ModelSnapshot::ConstPtr& snapshot,
+                                     const Options& options)
+    : snapshot_(snapshot),
+      options_(options),
+      pool_(options.pool ? options.pool :
+            ThreadPool::Create(options.num_threads)) {
+    CHECK_NOTNULL(snapshot_.get());
+    CHECK_GE(options_.num_features, 1);
+    CHECK_GE(options_.batch_size, 1);
+    CHECK_GT(options_.jitter, 0.0);
+
+    // Targets y = K * inv(K) * y.
+    const Eigen::LLT<MatrixXd>& llt = snapshot_->ImmutableCholesky();
+    targets_ = llt.matrixL() *
+      (llt.matrixU() * snapshot_->ImmutableRegressedTargets());
+  }
+
+  // Which method would be used for the given number of query points.
+  PosteriorSampler::Method PosteriorSampler::Choose(size_t num_points) const {
+    if (options_.method == EXACT || !SupportsPathwise())
+      return EXACT;
+    if (options_.method == PATHWISE)
+      return PATHWISE;
+
+    return (num_points <= options_.max_exact_points) ? EXACT : PATHWISE;
+  }
+
+  // Whether the kernel supports pathwise sampling.
+  bool PosteriorSampler::SupportsPathwise() const {
+    return dynamic_cast<const RbfKernel*>(
+      snapshot_->ImmutableKernel().get()) != nullptr;
+  }
+
+  // Draw joint samples at the given points.
+  bool PosteriorSampler::Sample(const std::vector<VectorXd>& points,
+                                size_t num_samples, MatrixXd& samples) const {
+    CHECK_GE(points.size(), 1);
+
+    samples.resize(points.size(), num_samples);
+    if (num_samples == 0)
+      return true;
+
+    if (Choose(points.size()) == EXACT) {
+      if (SampleExact(points, num_samples, samples))
+        return true;
+
+      if (!SupportsPathwise()) {
+        LOG(WARNING) << "Predictive covariance is not positive semidefinite.";
+        return false;
+      }
+
+      LOG(WARNING) << "Predictive covariance is not positive semidefinite. "
+                   << "Sampling pathwise instead.";
+    }
+
+    SamplePathwise(points, num_samples, samples);
+    return true;
+  }
+
+  // Draw samples exactly, from the joint predictive mean and the Cholesky
+  // factor of the joint predictive covariance.
+  bool PosteriorSampler::SampleExact(const std::vector<VectorXd>& points,
+                                     size_t num_samples,
+                                     MatrixXd& samples) const {
+    const size_t M = points.size();
+
+    VectorXd mean;
+    MatrixXd covariance;
+    snapshot_->EvaluateJoint(points, mean, covariance);
+
+    // Factor, adding jitter until the covariance is positive definite.
+    Eigen::LLT<MatrixXd> factor;
+    bool factored = false;
+    for (double jitter = options_.jitter; jitter < 1.0 && !factored;
+         jitter *= 10.0) {
+      covariance.diagonal().array() += jitter;
+      factor.compute(covariance);
+      factored = (factor.info() == Eigen::Success);
+    }
+
+    if (!factored)
+      return false;
+
+    // Color standard normal draws, a batch of samples at a time.
+    std::random_device rd;
+    ThreadPool::TaskGroup group;
+    for (size_t begin = 0; begin < num_samples;
+         begin += options_.batch_size) {
+      const unsigned int seed = rd();
+      pool_->Schedule([&, begin, seed]() {
+        const size_t count = std::min(options_.batch_size,
+                                      num_samples - begin);
+        std::default_random_engine rng(seed);
+        std::normal_distribution<double> gaussian(0.0, 1.0);
+
+        MatrixXd draws(M, count);
+        for (size_t jj = 0; jj < count; jj++)
+          for (size_t ii = 0; ii < M; ii++)
+            draws(ii, jj) = gaussian(rng);
+
+        samples.middleCols(begin, count).noalias() =
+          factor.matrixL() * draws;
+        samples.middleCols(begin, count).colwise() += mean;
+      }, group);
+    }
+
+    pool_->Wait(group);
+    return true;
+  }
+
+  // Draw samples pathwise. With random Fourier features phi(x) =
+  // sqrt(2 / F) cos(W^T (x / l) + b), where the columns of W are standard
+  // normal and b is uniform on [0, 2 pi], a prior sample is phi(x)^T w for
+  // standard normal weights w. Each posterior sample is then
+  // f(x) + k(x, X) inv(K) (y - f(X) - e), with e drawn from the noise.
+  void PosteriorSampler::SamplePathwise(const std::vector<VectorXd>& points,
+                                        size_t num_samples,
+                                        MatrixXd& samples) const {
+    const size_t M = points.size();
+    const size_t F = options_.num_features;
+    const std::vector<VectorXd>& training = *snapshot_->ImmutablePoints();
+    const size_t N = training.size();
+    const VectorXd& lengths = snapshot_->ImmutableKernel()->ImmutableParams();
+    const Eigen::LLT<MatrixXd>& llt = snapshot_->ImmutableCholesky();
+
+    // Random features, shared by all samples in this call.
+    std::random_device rd;
+    std::default_random_engine rng(rd());
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+    std::uniform_real_distribution<double> unif(0.0, 2.0 * M_PI);
+
+    MatrixXd frequencies(lengths.size(), F);
+    VectorXd phases(F);
+    for (size_t ii = 0; ii < F; ii++) {
+      for (size_t jj = 0; jj < lengths.size(); jj++)
+        frequencies(jj, ii) = gaussian(rng) / lengths(jj);
+      phases(ii) = unif(rng);
+    }
+
+    // Features at the training and query points, one row per point.
+    const double scale = std::sqrt(2.0 / F);
+    MatrixXd training_features(N, F);
+    for (size_t ii = 0; ii < N; ii++) {
+      training_features.row(ii) = scale *
+        (frequencies.transpose() * training[ii] + phases).array().cos()
+        .matrix().transpose();
+    }
+
+    VectorXd projected;
+    MatrixXd query_features(M, F);
+    for (size_t ii = 0; ii < M; ii++) {
+      const VectorXd& x =
+        ModelSnapshot::Project(snapshot_->ActiveDimensions(), points[ii],
+                               projected);
+      query_features.row(ii) = scale *
+        (frequencies.transpose() * x + phases).array().cos()
+        .matrix().transpose();
+    }
+
+    MatrixXd cross;
+    snapshot_->CrossCovariance(points, cross);
+
+    // Draw batches of samples in parallel.
+    const double noise_deviation = std::sqrt(snapshot_->Noise());
+    ThreadPool::TaskGroup group;
+    for (size_t begin = 0; begin < num_samples;
+         begin += options_.batch_size) {
+      const unsigned int seed = rd();
+      pool_->Schedule([&, begin, seed]() {
+        const size_t count = std::min(options_.batch_size,
+                                      num_samples - begin);
+        std::default_random_engine rng(seed);
+        std::normal_distribution<double> gaussian(0.0, 1.0);
+
+        MatrixXd weights(F, count);
+        MatrixXd residuals(N, count);
+        for (size_t jj = 0; jj < count; jj++) {
+          for (size_t ii = 0; ii < F; ii++)
+            weights(ii, jj) = gaussian(rng);
+          for (size_t ii = 0; ii < N; ii++)
+            residuals(ii, jj) = targets_(ii) - noise_deviation * gaussian(rng);
+        }
+
+        residuals.noalias() -= training_features * weights;
+        llt.solveInPlace(residuals);
+
+        samples.middleCols(begin, count).noalias() =
+          query_features * weights;
+        samples.middleCols(begin, count).noalias() +=
+          cross.transpose() * residuals;
+      }, group);
+    }
+
+    pool_->Wait(group);
+  }
+
+}  //\namespace gp
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the KdTree class, a static k-d tree over a set of points for k
+// nearest neighbor and fixed radius queries. Each node splits its points at
+// the median of the dimension in which they are most spread out, down to
+// small leaves which are searched exhaustively. Queries skip any subtree on
+// the far side of a splitting plane which is farther than the current
+// search radius, so they take roughly O(log N) time in moderate dimension.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <utils/kd_tree.hpp>
+
+#include <algorithm>
+
+namespace gp {
+
+  // Factory method.
+  KdTree::Ptr KdTree::Create(const std::vector<VectorXd>& points,
+                             size_t num_points) {
+    Ptr ptr(new KdTree(points, num_points));
+    return ptr;
+  }
+
+  // Constructor.
+  KdTree::KdTree(const std::vector<VectorXd>& points, size_t num_points) {
+    num_points = std::min(num_points, points.size());
+    CHECK_GE(num_points, 1);
+
+    points_.resize(points.front().size(), num_points);
+    order_.resize(num_points);
+    for (size_t ii = 0; ii < num_points; ii++) {
+      CHECK_EQ(points[ii].size(), points_.rows());
+      points_.col(ii) = points[ii];
+      order_[ii] = ii;
+    }
+
+    Build(0, num_points);
+  }
+
+  // Build the subtree over [begin, end) of the permutation.
+  int KdTree::Build(size_t begin, size_t end) {
+    const int index = nodes_.size();
+    nodes_.push_back(Node());
+    nodes_[index].begin = begin;
+    nodes_[index].end = end;
+    nodes_[index].left = -1;
+    nodes_[index].right = -1;
+
+    if (end - begin <= kLeafSize)
+      return index;
+
+    // Split at the median of the dimension with the largest spread.
+    VectorXd lower = points_.col(order_[begin]);
+    VectorXd upper = lower;
+    for (size_t ii = begin + 1; ii < end; ii++) {
+      lower = lower.cwiseMin(points_.col(order_[ii]));
+      upper = upper.cwiseMax(points_.col(order_[ii]));
+    }
+
+    size_t dimension;
+    (upper - lower).maxCoeff(&dimension);
+
+    const size_t middle = begin + (end - begin) / 2;
+    std::nth_element(order_.begin() + begin, order_.begin() + middle,
+                     order_.begin() + end, [&](size_t a, size_t b) {
+                       return points_(dimension, a) < points_(dimension, b);
+                     });
+
+    nodes_[index].dimension = dimension;
+    nodes_[index].split = points_(dimension, order_[middle]);
+
+    // Children are built after this node, so 'nodes_' may be reallocated.
+    const int left = Build(begin, middle);
+    const int right = Build(middle, end);
+    nodes_[index].left = left;
+    nodes_[index].right = right;
+    return index;
+  }
+
+  // Find the k nearest points to x.
+  void KdTree::Nearest(const VectorXd& x, size_t k,
+                       std::vector<size_t>& neighbors,
+                       const Filter& filter) const {
+    CHECK_EQ(x.size(), points_.rows());
+
+    std::vector< std::pair<double, size_t> > heap;
+    heap.reserve(k + 1);
+    if (k > 0)
+      Nearest(0, x, k, filter, heap);
+
+    std::sort_heap(heap.begin(), heap.end());
+    neighbors.resize(heap.size());
+    for (size_t ii = 0; ii < heap.size(); ii++)
+      neighbors[ii] = heap[ii].second;
+  }
+
+  void KdTree::Nearest(int index, const VectorXd& x, size_t k,
+                       const Filter& filter,
+                       std::vector< std::pair<double, size_t> >& heap) const {
+    const Node& node = nodes_[index];
+
+    // Search leaves exhaustively.
+    if (node.left < 0) {
+      for (size_t ii = node.begin; ii < node.end; ii++) {
+        const size_t point = order_[ii];
+        if (filter && !filter(point))
+          continue;
+
+        const double squared_distance =
+          (points_.col(point) - x).squaredNorm();
+        if (heap.size() < k || squared_distance < heap.front().first) {
+          heap.push_back(std::make_pair(squared_distance, point));
+          std::push_heap(heap.begin(), heap.end());
+
+          if (heap.size() > k) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+          }
+        }
+      }
+
+      return;
+    }
+
+    // Search the near side first, and the far side only if the splitting
+    // plane is closer than the k'th nearest point found so far.
+    const double difference = x(node.dimension) - node.split;
+    const int near = (difference < 0.0) ? node.left : node.right;
+    const int far = (difference < 0.0) ? node.right : node.left;
+
+    Nearest(near, x, k, filter, heap);
+    if (heap.size() < k || difference * difference < heap.front().first)
+      Nearest(far, x, k, filter, heap);
+  }
+
+  // Find all points within the given distance of x.
+  void KdTree::Radius(const VectorXd& x, double radius,
+                      std::vector<size_t>& neighbors) const {
+    CHECK_EQ(x.size(), points_.rows());
+    CHECK_GE(radius, 0.0);
+
+    neighbors.clear();
+    Radius(0, x, radius * radius, neighbors);
+  }
+
+  void KdTree::Radius(int index, const VectorXd& x, double squared_radius,
+                      std::vector<size_t>& neighbors) const {
+    const Node& node = nodes_[index];
+
+    if (node.left < 0) {
+      for (size_t ii = node.begin; ii < node.end; ii++) {
+        if ((points_.col(order_[ii]) - x).squaredNorm() <= squared_radius)
+          neighbors.push_back(order_[ii]);
+      }
+
+      return;
+    }
+
+    const double difference = x(node.dimension) - node.split;
+    if (difference <= 0.0 || difference * difference <= squared_radius)
+      Radius(node.left, x, squared_radius, neighbors);
+    if (difference >= 0.0 || difference * difference <= squared_radius)
+      Radius(node.right, x, squared_radius, neighbors);
+  }
+
+}  //\namespace gp
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PivotedCholesky class, a greedy low rank factorization
+// A ~= L L^T of a symmetric positive semidefinite matrix, which only needs
+// the diagonal of A and the columns of A at the chosen pivots. Each step
+// pivots on the largest remaining diagonal entry of the residual A - L L^T,
+// so rank r costs O(N r^2) time and r column evaluations. The residual
+// diagonal bounds the error: the residual is itself positive semidefinite,
+// so each of its entries is at most the geometric mean of its two diagonal
+// entries. For a covariance matrix, the residual diagonal is the variance of
+// each variable given the pivots, so the pivots form a representative subset.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <utils/pivoted_cholesky.hpp>
+
+#include <algorithm>
+#include <math.h>
+
+namespace gp {
+
+  // Factory method.
+  PivotedCholesky::Ptr PivotedCholesky::Create(const VectorXd& diagonal,
+                                               const ColumnFunction& column,
+                                               double tolerance,
+                                               size_t max_rank) {
+    Ptr ptr(new PivotedCholesky(diagonal, column, tolerance, max_rank));
+    return ptr;
+  }
+
+  // Constructor. Factors greedily.
+  PivotedCholesky::PivotedCholesky(const VectorXd& diagonal,
+                                   const ColumnFunction& column,
+                                   double tolerance, size_t max_rank)
+    : residual_(diagonal) {
+    CHECK(column);
+    CHECK_GE(tolerance, 0.0);
+    CHECK_GE(diagonal.size(), 1);
+
+    const size_t N = diagonal.size();
+    max_rank = std::min(max_rank, N);
+
+    // Columns of L, kept separately until the rank is known.
+    std::vector<VectorXd> columns;
+    VectorXd values(N);
+    while (pivots_.size() < max_rank) {
+      size_t pivot;
+      const double pivot_residual = residual_.maxCoeff(&pivot);
+      if (pivot_residual <= tolerance || pivot_residual <= 0.0)
+        break;
+
+      // New column of L: the residual's column at the pivot, scaled.
+      column(pivot, values);
+      CHECK_EQ(values.size(), N);
+      for (size_t jj = 0; jj < columns.size(); jj++)
+        values -= columns[jj](pivot) * columns[jj];
+      values /= std::sqrt(pivot_residual);
+
+      // Previous pivots are already exact; zero out roundoff there.
+      for (size_t jj = 0; jj < pivots_.size(); jj++)
+        values(pivots_[jj]) = 0.0;
+
+      residual_ -= values.cwiseAbs2();
+      residual_ = residual_.cwiseMax(0.0);
+      residual_(pivot) = 0.0;
+
+      pivots_.push_back(pivot);
+      columns.push_back(values);
+    }
+
+    factor_.resize(N, columns.size());
+    for (size_t jj = 0; jj < columns.size(); jj++)
+      factor_.col(jj) = columns[jj];
+  }
+
+}  //\namespace gp
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PredictionCache class, a bounded-memory concurrent cache of GP
+// predictions keyed on a quantization of the query point. Points which fall
+// in the same cell of a grid with the given resolution share a prediction.
+// The cache is split into independently locked shards, each with its own LRU
+// eviction list. Entries are keyed on their owner (e.g. a model) as well as
+// the point, so that several models may share a cache, and every entry is
+// tagged with the owner's version it was computed at so that updating the
+// model invalidates it automatically.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <utils/prediction_cache.hpp>
+
+#include <math.h>
+
+namespace gp {
+
+  // Factory method.
+  PredictionCache::Ptr PredictionCache::Create(double resolution,
+                                               size_t capacity,
+                                               size_t num_shards) {
+    Ptr ptr(new PredictionCache(resolution, capacity, num_shards));
+    return ptr;
+  }
+
+  // Constructor.
+  PredictionCache::PredictionCache(double resolution, size_t capacity,
+                                   size_t num_shards)
+    : resolution_(resolution),
+      shard_capacity_((capacity + num_shards - 1) / num_shards),
+      hits_(0),
+      misses_(0) {
+    CHECK_GT(resolution_, 0.0);
+    CHECK_GE(capacity, 1);
+    CHECK_GE(num_shards, 1);
+
+    for (size_t ii = 0; ii < num_shards; ii++)
+      shards_.push_back(std::unique_ptr<Shard>(new Shard));
+  }
+
+  // Identity for a new owner of cache entries.
+  uint64_t PredictionCache::NewOwner() {
+    static std::atomic<uint64_t> num_owners(0);
+    return num_owners++;
+  }
+
+  // Look up the prediction for the cell containing 'x'.
+  bool PredictionCache::Lookup(const VectorXd& x, uint64_t owner,
+                               uint64_t version,
+                               double& mean, double& variance) {
+    Key key;
+    if (!Quantize(x, owner, key)) {
+      misses_++;
+      return false;
+    }
+
+    Shard& shard = FindShard(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto iter = shard.index.find(key);
+    if (iter == shard.index.end()) {
+      misses_++;
+      return false;
+    }
+
+    // Drop stale entries. Entries from a newer version are kept, since the
+    // caller is only reading an older snapshot.
+    if (iter->second->version != version) {
+      if (iter->second->version < version) {
+        shard.lru.erase(iter->second);
+        shard.index.erase(iter);
+      }
+
+      misses_++;
+      return false;
+    }
+
+    // Move to the front of the LRU list.
+    shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+    mean = iter->second->mean;
+    variance = iter->second->variance;
+    hits_++;
+    return true;
+  }
+
+  // Insert a prediction for the cell containing 'x'.
+  void PredictionCache::Insert(const VectorXd& x, uint64_t owner,
+                               uint64_t version,
+                               double mean, double variance) {
+    Key key;
+    if (!Quantize(x, owner, key))
+      return;
+
+    Shard& shard = FindShard(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto iter = shard.index.find(key);
+    if (iter != shard.index.end()) {
+      // Never replace a newer prediction with an older one.
+      if (iter->second->version > version)
+        return;
+
+      // Overwrite and move to the front.
+      iter->second->version = version;
+      iter->second->mean = mean;
+      iter->second->variance = variance;
+      shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+      return;
+    }
+
+    // Evict the least recently used entry if full.
+    if (shard.lru.size() >= shard_capacity_) {
+      shard.index.erase(shard.lru.back().key);
+      shard.lru.pop_back();
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.version = version;
+    entry.mean = mean;
+    entry.variance = variance;
+    shard.lru.push_front(entry);
+    shard.index[key] = shard.lru.begin();
+  }
+
+  // Drop all entries and reset counters.
+  void PredictionCache::Clear() {
+    for (size_t ii = 0; ii < shards_.size(); ii++) {
+      std::lock_guard<std::mutex> lock(shards_[ii]->mutex);
+      shards_[ii]->index.clear();
+      shards_[ii]->lru.clear();
+    }
+
+    hits_ = 0;
+    misses_ = 0;
+  }
+
+  // Total number of entries.
+  size_t PredictionCache::Size() const {
+    size_t size = 0;
+    for (size_t ii = 0; ii < shards_.size(); ii++) {
+      std::lock_guard<std::mutex> lock(shards_[ii]->mutex);
+      size += shards_[ii]->lru.size();
+    }
+
+    return size;
+  }
+
+  // Quantize an owner's point. Fails if a coordinate is not finite or its
+  // cell index does not fit in 63 bits.
+  bool PredictionCache::Quantize(const VectorXd& x, uint64_t owner,
+                                 Key& key) const {
+    const double kMaxCell = std::ldexp(1.0, 62);
+
+    key.resize(x.size() + 1);
+    key[0] = static_cast<int64_t>(owner);
+    for (size_t ii = 0; ii < x.size(); ii++) {
+      const double cell = std::floor(x(ii) / resolution_);
+      if (!(std::abs(cell) < kMaxCell))
+        return false;
+
+      key[ii + 1] = static_cast<int64_t>(cell);
+    }
+
+    return true;
+  }
+
+  // Find the shard for a key.
+  PredictionCache::Shard& PredictionCache::FindShard(const Key& key) {
+    // Use the high bits, since the low ones also pick the hash table bucket.
+    const uint64_t hash = KeyHash()(key);
+    return *shards_[(hash >> 32) % shards_.size()];
+  }
+
+  // Hash a quantized point (FNV-1a over the cell indices).
+  size_t PredictionCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t ii = 0; ii < key.size(); ii++) {
+      hash ^= static_cast<uint64_t>(key[ii]);
+      hash *= 0x100000001b3ULL;
+    }
+
+    // Fold the high bits into the low ones, which pick the bucket.
+    return static_cast<size_t>(hash ^ (hash >> 29));
+  }
+
+}  //\namespace gp
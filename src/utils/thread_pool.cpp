@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ThreadPool class, a fixed set of worker threads which run
+// scheduled tasks in FIFO order. Tasks are scheduled in groups, each of which
+// is waited on independently, so that several callers can share one pool.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <utils/thread_pool.hpp>
+
+#include <algorithm>
+
+namespace gp {
+
+  // Factory method.
+  ThreadPool::Ptr ThreadPool::Create(size_t num_threads) {
+    if (num_threads == 0)
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    Ptr ptr(new ThreadPool(num_threads));
+    return ptr;
+  }
+
+  // Constructor.
+  ThreadPool::ThreadPool(size_t num_threads)
+    : stopping_(false) {
+    CHECK_GE(num_threads, 1);
+
+    for (size_t ii = 0; ii < num_threads; ii++)
+      workers_.push_back(std::thread(&ThreadPool::Work, this));
+  }
+
+  // Finish all scheduled tasks, then join the workers.
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+
+    task_available_.notify_all();
+    for (size_t ii = 0; ii < workers_.size(); ii++)
+      workers_[ii].join();
+  }
+
+  // Schedule a task in the given group to run on one of the workers.
+  void ThreadPool::Schedule(const std::function<void()>& task,
+                            TaskGroup& group) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      CHECK(!stopping_);
+      tasks_.push_back(Task{task, &group});
+      group.num_unfinished_++;
+    }
+
+    task_available_.notify_one();
+  }
+
+  // Block until all tasks in the group have finished, helping out with the
+  // group's pending tasks in the meantime.
+  void ThreadPool::Wait(TaskGroup& group) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (group.num_unfinished_ > 0) {
+      const auto iter = std::find_if(tasks_.begin(), tasks_.end(),
+        [&group](const Task& task) { return task.group == &group; });
+
+      // Only tasks running on workers remain.
+      if (iter == tasks_.end()) {
+        group_finished_.wait(lock);
+        continue;
+      }
+
+      const Task task = *iter;
+      tasks_.erase(iter);
+      Run(task, lock);
+    }
+  }
+
+  // Run a task which has been taken off the queue, and mark it finished.
+  void ThreadPool::Run(const Task& task, std::unique_lock<std::mutex>& lock) {
+    lock.unlock();
+    task.function();
+    lock.lock();
+
+    if (--task.group->num_unfinished_ == 0)
+      group_finished_.notify_all();
+  }
+
+  // Body of each worker thread. Runs tasks until the pool is stopping and
+  // there is nothing left to do.
+  void ThreadPool::Work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      task_available_.wait(lock, [this]() {
+          return stopping_ || !tasks_.empty(); });
+
+      if (tasks_.empty())
+        return;
+
+      const Task task = tasks_.front();
+      tasks_.pop_front();
+      Run(task, lock);
+    }
+  }
+
+}  //\namespace gp
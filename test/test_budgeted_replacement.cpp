@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that the updated factorization and regressed targets match those of
+// a GP built from scratch on the same points after every replacement.
+TEST(BudgetedReplacement, TestMatchesRefactorization) {
+  const size_t kDimension = 2;
+  const size_t kMaxPoints = 30;
+  const size_t kNumNewPoints = 100;
+  const size_t kNumTestPoints = 10;
+  const double kNoiseVariance = 0.01;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.3));
+  GaussianProcess gp(kernel, kNoiseVariance, kDimension, kMaxPoints);
+
+  // Fill up, then keep adding.
+  for (size_t ii = 0; ii < kMaxPoints; ii++)
+    EXPECT_TRUE(gp.Add(VectorXd::Random(kDimension), unif(rng)));
+
+  EXPECT_FALSE(gp.Add(VectorXd::Random(kDimension), unif(rng)));
+  gp.SetBudgeted(true);
+
+  for (size_t ii = 0; ii < kNumNewPoints; ii++) {
+    const size_t num_replacements = gp.NumReplacements();
+    const bool stored = gp.Add(VectorXd::Random(kDimension), 5.0 * unif(rng));
+    EXPECT_EQ(gp.NumReplacements(), num_replacements + (stored ? 1 : 0));
+    EXPECT_EQ(gp.ImmutablePoints()->size(), kMaxPoints);
+
+    // Factorization matches the covariance.
+    const Eigen::LLT<MatrixXd>& llt = gp.ImmutableCholesky();
+    const MatrixXd covariance =
+      gp.ImmutableCovariance().topLeftCorner(kMaxPoints, kMaxPoints);
+    EXPECT_LE((llt.reconstructedMatrix() - covariance)
+              .lpNorm<Eigen::Infinity>(), kMaxError);
+
+    // Predictions match a fresh GP.
+    const GaussianProcess fresh(
+      kernel->Clone(), kNoiseVariance,
+      PointSet(new std::vector<VectorXd>(*gp.ImmutablePoints())),
+      gp.ImmutableTargets().head(kMaxPoints), kMaxPoints);
+
+    for (size_t jj = 0; jj < kNumTestPoints; jj++) {
+      const VectorXd x = VectorXd::Random(kDimension);
+
+      double mean, variance, fresh_mean, fresh_variance;
+      gp.Evaluate(x, mean, variance);
+      fresh.Evaluate(x, fresh_mean, fresh_variance);
+      EXPECT_NEAR(mean, fresh_mean, kMaxError);
+      EXPECT_NEAR(variance, fresh_variance, kMaxError);
+    }
+  }
+
+  EXPECT_GT(gp.NumReplacements(), 0);
+}
+
+// Start with all points bunched up at one end of the domain, then stream in
+// points from all over. With a fixed budget, replacement should spread the
+// points out and fit the function much better than discarding new points.
+// The RNG is seeded, since a late replacement can occasionally leave a gap
+// and the outcome of a single stream is only typical, not guaranteed.
+TEST(BudgetedReplacement, TestAccuracyImproves) {
+  const size_t kMaxPoints = 30;
+  const size_t kNumNewPoints = 1000;
+  const size_t kNumTestPoints = 100;
+  const double kNoiseVariance = 1e-3;
+  const double kLength = 0.1;
+  const unsigned int kSeed = 1;
+
+  // Random number generator.
+  std::default_random_engine rng(kSeed);
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kMaxPoints);
+  for (size_t ii = 0; ii < kMaxPoints; ii++) {
+    const double x = 0.2 * unif(rng);
+    points->push_back(VectorXd::Constant(1, x));
+    targets(ii) = BumpyParabola(x);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, kLength));
+  GaussianProcess fixed(kernel->Clone(), kNoiseVariance,
+                        PointSet(new std::vector<VectorXd>(*points)),
+                        targets, kMaxPoints);
+  GaussianProcess budgeted(kernel->Clone(), kNoiseVariance, points,
+                           targets, kMaxPoints);
+  budgeted.SetBudgeted(true);
+
+  for (size_t ii = 0; ii < kNumNewPoints; ii++) {
+    const double x = unif(rng);
+    EXPECT_FALSE(fixed.Add(VectorXd::Constant(1, x), BumpyParabola(x)));
+    budgeted.Add(VectorXd::Constant(1, x), BumpyParabola(x));
+  }
+
+  double fixed_error = 0.0;
+  double budgeted_error = 0.0;
+  double mean, variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const double x = unif(rng);
+
+    fixed.Evaluate(VectorXd::Constant(1, x), mean, variance);
+    fixed_error += (mean - BumpyParabola(x)) * (mean - BumpyParabola(x));
+    budgeted.Evaluate(VectorXd::Constant(1, x), mean, variance);
+    budgeted_error += (mean - BumpyParabola(x)) * (mean - BumpyParabola(x));
+  }
+
+  fixed_error = std::sqrt(fixed_error / kNumTestPoints);
+  budgeted_error = std::sqrt(budgeted_error / kNumTestPoints);
+  std::printf("RMS error %6.4f with a fixed set, %6.4f budgeted.\n",
+              fixed_error, budgeted_error);
+  EXPECT_LT(budgeted_error, 0.1 * fixed_error);
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for CommitteeGaussianProcess.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <optimization/cost_functors.hpp>
+#include <process/committee_gaussian_process.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/thread_pool.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Root mean square error of a committee against sin(6x) at random points,
+// checking that batch evaluation matches evaluating points one at a time.
+static double TestError(const CommitteeGaussianProcess& committee) {
+  const size_t kNumTestPoints = 200;
+
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    queries.push_back(VectorXd::Random(1));
+
+  std::vector<double> means, variances;
+  committee.Evaluate(queries, means, variances);
+
+  double squared_error = 0.0;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    double mean, variance;
+    committee.Evaluate(queries[ii], mean, variance);
+    EXPECT_NEAR(mean, means[ii], 1e-10);
+    EXPECT_NEAR(variance, variances[ii], 1e-10);
+    EXPECT_GT(variance, 0.0);
+    EXPECT_LE(variance, 1.0 + 1e-10);
+
+    const double error = mean - std::sin(6.0 * queries[ii](0));
+    squared_error += error * error;
+  }
+
+  return std::sqrt(squared_error / kNumTestPoints);
+}
+
+// Training data from sin(6x) on [-1, 1], with noise.
+static void TrainingData(size_t num_points, double noise,
+                         std::vector<VectorXd>& points, VectorXd& targets) {
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::normal_distribution<double> gaussian(0.0, std::sqrt(noise));
+
+  points.clear();
+  targets.resize(num_points);
+  for (size_t ii = 0; ii < num_points; ii++) {
+    points.push_back(VectorXd::Random(1));
+    targets(ii) = std::sin(6.0 * points.back()(0)) + gaussian(rng);
+  }
+}
+
+// Check that a single gPoE shard is just an exact GP.
+TEST(CommitteeGaussianProcess, TestSingleShard) {
+  const size_t kNumTrainingPoints = 100;
+  const double kNoise = 0.01;
+
+  std::vector<VectorXd> points;
+  VectorXd targets;
+  TrainingData(kNumTrainingPoints, kNoise, points, targets);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.3));
+  const CommitteeGaussianProcess::ConstPtr committee =
+    CommitteeGaussianProcess::Create(
+      kernel, kNoise, points, targets, 1,
+      CommitteeGaussianProcess::GENERALIZED_POE);
+  EXPECT_EQ(committee->NumShards(), 1);
+  EXPECT_EQ(committee->NumPoints(), kNumTrainingPoints);
+
+  const GaussianProcess exact(kernel->Clone(), kNoise,
+                              PointSet(new std::vector<VectorXd>(points)),
+                              targets, kNumTrainingPoints);
+  for (size_t ii = 0; ii < 20; ii++) {
+    const VectorXd x = VectorXd::Random(1);
+
+    double mean, variance, exact_mean, exact_variance;
+    committee->Evaluate(x, mean, variance);
+    exact.Evaluate(x, exact_mean, exact_variance);
+    EXPECT_NEAR(mean, exact_mean, 1e-8);
+    EXPECT_NEAR(variance, exact_variance, 1e-8);
+  }
+}
+
+// Check that both aggregations predict accurately from many shards, which
+// are large enough to be evaluated in parallel.
+TEST(CommitteeGaussianProcess, TestAggregation) {
+  const size_t kNumTrainingPoints = 2400;
+  const size_t kNumShards = 8;
+  const size_t kNumThreads = 4;
+  const double kNoise = 0.01;
+  const double kMaxError = 0.05;
+
+  std::vector<VectorXd> points;
+  VectorXd targets;
+  TrainingData(kNumTrainingPoints, kNoise, points, targets);
+
+  const CommitteeGaussianProcess::Ptr committee =
+    CommitteeGaussianProcess::Create(
+      RbfKernel::Create(VectorXd::Constant(1, 0.3)), kNoise, points,
+      targets, kNumShards, CommitteeGaussianProcess::ROBUST_BCM,
+      kNumThreads);
+
+  size_t num_points = 0;
+  for (size_t ii = 0; ii < kNumShards; ii++)
+    num_points += committee->Shard(ii).ImmutablePoints()->size();
+  EXPECT_EQ(num_points, kNumTrainingPoints);
+
+  EXPECT_LT(TestError(*committee), kMaxError);
+
+  committee->SetAggregation(CommitteeGaussianProcess::GENERALIZED_POE);
+  EXPECT_LT(TestError(*committee), kMaxError);
+}
+
+// Check that the committee likelihood of one shard is the training
+// likelihood, and that with several shards the log barrier on the shared
+// parameters is only counted once.
+TEST(CommitteeLogLikelihood, TestSingleBarrier) {
+  const size_t kNumTrainingPoints = 60;
+  const size_t kNumShards = 3;
+  const double kNoise = 0.01;
+  const double kMaxError = 1e-9;
+
+  std::vector<VectorXd> points;
+  VectorXd targets;
+  TrainingData(kNumTrainingPoints, kNoise, points, targets);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.3));
+  const ThreadPool::Ptr pool = ThreadPool::Create(2);
+  const VectorXd parameters = VectorXd::Constant(1, 0.2);
+
+  // One shard.
+  const PointSet all(new std::vector<VectorXd>(points));
+  const TrainingLogLikelihood training(all, &targets, kernel->Clone(),
+                                       kNoise);
+  const CommitteeLogLikelihood single(std::vector<PointSet>(1, all),
+                                      std::vector<VectorXd>(1, targets),
+                                      *kernel, kNoise, pool);
+
+  double cost, committee_cost;
+  VectorXd gradient(1), committee_gradient(1);
+  ASSERT_TRUE(training.Evaluate(parameters.data(), &cost, gradient.data()));
+  ASSERT_TRUE(single.Evaluate(parameters.data(), &committee_cost,
+                              committee_gradient.data()));
+  EXPECT_EQ(committee_cost, cost);
+  EXPECT_EQ(committee_gradient(0), gradient(0));
+
+  // Several shards. Each shard's training likelihood has its own barrier.
+  std::vector<PointSet> shard_points(kNumShards);
+  std::vector<VectorXd> shard_targets(kNumShards);
+  const size_t M = kNumTrainingPoints / kNumShards;
+  for (size_t ii = 0; ii < kNumShards; ii++) {
+    shard_points[ii].reset(new std::vector<VectorXd>(
+      points.begin() + ii * M, points.begin() + (ii + 1) * M));
+    shard_targets[ii] = targets.segment(ii * M, M);
+  }
+
+  double summed_cost = 0.0;
+  VectorXd summed_gradient = VectorXd::Zero(1);
+  for (size_t ii = 0; ii < kNumShards; ii++) {
+    const TrainingLogLikelihood shard(shard_points[ii], &shard_targets[ii],
+                                      kernel->Clone(), kNoise);
+    ASSERT_TRUE(shard.Evaluate(parameters.data(), &cost, gradient.data()));
+    summed_cost += cost;
+    summed_gradient += gradient;
+  }
+
+  double barrier = 0.0;
+  VectorXd barrier_gradient = VectorXd::Zero(1);
+  TrainingLogLikelihood::AddBarrier(parameters.data(), 1, &barrier,
+                                    barrier_gradient.data());
+
+  const CommitteeLogLikelihood committee(shard_points, shard_targets,
+                                         *kernel, kNoise, pool);
+  ASSERT_TRUE(committee.Evaluate(parameters.data(), &committee_cost,
+                                 committee_gradient.data()));
+  EXPECT_NEAR(committee_cost, summed_cost - (kNumShards - 1) * barrier,
+              kMaxError * std::abs(committee_cost));
+  EXPECT_NEAR(committee_gradient(0), summed_gradient(0) -
+              (kNumShards - 1) * barrier_gradient(0),
+              kMaxError * std::abs(committee_gradient(0)));
+}
+
+// Check that learning the shared kernel from a poor initial guess improves
+// predictions, and that every shard is refit.
+TEST(CommitteeGaussianProcess, TestLearnHyperparams) {
+  const size_t kNumTrainingPoints = 400;
+  const size_t kNumShards = 4;
+  const double kNoise = 0.01;
+
+  std::vector<VectorXd> points;
+  VectorXd targets;
+  TrainingData(kNumTrainingPoints, kNoise, points, targets);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 3.0));
+  const CommitteeGaussianProcess::Ptr committee =
+    CommitteeGaussianProcess::Create(kernel, kNoise, points, targets,
+                                     kNumShards);
+
+  const double error = TestError(*committee);
+  std::vector<uint64_t> versions;
+  for (size_t ii = 0; ii < kNumShards; ii++)
+    versions.push_back(committee->Shard(ii).Version());
+
+  EXPECT_TRUE(committee->LearnHyperparams());
+  EXPECT_LT(kernel->ImmutableParams()(0), 1.0);
+  EXPECT_LT(TestError(*committee), error);
+
+  for (size_t ii = 0; ii < kNumShards; ii++) {
+    EXPECT_GT(committee->Shard(ii).Version(), versions[ii]);
+    EXPECT_EQ(committee->Shard(ii).Snapshot()->ImmutableKernel()->
+              ImmutableParams(), kernel->ImmutableParams());
+  }
+}
+
+} //\namespace test
+} //\namespace gp
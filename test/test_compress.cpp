@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for compressing a GaussianProcess with a pivoted Cholesky
+// factorization.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/pivoted_cholesky.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that the factorization reproduces a small covariance matrix exactly
+// at full rank, and that its residual bounds the error at lower rank.
+TEST(PivotedCholesky, TestFactor) {
+  const size_t kNumPoints = 30;
+  const size_t kRank = 8;
+
+  const MatrixXd points = MatrixXd::Random(2, kNumPoints);
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(2, 0.5));
+  MatrixXd covariance(kNumPoints, kNumPoints);
+  for (size_t ii = 0; ii < kNumPoints; ii++)
+    for (size_t jj = 0; jj < kNumPoints; jj++)
+      covariance(ii, jj) = (ii == jj) ? 1.0 :
+        kernel->Evaluate(points.col(ii), points.col(jj));
+
+  const PivotedCholesky::ColumnFunction column =
+    [&covariance](size_t ii, VectorXd& values) {
+    values = covariance.col(ii);
+  };
+
+  const PivotedCholesky::ConstPtr full = PivotedCholesky::Create(
+    covariance.diagonal(), column, 0.0, kNumPoints);
+  const MatrixXd& factor = full->Factor();
+  EXPECT_LE((factor * factor.transpose() - covariance)
+            .lpNorm<Eigen::Infinity>(), 1e-8);
+
+  const PivotedCholesky::ConstPtr low = PivotedCholesky::Create(
+    covariance.diagonal(), column, 0.0, kRank);
+  EXPECT_EQ(low->Rank(), kRank);
+
+  const MatrixXd residual =
+    covariance - low->Factor() * low->Factor().transpose();
+  EXPECT_LE((residual.diagonal() - low->ResidualDiagonal())
+            .lpNorm<Eigen::Infinity>(), 1e-8);
+  for (size_t ii = 0; ii < kRank; ii++)
+    EXPECT_LE(residual.col(low->Pivots()[ii]).lpNorm<Eigen::Infinity>(),
+              1e-8);
+  for (size_t ii = 0; ii < kNumPoints; ii++)
+    for (size_t jj = 0; jj < kNumPoints; jj++)
+      EXPECT_LE(std::abs(residual(ii, jj)),
+                std::sqrt(low->ResidualDiagonal()(ii) *
+                          low->ResidualDiagonal()(jj)) + 1e-8);
+}
+
+// Check that a densely sampled model compresses to a much smaller one which
+// predicts nearly the same, faster, and that the summary is accurate.
+TEST(GaussianProcess, TestCompress) {
+  const size_t kNumTrainingPoints = 500;
+  const size_t kNumTestPoints = 1000;
+  const double kNoise = 0.01;
+  const double kTolerance = 1e-4;
+  const double kMaxError = 1e-2;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::normal_distribution<double> gaussian(0.0, std::sqrt(kNoise));
+
+  // Training data, with noise.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(1));
+    targets(ii) = std::sin(3.0 * points->back()(0)) + gaussian(rng);
+  }
+
+  const GaussianProcess gp(RbfKernel::Create(VectorXd::Constant(1, 0.3)),
+                           kNoise, points, targets, kNumTrainingPoints);
+
+  GaussianProcess::CompressionSummary summary;
+  const GaussianProcess::ConstPtr compressed =
+    gp.Compress(kTolerance, kNumTrainingPoints, &summary);
+  EXPECT_EQ(compressed->ImmutablePoints()->size(), summary.num_points);
+  EXPECT_LT(summary.num_points, kNumTrainingPoints / 10);
+  EXPECT_LE(summary.max_residual_variance, kTolerance);
+  EXPECT_LE(summary.max_mean_error, kMaxError);
+
+  // The summary matches the achieved error at the training points.
+  double max_error = 0.0;
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    double mean, variance, compressed_mean, compressed_variance;
+    gp.Evaluate(points->at(ii), mean, variance);
+    compressed->Evaluate(points->at(ii), compressed_mean,
+                         compressed_variance);
+    max_error = std::max(max_error, std::abs(mean - compressed_mean));
+  }
+  EXPECT_NEAR(max_error, summary.max_mean_error, 1e-6);
+
+  // Test points, and time evaluation.
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    queries.push_back(VectorXd::Random(1));
+
+  std::vector<double> means(kNumTestPoints);
+  std::vector<double> compressed_means(kNumTestPoints);
+  double variance;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    gp.Evaluate(queries[ii], means[ii], variance);
+  const auto middle = std::chrono::steady_clock::now();
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    compressed->Evaluate(queries[ii], compressed_means[ii], variance);
+  const auto end = std::chrono::steady_clock::now();
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    EXPECT_NEAR(means[ii], compressed_means[ii], kMaxError);
+
+  const double full_time =
+    std::chrono::duration<double>(middle - start).count();
+  const double compressed_time =
+    std::chrono::duration<double>(end - middle).count();
+  std::printf("Compressed %zu to %zu points: evaluation took %f s (full) "
+              "and %f s (compressed).\n", kNumTrainingPoints,
+              summary.num_points, full_time, compressed_time);
+}
+
+// Check that a budget is respected, and that larger budgets do no worse.
+TEST(GaussianProcess, TestCompressBudget) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 200;
+  const double kNoise = 0.01;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(2.0 * points->back()(0)) *
+      std::cos(points->back()(1));
+  }
+
+  const GaussianProcess gp(RbfKernel::Create(VectorXd::Constant(kDimension,
+                                                                0.5)),
+                           kNoise, points, targets, kNumTrainingPoints);
+
+  GaussianProcess::CompressionSummary previous;
+  for (size_t budget = 5; budget <= 40; budget *= 2) {
+    GaussianProcess::CompressionSummary summary;
+    const GaussianProcess::ConstPtr compressed =
+      gp.Compress(0.0, budget, &summary);
+    EXPECT_EQ(summary.num_points, budget);
+    EXPECT_EQ(compressed->ImmutablePoints()->size(), budget);
+
+    if (budget > 5) {
+      EXPECT_LE(summary.max_residual_variance,
+                previous.max_residual_variance);
+      EXPECT_LE(summary.rms_mean_error, previous.rms_mean_error + 1e-10);
+    }
+
+    previous = summary;
+  }
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for gradients and Hessians of the predictive mean and variance
+// with respect to the query point.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check the gradients and Hessians against central differences of Evaluate
+// and of the gradients, respectively.
+TEST(GaussianProcess, TestEvaluateWithGradient) {
+  const size_t kNumTrainingPoints = 200;
+  const size_t kNumTestPoints = 20;
+  const size_t kDimension = 3;
+  const double kNoise = 0.01;
+  const double kEpsilon = 1e-5;
+  const double kMaxError = 1e-5;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::normal_distribution<double> gaussian(0.0, std::sqrt(kNoise));
+
+  // Training data, with noise.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(3.0 * points->back()(0)) *
+      std::cos(2.0 * points->back()(1)) + points->back()(2) + gaussian(rng);
+  }
+
+  const GaussianProcess gp(
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5)), kNoise, points,
+    targets, kNumTrainingPoints);
+
+  for (size_t kk = 0; kk < kNumTestPoints; kk++) {
+    const VectorXd x = 1.2 * VectorXd::Random(kDimension);
+
+    double mean, variance;
+    VectorXd mean_gradient, variance_gradient;
+    MatrixXd mean_hessian, variance_hessian;
+    gp.EvaluateWithGradient(x, mean, variance, mean_gradient,
+                            variance_gradient, &mean_hessian,
+                            &variance_hessian);
+
+    // Values match Evaluate.
+    double expected_mean, expected_variance;
+    gp.Evaluate(x, expected_mean, expected_variance);
+    EXPECT_NEAR(mean, expected_mean, 1e-10);
+    EXPECT_NEAR(variance, expected_variance, 1e-10);
+
+    // Gradients without Hessians match those with.
+    VectorXd mean_gradient_only, variance_gradient_only;
+    gp.EvaluateWithGradient(x, mean, variance, mean_gradient_only,
+                            variance_gradient_only);
+    EXPECT_LE((mean_gradient_only - mean_gradient).cwiseAbs().maxCoeff(),
+              1e-10);
+    EXPECT_LE((variance_gradient_only - variance_gradient)
+              .cwiseAbs().maxCoeff(), 1e-10);
+
+    for (size_t ii = 0; ii < kDimension; ii++) {
+      const VectorXd step = kEpsilon * VectorXd::Unit(kDimension, ii);
+
+      double forward_mean, forward_variance;
+      double backward_mean, backward_variance;
+      VectorXd forward_mean_gradient, forward_variance_gradient;
+      VectorXd backward_mean_gradient, backward_variance_gradient;
+      gp.EvaluateWithGradient(x + step, forward_mean, forward_variance,
+                              forward_mean_gradient,
+                              forward_variance_gradient);
+      gp.EvaluateWithGradient(x - step, backward_mean, backward_variance,
+                              backward_mean_gradient,
+                              backward_variance_gradient);
+
+      EXPECT_NEAR(mean_gradient(ii), (forward_mean - backward_mean) /
+                  (2.0 * kEpsilon), kMaxError);
+      EXPECT_NEAR(variance_gradient(ii),
+                  (forward_variance - backward_variance) / (2.0 * kEpsilon),
+                  kMaxError);
+
+      EXPECT_LE((mean_hessian.col(ii) -
+                 (forward_mean_gradient - backward_mean_gradient) /
+                 (2.0 * kEpsilon)).cwiseAbs().maxCoeff(), kMaxError);
+      EXPECT_LE((variance_hessian.col(ii) -
+                 (forward_variance_gradient - backward_variance_gradient) /
+                 (2.0 * kEpsilon)).cwiseAbs().maxCoeff(), kMaxError);
+    }
+  }
+}
+
+} //\namespace test
+} //\namespace gp
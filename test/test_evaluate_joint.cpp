@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for joint predictive covariance.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Build a small GP on noisy samples of a sine wave, and some query points.
+static GaussianProcess::Ptr MakeProcess(std::vector<VectorXd>& queries) {
+  const size_t kNumTrainingPoints = 200;
+  const size_t kNumTestPoints = 100;
+  const double kNoise = 0.01;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::normal_distribution<double> gaussian(0.0, std::sqrt(kNoise));
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(2));
+    targets(ii) = std::sin(3.0 * points->back()(0)) *
+      std::cos(2.0 * points->back()(1)) + gaussian(rng);
+  }
+
+  queries.clear();
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    queries.push_back(1.2 * VectorXd::Random(2));
+
+  return GaussianProcess::Ptr(new GaussianProcess(
+    RbfKernel::Create(VectorXd::Constant(2, 0.4)), kNoise, points, targets,
+    kNumTrainingPoints));
+}
+
+// Check the joint covariance against Evaluate on the diagonal, and against
+// the textbook formula off the diagonal.
+TEST(GaussianProcess, TestEvaluateJoint) {
+  const double kMaxError = 1e-8;
+
+  std::vector<VectorXd> queries;
+  const GaussianProcess::ConstPtr gp = MakeProcess(queries);
+  const size_t M = queries.size();
+
+  VectorXd mean;
+  MatrixXd covariance;
+  gp->EvaluateJoint(queries, mean, covariance);
+  ASSERT_EQ(mean.size(), M);
+  ASSERT_EQ(covariance.rows(), M);
+  ASSERT_EQ(covariance.cols(), M);
+
+  for (size_t ii = 0; ii < M; ii++) {
+    double m, v;
+    gp->Evaluate(queries[ii], m, v);
+    EXPECT_NEAR(mean(ii), m, kMaxError);
+    EXPECT_NEAR(covariance(ii, ii), v, kMaxError);
+  }
+
+  // Textbook predictive covariance.
+  const Kernel& kernel = *gp->ImmutableKernel();
+  const std::vector<VectorXd>& points = *gp->ImmutablePoints();
+  MatrixXd cross(points.size(), M);
+  MatrixXd expected(M, M);
+  for (size_t ii = 0; ii < M; ii++) {
+    for (size_t jj = 0; jj < points.size(); jj++)
+      cross(jj, ii) = kernel.Evaluate(points[jj], queries[ii]);
+    for (size_t jj = 0; jj < M; jj++)
+      expected(ii, jj) = (ii == jj) ? 1.0 :
+        kernel.Evaluate(queries[ii], queries[jj]);
+  }
+
+  expected -= cross.transpose() * gp->ImmutableCholesky().solve(cross);
+  EXPECT_LE((covariance - expected).cwiseAbs().maxCoeff(), kMaxError);
+  EXPECT_TRUE(covariance == covariance.transpose());
+}
+
+// Check that the low rank covariance matches the full one up to the
+// residual, with exact marginal variances, and that it is exact at full rank.
+TEST(GaussianProcess, TestEvaluateJointLowRank) {
+  const size_t kMaxRank = 20;
+  const double kMaxError = 1e-8;
+
+  std::vector<VectorXd> queries;
+  const GaussianProcess::ConstPtr gp = MakeProcess(queries);
+  const size_t M = queries.size();
+
+  VectorXd mean;
+  MatrixXd covariance;
+  gp->EvaluateJoint(queries, mean, covariance);
+
+  VectorXd low_mean, diagonal;
+  MatrixXd factor;
+  gp->EvaluateJoint(queries, kMaxRank, 0.0, low_mean, factor, diagonal);
+  ASSERT_EQ(factor.rows(), M);
+  EXPECT_LE(factor.cols(), kMaxRank);
+  ASSERT_EQ(diagonal.size(), M);
+  EXPECT_LE((low_mean - mean).cwiseAbs().maxCoeff(), kMaxError);
+
+  // Marginal variances are exact, and off-diagonal errors are bounded by the
+  // residual variances.
+  const MatrixXd low_rank = factor * factor.transpose();
+  EXPECT_LE((low_rank.diagonal() + diagonal - covariance.diagonal())
+            .cwiseAbs().maxCoeff(), kMaxError);
+  for (size_t ii = 0; ii < M; ii++) {
+    EXPECT_GE(diagonal(ii), -kMaxError);
+    for (size_t jj = 0; jj < ii; jj++)
+      EXPECT_LE(std::abs(covariance(ii, jj) - low_rank(ii, jj)),
+                std::sqrt(std::max(0.0, diagonal(ii)) *
+                          std::max(0.0, diagonal(jj))) + kMaxError);
+  }
+
+  // At full rank, the factor reproduces the covariance.
+  gp->EvaluateJoint(queries, M, 0.0, low_mean, factor, diagonal);
+  EXPECT_LE((factor * factor.transpose() + MatrixXd(diagonal.asDiagonal()) -
+             covariance).cwiseAbs().maxCoeff(), 1e-6);
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <optimization/cost_functors.hpp>
+#include <optimization/fisher_scoring.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <Eigen/Eigenvalues>
+#include <ceres/ceres.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+namespace {
+  // Sample an ARD regression problem on [0, 1]^3, with a different length
+  // scale along each dimension.
+  void SampleProblem(size_t num_points, PointSet& points, VectorXd& targets) {
+    std::random_device rd;
+    std::default_random_engine rng(rd());
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    points.reset(new std::vector<VectorXd>);
+    targets.resize(num_points);
+    for (size_t ii = 0; ii < num_points; ii++) {
+      VectorXd x(3);
+      x << unif(rng), unif(rng), unif(rng);
+
+      points->push_back(x);
+      targets(ii) = BumpyParabola(x(0)) + 0.5 * std::sin(3.0 * x(1)) +
+        0.2 * x(2) * x(2);
+    }
+  }
+} //\namespace
+
+// Check that both information matrices are symmetric and positive definite,
+// and that the gradient matches the one from Evaluate.
+TEST(TrainingLogLikelihood, TestFisherInformation) {
+  const size_t kNumTrainingPoints = 30;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-10;
+
+  PointSet points;
+  VectorXd targets;
+  SampleProblem(kNumTrainingPoints, points, targets);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Ones(3));
+  TrainingLogLikelihood likelihood(points, &targets, kernel, kNoiseVariance);
+
+  double parameters[3] = { 0.3, 0.6, 0.9 };
+  double gradient[3], fisher_gradient[3];
+  double objective, fisher_objective;
+  MatrixXd fisher;
+  EXPECT_TRUE(likelihood.Evaluate(parameters, &objective, gradient));
+  EXPECT_TRUE(likelihood.EvaluateFisher(parameters, &fisher_objective,
+                                        fisher_gradient, fisher));
+  EXPECT_EQ(likelihood.NumFactorizations(), 1);
+
+  EXPECT_NEAR(objective, fisher_objective, kMaxError);
+  for (size_t ii = 0; ii < 3; ii++)
+    EXPECT_NEAR(gradient[ii], fisher_gradient[ii], kMaxError);
+
+  EXPECT_NEAR((fisher - fisher.transpose()).norm(), 0.0, kMaxError);
+  Eigen::SelfAdjointEigenSolver<MatrixXd> fisher_eigen(fisher);
+  EXPECT_GT(fisher_eigen.eigenvalues().minCoeff(), 0.0);
+
+  // Same for the average information.
+  double average_gradient[3];
+  double average_objective;
+  MatrixXd average;
+  EXPECT_TRUE(likelihood.EvaluateAverageInformation(
+                parameters, &average_objective, average_gradient, average));
+  EXPECT_EQ(likelihood.NumFactorizations(), 1);
+
+  EXPECT_NEAR(objective, average_objective, kMaxError);
+  for (size_t ii = 0; ii < 3; ii++)
+    EXPECT_NEAR(gradient[ii], average_gradient[ii], kMaxError);
+
+  EXPECT_NEAR((average - average.transpose()).norm(), 0.0, kMaxError);
+  Eigen::SelfAdjointEigenSolver<MatrixXd> average_eigen(average);
+  EXPECT_GT(average_eigen.eigenvalues().minCoeff(), 0.0);
+}
+
+// Check that Fisher scoring converges to a stationary point which is at
+// least as good as the one Ceres finds from the same start.
+TEST(FisherScoring, TestConvergence) {
+  const size_t kNumTrainingPoints = 60;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxGradient = 1e-2;
+  const double kMaxRelativeError = 1e-6;
+
+  PointSet points;
+  VectorXd targets;
+  SampleProblem(kNumTrainingPoints, points, targets);
+
+  // Fisher scoring.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(3, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+  EXPECT_TRUE(gp.LearnHyperparamsFisherScoring());
+
+  TrainingLogLikelihood likelihood(points, &targets,
+                                   RbfKernel::Create(VectorXd::Ones(3)),
+                                   kNoiseVariance);
+  VectorXd parameters = kernel->ImmutableParams();
+  VectorXd gradient(3);
+  double objective;
+  EXPECT_TRUE(likelihood.Evaluate(parameters.data(), &objective,
+                                  gradient.data()));
+  EXPECT_LT(gradient.lpNorm<Eigen::Infinity>(), kMaxGradient);
+
+  // Ceres, from the same start.
+  const Kernel::Ptr ceres_kernel =
+    RbfKernel::Create(VectorXd::Constant(3, 0.5));
+  GaussianProcess ceres_gp(ceres_kernel, kNoiseVariance, points, targets,
+                           kNumTrainingPoints);
+  EXPECT_TRUE(ceres_gp.LearnHyperparams());
+
+  VectorXd ceres_parameters = ceres_kernel->ImmutableParams();
+  double ceres_objective;
+  EXPECT_TRUE(likelihood.Evaluate(ceres_parameters.data(), &ceres_objective,
+                                  NULL));
+  EXPECT_LE(objective,
+            ceres_objective + kMaxRelativeError * std::abs(ceres_objective));
+}
+
+// Compare the number of factorizations and wall time of Fisher scoring (with
+// both information matrices) and of the Ceres L-BFGS setup used by
+// GaussianProcess::LearnHyperparams.
+TEST(FisherScoring, BenchmarkAgainstCeres) {
+  const size_t kNumTrainingPoints = 200;
+  const double kNoiseVariance = 1e-2;
+  const double kInitialLength = 0.5;
+
+  PointSet points;
+  VectorXd targets;
+  SampleProblem(kNumTrainingPoints, points, targets);
+
+  // Ceres.
+  TrainingLogLikelihood* ceres_likelihood =
+    new TrainingLogLikelihood(points, &targets,
+                              RbfKernel::Create(VectorXd::Ones(3)),
+                              kNoiseVariance);
+  ceres::GradientProblem problem(ceres_likelihood);
+
+  ceres::GradientProblemSolver::Summary ceres_summary;
+  ceres::GradientProblemSolver::Options options;
+  options.minimizer_progress_to_stdout = false;
+  options.max_num_iterations = 100;
+  options.max_num_line_search_step_size_iterations = 50;
+  options.max_num_line_search_direction_restarts = 25;
+  options.max_lbfgs_rank = 15;
+
+  double ceres_parameters[3] =
+    { kInitialLength, kInitialLength, kInitialLength };
+  const std::chrono::high_resolution_clock::time_point ceres_start =
+    std::chrono::high_resolution_clock::now();
+  ceres::Solve(options, problem, ceres_parameters, &ceres_summary);
+  const std::chrono::duration<double> ceres_time =
+    std::chrono::high_resolution_clock::now() - ceres_start;
+
+  std::printf("Ceres L-BFGS:        %3d iterations, %3zu factorizations, "
+              "%7.3f s, objective %.6f.\n",
+              ceres_summary.iterations, ceres_likelihood->NumFactorizations(),
+              ceres_time.count(), ceres_summary.final_cost);
+
+  // Fisher scoring, with each information matrix.
+  const FisherScoring::InformationType kInformationTypes[2] = {
+    FisherScoring::FISHER_INFORMATION, FisherScoring::AVERAGE_INFORMATION
+  };
+  const char* kInformationNames[2] = { "Fisher", "average" };
+
+  size_t num_factorizations[2];
+  for (size_t ii = 0; ii < 2; ii++) {
+    TrainingLogLikelihood likelihood(
+      points, &targets, RbfKernel::Create(VectorXd::Ones(3)),
+      kNoiseVariance);
+
+    FisherScoring::Options fisher_options;
+    fisher_options.information = kInformationTypes[ii];
+    FisherScoring::Summary summary;
+
+    double parameters[3] = { kInitialLength, kInitialLength, kInitialLength };
+    const std::chrono::high_resolution_clock::time_point start =
+      std::chrono::high_resolution_clock::now();
+    EXPECT_TRUE(FisherScoring::Minimize(likelihood, fisher_options,
+                                        parameters, &summary));
+    const std::chrono::duration<double> time =
+      std::chrono::high_resolution_clock::now() - start;
+
+    num_factorizations[ii] = likelihood.NumFactorizations();
+    std::printf("Scoring (%-7s):    %3zu iterations, %3zu factorizations, "
+                "%7.3f s, objective %.6f.\n", kInformationNames[ii],
+                summary.iterations, num_factorizations[ii], time.count(),
+                summary.final_objective);
+  }
+
+  EXPECT_LT(num_factorizations[1], num_factorizations[0]);
+}
+
+} //\namespace test
+} //\namespace gp
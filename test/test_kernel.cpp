@@ -88,6 +88,57 @@ TEST(RbfKernel, TestPartials) {
   }
 }
 
+// Make sure that the input gradient and Hessian are correct.
+TEST(RbfKernel, TestInputGradient) {
+  const double kMaxError = 1e-6;
+  const double kEpsilon = 1e-6;
+  const size_t kDimension = 10;
+  const size_t kNumTests = 10;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.5, 1.5);
+
+  // Create a kernel.
+  VectorXd lengths(kDimension);
+  for (size_t ii = 0; ii < kDimension; ii++)
+    lengths(ii) = unif(rng);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(lengths);
+  ASSERT_TRUE(kernel->SupportsInputGradient());
+
+  for (size_t jj = 0; jj < kNumTests; jj++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+    const VectorXd y = VectorXd::Random(kDimension);
+
+    // Compute analytic derivatives.
+    VectorXd gradient;
+    MatrixXd hessian;
+    kernel->InputGradient(x, y, kernel->Evaluate(x, y), gradient);
+    kernel->InputHessian(x, y, kernel->Evaluate(x, y), hessian);
+
+    // Compare to central differences of the kernel and of the gradient.
+    for (size_t ii = 0; ii < kDimension; ii++) {
+      const VectorXd step = kEpsilon * VectorXd::Unit(kDimension, ii);
+      const VectorXd forward = x + step;
+      const VectorXd backward = x - step;
+
+      EXPECT_NEAR(gradient(ii), (kernel->Evaluate(forward, y) -
+                                 kernel->Evaluate(backward, y)) /
+                  (2.0 * kEpsilon), kMaxError);
+
+      VectorXd forward_gradient, backward_gradient;
+      kernel->InputGradient(forward, y, kernel->Evaluate(forward, y),
+                            forward_gradient);
+      kernel->InputGradient(backward, y, kernel->Evaluate(backward, y),
+                            backward_gradient);
+      EXPECT_LE((hessian.col(ii) - (forward_gradient - backward_gradient) /
+                 (2.0 * kEpsilon)).cwiseAbs().maxCoeff(), kMaxError);
+    }
+  }
+}
+
 } //\namespace test
 
 } //\namespace gp
@@ -46,6 +46,8 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <gflags/gflags.h>
+#include <atomic>
+#include <future>
 #include <random>
 #include <vector>
 #include <math.h>
@@ -124,6 +126,106 @@ TEST(TrainingLogLikelihood, TestGradient) {
   }
 }
 
+// Check that TrainingLogLikelihood gives the same objective and gradient
+// whether or not it caches squared differences between training points.
+TEST(TrainingLogLikelihood, TestSquaredDifferenceCache) {
+  const size_t kDimension = 5;
+  const size_t kNumTrainingPoints = 20;
+  const size_t kNumTests = 10;
+  const double kMaxError = 1e-10;
+  const double kNoiseVariance = 0.1;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = unif(rng);
+  }
+
+  // One cost with a cache, and one without.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Ones(kDimension));
+  TrainingLogLikelihood cached(points, &targets, kernel, kNoiseVariance);
+  TrainingLogLikelihood uncached(points, &targets, kernel, kNoiseVariance, 0);
+  EXPECT_TRUE(cached.IsCached());
+  EXPECT_FALSE(uncached.IsCached());
+
+  double parameters[kDimension];
+  double cached_gradient[kDimension];
+  double uncached_gradient[kDimension];
+  for (size_t ii = 0; ii < kNumTests; ii++) {
+    for (size_t jj = 0; jj < kDimension; jj++)
+      parameters[jj] = 0.5 + unif(rng);
+
+    double cached_objective, uncached_objective;
+    EXPECT_TRUE(cached.Evaluate(parameters, &cached_objective,
+                                cached_gradient));
+    EXPECT_TRUE(uncached.Evaluate(parameters, &uncached_objective,
+                                  uncached_gradient));
+
+    EXPECT_NEAR(cached_objective, uncached_objective, kMaxError);
+    for (size_t jj = 0; jj < kDimension; jj++)
+      EXPECT_NEAR(cached_gradient[jj], uncached_gradient[jj], kMaxError);
+  }
+}
+
+// Check that TrainingLogLikelihood only refactors the covariance when the
+// parameters change, and that reusing the factorization gives the same
+// gradient as a fresh evaluation.
+TEST(TrainingLogLikelihood, TestMemoizedFactorization) {
+  const size_t kDimension = 3;
+  const size_t kNumTrainingPoints = 20;
+  const double kMaxError = 1e-10;
+  const double kNoiseVariance = 0.1;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = unif(rng);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Ones(kDimension));
+  TrainingLogLikelihood cost(points, &targets, kernel, kNoiseVariance);
+
+  // Evaluate the cost, then the gradient, at the same parameters.
+  double parameters[kDimension] = { 0.5, 1.0, 1.5 };
+  double gradient[kDimension];
+  double objective, memoized_objective;
+  EXPECT_TRUE(cost.Evaluate(parameters, &objective, NULL));
+  EXPECT_TRUE(cost.Evaluate(parameters, &memoized_objective, gradient));
+  EXPECT_EQ(cost.NumFactorizations(), 1);
+  EXPECT_EQ(objective, memoized_objective);
+
+  // Compare against a fresh evaluation.
+  TrainingLogLikelihood fresh_cost(points, &targets, kernel, kNoiseVariance);
+  double fresh_gradient[kDimension];
+  double fresh_objective;
+  EXPECT_TRUE(fresh_cost.Evaluate(parameters, &fresh_objective,
+                                  fresh_gradient));
+  EXPECT_NEAR(objective, fresh_objective, kMaxError);
+  for (size_t ii = 0; ii < kDimension; ii++)
+    EXPECT_NEAR(gradient[ii], fresh_gradient[ii], kMaxError);
+
+  // Changing the parameters refactors.
+  parameters[0] += 0.1;
+  EXPECT_TRUE(cost.Evaluate(parameters, &objective, gradient));
+  EXPECT_EQ(cost.NumFactorizations(), 2);
+}
+
 // Sample points from a simple function and fit a GP model. Make sure that
 // after learning hyperparameters for an RBF kernel, the GP improves its
 // root mean squared error against a random set of points.
@@ -194,5 +296,452 @@ TEST(GaussianProcess, TestLearnHyperparams) {
   }
 }
 
+// Check that asynchronous relearning finds the same hyperparameters as the
+// synchronous version, and reports completion through the future and callback.
+TEST(GaussianProcess, TestLearnHyperparamsAsync) {
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-8;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  // Train two identical GPs, one synchronously and one asynchronously.
+  const Kernel::Ptr sync_kernel = RbfKernel::Create(VectorXd::Constant(1, 0.5));
+  const Kernel::Ptr async_kernel = sync_kernel->Clone();
+  GaussianProcess sync_gp(sync_kernel, kNoiseVariance, points, targets,
+                          kNumTrainingPoints);
+  GaussianProcess async_gp(async_kernel, kNoiseVariance, points, targets,
+                           kNumTrainingPoints);
+
+  const bool sync_success = sync_gp.LearnHyperparams();
+
+  std::atomic<bool> callback_success(false);
+  std::future<bool> future = async_gp.LearnHyperparamsAsync(
+    0, [&callback_success](bool success) { callback_success = success; });
+
+  EXPECT_EQ(future.get(), sync_success);
+  EXPECT_EQ(callback_success.load(), sync_success);
+  EXPECT_NEAR(sync_kernel->ImmutableParams()(0),
+              async_kernel->ImmutableParams()(0), kMaxError);
+
+  // Check that both models agree.
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Constant(1, unif(rng));
+
+    double sync_mean, sync_variance, async_mean, async_variance;
+    sync_gp.Evaluate(x, sync_mean, sync_variance);
+    async_gp.Evaluate(x, async_mean, async_variance);
+    EXPECT_NEAR(sync_mean, async_mean, kMaxError);
+    EXPECT_NEAR(sync_variance, async_variance, kMaxError);
+
+    async_gp.Snapshot()->Evaluate(x, async_mean, async_variance);
+    EXPECT_NEAR(sync_mean, async_mean, kMaxError);
+    EXPECT_NEAR(sync_variance, async_variance, kMaxError);
+  }
+}
+
+// Check that points added while an asynchronous relearn is running end up in
+// the installed model, and that cancellation leaves the model intact.
+TEST(GaussianProcess, TestLearnHyperparamsAsyncStaleness) {
+  const size_t kNumInitialPoints = 40;
+  const size_t kNumAddedPoints = 20;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-8;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumInitialPoints);
+
+  for (size_t ii = 0; ii < kNumInitialPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumInitialPoints + kNumAddedPoints);
+
+  // Relearn while adding points.
+  std::future<bool> future = gp.LearnHyperparamsAsync(kNumAddedPoints);
+  for (size_t ii = 0; ii < kNumAddedPoints; ii++) {
+    const double x = unif(rng);
+    EXPECT_TRUE(gp.Add(VectorXd::Constant(1, x), BumpyParabola(x)));
+  }
+
+  EXPECT_TRUE(future.get());
+
+  // The installed model must match a model trained from scratch on all of
+  // the points with the learned hyperparameters.
+  const size_t N = gp.ImmutablePoints()->size();
+  EXPECT_EQ(N, kNumInitialPoints + kNumAddedPoints);
+  GaussianProcess reference(kernel->Clone(), kNoiseVariance,
+                            PointSet(new std::vector<VectorXd>(
+                              *gp.ImmutablePoints())),
+                            gp.ImmutableTargets().head(N), N);
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Constant(1, unif(rng));
+
+    double mean, variance, reference_mean, reference_variance;
+    gp.Evaluate(x, mean, variance);
+    reference.Evaluate(x, reference_mean, reference_variance);
+    EXPECT_NEAR(mean, reference_mean, kMaxError);
+    EXPECT_NEAR(variance, reference_variance, kMaxError);
+  }
+
+  // Cancelling must either install a complete model or leave it untouched.
+  const VectorXd params = kernel->ImmutableParams();
+  future = gp.LearnHyperparamsAsync();
+  gp.CancelLearnHyperparams();
+
+  if (!future.get())
+    EXPECT_EQ(kernel->ImmutableParams(), params);
+}
+
+// Check that an asynchronous relearn never overwrites kernel parameters set
+// synchronously while it was running.
+TEST(GaussianProcess, TestLearnHyperparamsAsyncSuperseded) {
+  const size_t kNumTrainingPoints = 300;
+  const double kNoiseVariance = 1e-3;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  // Start far from the optimum, so that the relearn takes a while, and take
+  // a single quick synchronous step meanwhile.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 3.0));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  std::future<bool> future = gp.LearnHyperparamsAsync();
+
+  FisherScoring::Options options;
+  options.max_iterations = 1;
+  gp.LearnHyperparamsFisherScoring(options);
+  const VectorXd params = kernel->ImmutableParams();
+
+  // Either the relearn finished before the synchronous step, which then
+  // started from its result, or it must have been discarded.
+  future.get();
+  EXPECT_EQ(kernel->ImmutableParams(), params);
+  EXPECT_EQ(gp.Snapshot()->ImmutableKernel()->ImmutableParams(), params);
+}
+
+// Check that warm started relearning on slowly growing data converges in a
+// few iterations, to the same solution as a cold start.
+TEST(GaussianProcess, TestLearnHyperparamsWarmStart) {
+  const size_t kNumInitialPoints = 60;
+  const size_t kNumRelearns = 5;
+  const size_t kNumPointsPerRelearn = 2;
+  const size_t kMaxWarmIterations = 10;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxRelativeError = 1e-3;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumInitialPoints);
+
+  for (size_t ii = 0; ii < kNumInitialPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.2));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumInitialPoints + kNumRelearns * kNumPointsPerRelearn);
+
+  // The first call starts from scratch.
+  EXPECT_TRUE(gp.LearnHyperparams(true));
+  EXPECT_GT(gp.HyperparamState().iterations, 0);
+
+  for (size_t ii = 0; ii < kNumRelearns; ii++) {
+    for (size_t jj = 0; jj < kNumPointsPerRelearn; jj++) {
+      const double x = unif(rng);
+      EXPECT_TRUE(gp.Add(VectorXd::Constant(1, x), BumpyParabola(x)));
+    }
+
+    EXPECT_TRUE(gp.LearnHyperparams(true));
+    EXPECT_LE(gp.HyperparamState().iterations, kMaxWarmIterations);
+  }
+
+  // Compare against a cold start with Ceres from the same point.
+  const size_t N = gp.ImmutablePoints()->size();
+  const double warm_length = kernel->ImmutableParams()(0);
+  const Kernel::Ptr cold_kernel = kernel->Clone();
+  GaussianProcess cold_gp(cold_kernel, kNoiseVariance,
+                          PointSet(new std::vector<VectorXd>(
+                            *gp.ImmutablePoints())),
+                          gp.ImmutableTargets().head(N), N);
+  EXPECT_TRUE(cold_gp.LearnHyperparams());
+  EXPECT_NEAR(cold_kernel->ImmutableParams()(0), warm_length,
+              kMaxRelativeError * warm_length);
+
+  // Changing the objective by other means discards the warm start state.
+  EXPECT_FALSE(gp.HyperparamState().s.empty());
+  gp.SetNoise(2.0 * kNoiseVariance);
+  EXPECT_TRUE(gp.HyperparamState().s.empty());
+}
+
+// Check that multi-start learning from a poor initial guess does at least as
+// well as a single start from the same guess.
+TEST(GaussianProcess, TestLearnHyperparamsMultiStart) {
+  const size_t kNumTrainingPoints = 40;
+  const size_t kNumStarts = 8;
+  const size_t kNumThreads = 4;
+  const double kMinLength = 0.01;
+  const double kMaxLength = 10.0;
+  const double kInitialLength = 5.0;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  // Learn from one start, and from many.
+  const Kernel::Ptr single_kernel =
+    RbfKernel::Create(VectorXd::Constant(1, kInitialLength));
+  GaussianProcess single_gp(single_kernel, kNoiseVariance, points, targets,
+                            kNumTrainingPoints);
+  EXPECT_TRUE(single_gp.LearnHyperparams());
+
+  const Kernel::Ptr multi_kernel =
+    RbfKernel::Create(VectorXd::Constant(1, kInitialLength));
+  GaussianProcess multi_gp(multi_kernel, kNoiseVariance, points, targets,
+                           kNumTrainingPoints);
+  EXPECT_TRUE(multi_gp.LearnHyperparamsMultiStart(
+                kNumStarts, kMinLength, kMaxLength, kNumThreads));
+
+  // Compare objectives.
+  TrainingLogLikelihood cost(points, &targets,
+                             RbfKernel::Create(VectorXd::Ones(1)),
+                             kNoiseVariance);
+
+  double single_objective, multi_objective;
+  double single_length = single_kernel->ImmutableParams()(0);
+  double multi_length = multi_kernel->ImmutableParams()(0);
+  EXPECT_TRUE(cost.Evaluate(&single_length, &single_objective, NULL));
+  EXPECT_TRUE(cost.Evaluate(&multi_length, &multi_objective, NULL));
+
+  EXPECT_GT(multi_length, 0.0);
+  EXPECT_LE(multi_objective, single_objective + kMaxError);
+
+  // The learned model should be installed.
+  double mean, variance;
+  multi_gp.Evaluate(points->front(), mean, variance);
+  EXPECT_NEAR(mean, targets(0), 0.1);
+}
+
+// Check that online adaptation moves the length scale from a poor initial
+// guess to one which predicts streaming data better, and that the model
+// stays consistent with the kernel as it changes.
+TEST(GaussianProcess, TestOnlineAdaptation) {
+  const size_t kNumInitialPoints = 10;
+  const size_t kNumStreamingPoints = 100;
+  const size_t kBatchSize = 5;
+  const size_t kNumTestPoints = 100;
+  const double kInitialLength = 0.01;
+  const double kLearningRate = 0.05;
+  const double kRefitThreshold = 0.1;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get initial training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumInitialPoints);
+
+  for (size_t ii = 0; ii < kNumInitialPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  // One model adapts, the other does not. They must not share points, since
+  // Add appends to them.
+  const size_t kMaxPoints = kNumInitialPoints + 2 * kNumStreamingPoints;
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(1, kInitialLength));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets, kMaxPoints);
+  gp.SetOnlineAdaptation(kLearningRate, kRefitThreshold);
+
+  GaussianProcess fixed_gp(
+    RbfKernel::Create(VectorXd::Constant(1, kInitialLength)),
+    kNoiseVariance, PointSet(new std::vector<VectorXd>(*points)), targets,
+    kMaxPoints);
+
+  // Stream points, one at a time and in batches.
+  for (size_t ii = 0; ii < kNumStreamingPoints; ii++) {
+    const double x = unif(rng);
+    EXPECT_TRUE(gp.Add(VectorXd::Constant(1, x), BumpyParabola(x)));
+    EXPECT_TRUE(fixed_gp.Add(VectorXd::Constant(1, x), BumpyParabola(x)));
+  }
+
+  std::vector<VectorXd> batch(kBatchSize);
+  VectorXd batch_targets(kBatchSize);
+  for (size_t ii = 0; ii < kNumStreamingPoints / kBatchSize; ii++) {
+    for (size_t jj = 0; jj < kBatchSize; jj++) {
+      batch[jj] = VectorXd::Constant(1, unif(rng));
+      batch_targets(jj) = BumpyParabola(batch[jj](0));
+    }
+
+    EXPECT_TRUE(gp.Add(batch, batch_targets));
+    EXPECT_TRUE(fixed_gp.Add(batch, batch_targets));
+  }
+
+  EXPECT_GT(kernel->ImmutableParams()(0), kInitialLength);
+
+  // The adapted model should predict held out points better.
+  double nll = 0.0;
+  double fixed_nll = 0.0;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Constant(1, unif(rng));
+    const double target = BumpyParabola(x(0));
+
+    double mean, variance;
+    gp.Evaluate(x, mean, variance);
+    variance += kNoiseVariance;
+    nll += 0.5 * std::log(variance) +
+      0.5 * (target - mean) * (target - mean) / variance;
+
+    fixed_gp.Evaluate(x, mean, variance);
+    variance += kNoiseVariance;
+    fixed_nll += 0.5 * std::log(variance) +
+      0.5 * (target - mean) * (target - mean) / variance;
+  }
+
+  EXPECT_LT(nll, fixed_nll);
+
+  // Compare against a model built from scratch with the final kernel.
+  const size_t N = gp.ImmutablePoints()->size();
+  GaussianProcess fresh_gp(kernel->Clone(), kNoiseVariance,
+                           PointSet(new std::vector<VectorXd>(
+                             *gp.ImmutablePoints())),
+                           gp.ImmutableTargets().head(N), N);
+
+  for (size_t ii = 0; ii < 10; ii++) {
+    const VectorXd x = VectorXd::Constant(1, unif(rng));
+    double mean, variance, fresh_mean, fresh_variance;
+    gp.Evaluate(x, mean, variance);
+    fresh_gp.Evaluate(x, fresh_mean, fresh_variance);
+    EXPECT_NEAR(mean, fresh_mean, kMaxError);
+    EXPECT_NEAR(variance, fresh_variance, kMaxError);
+  }
+}
+
+// Check that dimensions with huge length scales are pruned, and that the
+// pruned model still takes full dimensional queries and predicts like the
+// original one.
+TEST(GaussianProcess, TestPruneDimensions) {
+  const size_t kDimension = 6;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 50;
+  const double kNoiseVariance = 0.01;
+  const double kIrrelevantLength = 1e4;
+  const double kMaxError = 1e-3;
+
+  // Only even dimensions are relevant.
+  VectorXd lengths(kDimension);
+  for (size_t ii = 0; ii < kDimension; ii++)
+    lengths(ii) = (ii % 2 == 0) ? 0.5 : kIrrelevantLength;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(2.0 * points->back()(0)) + points->back()(2);
+  }
+
+  // Two models, only one of which will be pruned. The caller's kernel must
+  // keep all of its dimensions.
+  const Kernel::Ptr kernel = RbfKernel::Create(lengths);
+  GaussianProcess pruned(kernel, kNoiseVariance,
+                         PointSet(new std::vector<VectorXd>(*points)),
+                         targets, 2 * kNumTrainingPoints);
+  GaussianProcess original(RbfKernel::Create(lengths), kNoiseVariance,
+                           points, targets, 2 * kNumTrainingPoints);
+
+  EXPECT_EQ(pruned.PruneDimensions(), kDimension / 2);
+  EXPECT_EQ(pruned.PruneDimensions(), 0);
+  EXPECT_EQ(pruned.Dimension(), kDimension);
+  EXPECT_EQ(pruned.ImmutableKernel()->ImmutableParams().size(),
+            kDimension / 2);
+  EXPECT_EQ(pruned.ImmutablePoints()->at(0).size(), kDimension / 2);
+  EXPECT_EQ(kernel->ImmutableParams(), lengths);
+
+  const ConstDimensions& dimensions = pruned.ActiveDimensions();
+  ASSERT_TRUE(dimensions != nullptr);
+  for (size_t ii = 0; ii < dimensions->size(); ii++)
+    EXPECT_EQ(dimensions->at(ii), 2 * ii);
+
+  // Add the same full dimensional point to both.
+  const VectorXd x = VectorXd::Random(kDimension);
+  EXPECT_TRUE(pruned.Add(x, std::sin(2.0 * x(0)) + x(2)));
+  EXPECT_TRUE(original.Add(x, std::sin(2.0 * x(0)) + x(2)));
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd query = VectorXd::Random(kDimension);
+
+    double mean, variance, original_mean, original_variance;
+    original.Evaluate(query, original_mean, original_variance);
+
+    pruned.Evaluate(query, mean, variance);
+    EXPECT_NEAR(mean, original_mean, kMaxError);
+    EXPECT_NEAR(variance, original_variance, kMaxError);
+
+    pruned.Snapshot()->Evaluate(query, mean, variance);
+    EXPECT_NEAR(mean, original_mean, kMaxError);
+    EXPECT_NEAR(variance, original_variance, kMaxError);
+  }
+}
+
 } //\namespace test
 } //\namespace gp
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/mapped_gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace gp {
+namespace test {
+
+// Create an empty temporary file and return its name.
+std::string TemporaryFile() {
+  char name[] = "/tmp/gp_model_XXXXXX";
+  const int fd = mkstemp(name);
+  CHECK_GE(fd, 0);
+  close(fd);
+  return std::string(name);
+}
+
+// Check that a saved and mapped model evaluates exactly like the original.
+TEST(MappedGaussianProcess, TestRoundTrip) {
+  const size_t kDimension = 3;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-12;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  VectorXd lengths(kDimension);
+  for (size_t ii = 0; ii < kDimension; ii++)
+    lengths(ii) = 0.5 + unif(rng);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(lengths);
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     2 * kNumTrainingPoints);
+
+  // Save and map.
+  const std::string file = TemporaryFile();
+  ASSERT_TRUE(MappedGaussianProcess::Save(gp, file));
+
+  const MappedGaussianProcess::ConstPtr mapped =
+    MappedGaussianProcess::Load(file, true);
+  ASSERT_TRUE(mapped.get() != NULL);
+
+  EXPECT_EQ(mapped->Dimension(), kDimension);
+  EXPECT_EQ(mapped->NumPoints(), kNumTrainingPoints);
+  EXPECT_EQ(mapped->Noise(), kNoiseVariance);
+  EXPECT_EQ(mapped->ImmutableKernel()->ImmutableParams(), lengths);
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+
+    double mean, variance, mapped_mean, mapped_variance;
+    gp.Evaluate(x, mean, variance);
+    mapped->Evaluate(x, mapped_mean, mapped_variance);
+    EXPECT_NEAR(mean, mapped_mean, kMaxError);
+    EXPECT_NEAR(variance, mapped_variance, kMaxError);
+  }
+
+  unlink(file.c_str());
+}
+
+// Check that corrupt or truncated files are rejected.
+TEST(MappedGaussianProcess, TestCorruption) {
+  const size_t kNumTrainingPoints = 20;
+  const double kNoiseVariance = 1e-3;
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(1));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.1));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  const std::string file = TemporaryFile();
+  ASSERT_TRUE(MappedGaussianProcess::Save(gp, file));
+
+  // Read the raw bytes.
+  std::string bytes;
+  {
+    std::ifstream stream(file.c_str(), std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(stream),
+                 std::istreambuf_iterator<char>());
+  }
+
+  // Flip a byte in the Cholesky factor. The header is still valid, so only
+  // the checksum can detect it.
+  std::string corrupt = bytes;
+  corrupt[corrupt.size() - 1] ^= 0x1;
+  std::ofstream(file.c_str(), std::ios::binary) << corrupt;
+  EXPECT_TRUE(MappedGaussianProcess::Load(file, false).get() != NULL);
+  EXPECT_TRUE(MappedGaussianProcess::Load(file, true).get() == NULL);
+
+  // Truncate.
+  std::ofstream(file.c_str(), std::ios::binary) <<
+    bytes.substr(0, bytes.size() - 8);
+  EXPECT_TRUE(MappedGaussianProcess::Load(file, false).get() == NULL);
+
+  // Bad magic.
+  corrupt = bytes;
+  corrupt[0] = 'X';
+  std::ofstream(file.c_str(), std::ios::binary) << corrupt;
+  EXPECT_TRUE(MappedGaussianProcess::Load(file, false).get() == NULL);
+
+  // Missing file.
+  unlink(file.c_str());
+  EXPECT_TRUE(MappedGaussianProcess::Load(file, false).get() == NULL);
+}
+
+} //\namespace test
+} //\namespace gp
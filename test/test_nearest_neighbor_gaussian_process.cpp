@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for KdTree and NearestNeighborGaussianProcess.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/nearest_neighbor_gaussian_process.hpp>
+#include <utils/kd_tree.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check nearest neighbor and radius queries against brute force.
+TEST(KdTree, TestMatchesBruteForce) {
+  const size_t kDimension = 3;
+  const size_t kNumPoints = 500;
+  const size_t kNumQueries = 50;
+  const size_t kNumNeighbors = 10;
+  const double kRadius = 0.4;
+
+  std::vector<VectorXd> points;
+  for (size_t ii = 0; ii < kNumPoints; ii++)
+    points.push_back(VectorXd::Random(kDimension));
+
+  const KdTree::ConstPtr tree = KdTree::Create(points);
+  EXPECT_EQ(tree->NumPoints(), kNumPoints);
+
+  for (size_t ii = 0; ii < kNumQueries; ii++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+
+    std::vector< std::pair<double, size_t> > sorted;
+    for (size_t jj = 0; jj < kNumPoints; jj++)
+      sorted.push_back(std::make_pair((points[jj] - x).norm(), jj));
+    std::sort(sorted.begin(), sorted.end());
+
+    // Nearest neighbors, nearest first.
+    std::vector<size_t> neighbors;
+    tree->Nearest(x, kNumNeighbors, neighbors);
+    ASSERT_EQ(neighbors.size(), kNumNeighbors);
+    for (size_t jj = 0; jj < kNumNeighbors; jj++)
+      EXPECT_EQ(neighbors[jj], sorted[jj].second);
+
+    // Nearest even neighbors.
+    tree->Nearest(x, kNumNeighbors, neighbors,
+                  [](size_t kk) { return kk % 2 == 0; });
+    ASSERT_EQ(neighbors.size(), kNumNeighbors);
+    size_t num_found = 0;
+    for (size_t jj = 0; num_found < kNumNeighbors; jj++) {
+      if (sorted[jj].second % 2 == 0)
+        EXPECT_EQ(neighbors[num_found++], sorted[jj].second);
+    }
+
+    // Radius.
+    tree->Radius(x, kRadius, neighbors);
+    std::sort(neighbors.begin(), neighbors.end());
+    std::vector<size_t> expected;
+    for (size_t jj = 0; jj < kNumPoints && sorted[jj].first <= kRadius; jj++)
+      expected.push_back(sorted[jj].second);
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(neighbors, expected);
+  }
+}
+
+// Check that the ordering is a maxmin ordering, and that conditioning sets
+// are the nearest earlier points.
+TEST(NearestNeighborGaussianProcess, TestOrdering) {
+  const size_t kDimension = 2;
+  const size_t kNumPoints = 300;
+  const size_t kNumNeighbors = 8;
+
+  std::vector<VectorXd> points;
+  VectorXd targets(kNumPoints);
+  for (size_t ii = 0; ii < kNumPoints; ii++) {
+    points.push_back(VectorXd::Random(kDimension));
+    targets(ii) = points.back().sum();
+  }
+
+  const NearestNeighborGaussianProcess::ConstPtr nngp =
+    NearestNeighborGaussianProcess::Create(
+      RbfKernel::Create(VectorXd::Constant(kDimension, 0.5)), 0.01, points,
+      targets, kNumNeighbors);
+
+  // Permutation.
+  std::vector<size_t> ordering = nngp->Ordering();
+  std::sort(ordering.begin(), ordering.end());
+  for (size_t ii = 0; ii < kNumPoints; ii++)
+    EXPECT_EQ(ordering[ii], ii);
+
+  const std::vector<VectorXd>& ordered = *nngp->ImmutablePoints();
+  for (size_t ii = 0; ii < kNumPoints; ii++) {
+    EXPECT_EQ(ordered[ii], points[nngp->Ordering()[ii]]);
+    EXPECT_EQ(nngp->ImmutableTargets()(ii),
+              targets(nngp->Ordering()[ii]));
+  }
+
+  // Each point is (one of) the farthest from the points before it.
+  VectorXd distances = VectorXd::Constant(
+    kNumPoints, std::numeric_limits<double>::infinity());
+  for (size_t ii = 0; ii + 1 < kNumPoints; ii++) {
+    for (size_t jj = ii + 1; jj < kNumPoints; jj++)
+      distances(jj) = std::min(distances(jj),
+                               (ordered[jj] - ordered[ii]).norm());
+
+    EXPECT_NEAR(distances(ii + 1), distances.tail(kNumPoints - ii - 1)
+                .maxCoeff(), 1e-12);
+  }
+
+  // Conditioning sets.
+  for (size_t ii = 0; ii < kNumPoints; ii++) {
+    const std::vector<size_t>& conditioning = nngp->ConditioningSets()[ii];
+    ASSERT_EQ(conditioning.size(), std::min(ii, kNumNeighbors));
+
+    std::vector< std::pair<double, size_t> > sorted;
+    for (size_t jj = 0; jj < ii; jj++)
+      sorted.push_back(std::make_pair((ordered[jj] - ordered[ii]).norm(),
+                                      jj));
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<size_t> actual = conditioning;
+    std::vector<size_t> expected;
+    for (size_t jj = 0; jj < conditioning.size(); jj++)
+      expected.push_back(sorted[jj].second);
+    std::sort(actual.begin(), actual.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(actual, expected);
+  }
+}
+
+// With as many neighbors as points, the Vecchia approximation is exact.
+// Check the objective and predictions against an exact GP, and the gradient
+// against finite differences.
+TEST(NearestNeighborGaussianProcess, TestMatchesExact) {
+  const size_t kDimension = 2;
+  const size_t kNumPoints = 60;
+  const double kNoise = 0.01;
+  const double kStep = 1e-6;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumPoints);
+  for (size_t ii = 0; ii < kNumPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(2.0 * points->back()(0)) + points->back()(1);
+  }
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  const NearestNeighborGaussianProcess::ConstPtr nngp =
+    NearestNeighborGaussianProcess::Create(kernel, kNoise, *points, targets,
+                                           kNumPoints);
+  const GaussianProcess exact(kernel->Clone(), kNoise,
+                              PointSet(new std::vector<VectorXd>(*points)),
+                              targets, kNumPoints);
+
+  // Objective.
+  const Eigen::LLT<MatrixXd>& llt = exact.ImmutableCholesky();
+  double objective = targets.dot(exact.ImmutableRegressedTargets());
+  for (size_t ii = 0; ii < kNumPoints; ii++)
+    objective += 2.0 * std::log(llt.matrixLLT()(ii, ii));
+
+  double cost;
+  VectorXd gradient;
+  ASSERT_TRUE(nngp->Objective(&cost, &gradient));
+  EXPECT_NEAR(cost, objective, 1e-8 * std::abs(objective));
+
+  // Gradient.
+  for (size_t ii = 0; ii < kDimension; ii++) {
+    const double parameter = kernel->ImmutableParams()(ii);
+    double plus, minus;
+    kernel->Params()(ii) = parameter + kStep;
+    ASSERT_TRUE(nngp->Objective(&plus));
+    kernel->Params()(ii) = parameter - kStep;
+    ASSERT_TRUE(nngp->Objective(&minus));
+    kernel->Params()(ii) = parameter;
+
+    EXPECT_NEAR(gradient(ii), (plus - minus) / (2.0 * kStep),
+                1e-4 * std::max(1.0, std::abs(gradient(ii))));
+  }
+
+  // Predictions.
+  for (size_t ii = 0; ii < 20; ii++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+
+    double mean, variance, exact_mean, exact_variance;
+    nngp->Evaluate(x, mean, variance);
+    exact.Evaluate(x, exact_mean, exact_variance);
+    EXPECT_NEAR(mean, exact_mean, 1e-8);
+    EXPECT_NEAR(variance, exact_variance, 1e-8);
+  }
+}
+
+// Check that learning hyperparameters from a poor initial guess reduces the
+// objective and improves predictions on a larger data set.
+TEST(NearestNeighborGaussianProcess, TestLearnHyperparams) {
+  const size_t kDimension = 2;
+  const size_t kNumPoints = 2000;
+  const size_t kNumNeighbors = 15;
+  const size_t kNumTestPoints = 100;
+  const double kNoise = 0.01;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::normal_distribution<double> gaussian(0.0, std::sqrt(kNoise));
+
+  std::vector<VectorXd> points;
+  VectorXd targets(kNumPoints);
+  for (size_t ii = 0; ii < kNumPoints; ii++) {
+    points.push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(4.0 * points.back()(0)) *
+      std::cos(3.0 * points.back()(1)) + gaussian(rng);
+  }
+
+  const NearestNeighborGaussianProcess::Ptr nngp =
+    NearestNeighborGaussianProcess::Create(
+      RbfKernel::Create(VectorXd::Constant(kDimension, 3.0)), kNoise, points,
+      targets, kNumNeighbors);
+
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    queries.push_back(VectorXd::Random(kDimension));
+
+  const auto error = [&]() {
+    double squared_error = 0.0;
+    double mean, variance;
+    for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+      nngp->Evaluate(queries[ii], mean, variance);
+      squared_error += std::pow(mean - std::sin(4.0 * queries[ii](0)) *
+                                std::cos(3.0 * queries[ii](1)), 2);
+    }
+
+    return std::sqrt(squared_error / kNumTestPoints);
+  };
+
+  double initial_objective, objective;
+  ASSERT_TRUE(nngp->Objective(&initial_objective));
+  const double initial_error = error();
+
+  EXPECT_TRUE(nngp->LearnHyperparams());
+  ASSERT_TRUE(nngp->Objective(&objective));
+  EXPECT_LT(objective, initial_objective);
+  EXPECT_LT(error(), initial_error);
+  EXPECT_LT(error(), 0.05);
+}
+
+} //\namespace test
+} //\namespace gp
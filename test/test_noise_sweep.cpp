@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/noise_sweep.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that the objective, regressed targets, and predictions from the sweep
+// match a GP factored directly at each noise level.
+TEST(NoiseSweep, TestMatchesDirect) {
+  const size_t kDimension = 3;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 20;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Training data.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(3.0 * points->back()(0)) + 0.1 * unif(rng);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(kDimension,
+                                                                  0.5));
+  const NoiseSweep::ConstPtr sweep =
+    NoiseSweep::Create(*kernel, *points, targets);
+
+  for (double noise = 1e-3; noise < 10.0; noise *= 5.0) {
+    const GaussianProcess gp(kernel->Clone(), noise, points, targets,
+                             kNumTrainingPoints);
+
+    // Twice the negative log-likelihood, from the Cholesky factor.
+    const Eigen::LLT<MatrixXd>& llt = gp.ImmutableCholesky();
+    double logdet = 0.0;
+    for (size_t ii = 0; ii < kNumTrainingPoints; ii++)
+      logdet += 2.0 * std::log(llt.matrixLLT()(ii, ii));
+
+    const VectorXd& regressed = gp.ImmutableRegressedTargets();
+    const double objective = targets.dot(regressed) + logdet;
+    EXPECT_NEAR(sweep->Objective(noise), objective,
+                kMaxError * std::abs(objective));
+
+    VectorXd sweep_regressed;
+    sweep->RegressedTargets(noise, sweep_regressed);
+    EXPECT_LE((sweep_regressed - regressed).lpNorm<Eigen::Infinity>(),
+              kMaxError * regressed.lpNorm<Eigen::Infinity>());
+
+    for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+      const VectorXd x = VectorXd::Random(kDimension);
+
+      double mean, variance, sweep_mean, sweep_variance;
+      gp.Evaluate(x, mean, variance);
+      sweep->Evaluate(x, noise, sweep_mean, sweep_variance);
+
+      EXPECT_NEAR(sweep_mean, mean, kMaxError);
+      EXPECT_NEAR(sweep_variance, variance, kMaxError);
+    }
+  }
+}
+
+// Check that the learned noise is (close to) the best on a fine grid, and
+// that setting it from the sweep matches a GP built with that noise from
+// scratch, both before and after the next Add refactors.
+TEST(NoiseSweep, TestLearnNoise) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 100;
+  const size_t kNumTestPoints = 20;
+  const size_t kNumGridPoints = 1000;
+  const double kTrueNoise = 0.05;
+  const double kMinNoise = 1e-4;
+  const double kMaxNoise = 10.0;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::normal_distribution<double> gaussian(0.0, std::sqrt(kTrueNoise));
+
+  // Training data, with noise.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(2.0 * points->back()(0)) *
+      std::cos(points->back()(1)) + gaussian(rng);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(kDimension,
+                                                                  0.5));
+  GaussianProcess gp(kernel, 1.0, points, targets, kNumTrainingPoints + 1);
+  const uint64_t version = gp.Version();
+
+  const double noise = gp.LearnNoise(kMinNoise, kMaxNoise);
+  EXPECT_GE(noise, kMinNoise);
+  EXPECT_LE(noise, kMaxNoise);
+  EXPECT_EQ(gp.Noise(), noise);
+  EXPECT_GT(gp.Version(), version);
+
+  // Compare against a fine grid.
+  const NoiseSweep::ConstPtr sweep = gp.SweepNoise();
+  const double objective = sweep->Objective(noise);
+  const double log_step = std::log(kMaxNoise / kMinNoise) / kNumGridPoints;
+  for (size_t ii = 0; ii <= kNumGridPoints; ii++)
+    EXPECT_LE(objective,
+              sweep->Objective(kMinNoise * std::exp(ii * log_step)) + 1e-8);
+
+  // Compare against a fresh GP with the learned noise.
+  GaussianProcess fresh(kernel->Clone(), noise,
+                        PointSet(new std::vector<VectorXd>(*points)),
+                        targets, kNumTrainingPoints + 1);
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+
+    double mean, variance, fresh_mean, fresh_variance;
+    gp.Evaluate(x, mean, variance);
+    fresh.Evaluate(x, fresh_mean, fresh_variance);
+
+    EXPECT_NEAR(mean, fresh_mean, kMaxError);
+    EXPECT_NEAR(variance, fresh_variance, kMaxError);
+  }
+
+  // Snapshots see the new noise too.
+  double mean, variance, fresh_mean, fresh_variance;
+  const VectorXd x = VectorXd::Random(kDimension);
+  gp.Snapshot()->Evaluate(x, mean, variance);
+  fresh.Evaluate(x, fresh_mean, fresh_variance);
+  EXPECT_NEAR(mean, fresh_mean, kMaxError);
+  EXPECT_NEAR(variance, fresh_variance, kMaxError);
+
+  // Joint predictions work from the sweep as well.
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    queries.push_back(VectorXd::Random(kDimension));
+
+  VectorXd joint_mean, fresh_joint_mean;
+  MatrixXd joint_covariance, fresh_joint_covariance;
+  gp.Snapshot()->EvaluateJoint(queries, joint_mean, joint_covariance);
+  fresh.Snapshot()->EvaluateJoint(queries, fresh_joint_mean,
+                                  fresh_joint_covariance);
+  EXPECT_LT((joint_mean - fresh_joint_mean).lpNorm<Eigen::Infinity>(),
+            kMaxError);
+  EXPECT_LT((joint_covariance - fresh_joint_covariance)
+            .lpNorm<Eigen::Infinity>(), kMaxError);
+
+  // The Cholesky factor is computed when it is needed.
+  const MatrixXd factor = gp.ImmutableCholesky().matrixL();
+  const MatrixXd fresh_factor = fresh.ImmutableCholesky().matrixL();
+  EXPECT_LT((factor - fresh_factor).lpNorm<Eigen::Infinity>(), kMaxError);
+
+  // Writers which solve against the factor pick it up from the snapshot.
+  const VectorXd new_targets = VectorXd::Random(kNumTrainingPoints);
+  gp.SetTargets(new_targets);
+  fresh.SetTargets(new_targets);
+  EXPECT_LT((gp.ImmutableRegressedTargets() -
+             fresh.ImmutableRegressedTargets()).head(kNumTrainingPoints)
+            .lpNorm<Eigen::Infinity>(), kMaxError);
+
+  // Adding a point afterward refactors from the new noise.
+  const VectorXd point = VectorXd::Random(kDimension);
+  EXPECT_TRUE(gp.Add(point, 0.5));
+  EXPECT_TRUE(fresh.Add(point, 0.5));
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    gp.Evaluate(queries[ii], mean, variance);
+    fresh.Evaluate(queries[ii], fresh_mean, fresh_variance);
+
+    EXPECT_NEAR(mean, fresh_mean, kMaxError);
+    EXPECT_NEAR(variance, fresh_variance, kMaxError);
+  }
+}
+
+} //\namespace test
+} //\namespace gp
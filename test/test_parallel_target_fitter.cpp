@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <optimization/parallel_target_fitter.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+namespace {
+  // Root mean squared error of a GP against BumpyParabola on [0, 1].
+  double RmsError(const GaussianProcess& gp, size_t num_test_points,
+                  std::default_random_engine& rng) {
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    double squared_error = 0.0;
+    double mean, variance;
+    for (size_t ii = 0; ii < num_test_points; ii++) {
+      const double x = unif(rng);
+
+      gp.Evaluate(VectorXd::Constant(1, x), mean, variance);
+      squared_error += (mean - BumpyParabola(x)) * (mean - BumpyParabola(x));
+    }
+
+    return std::sqrt(squared_error / static_cast<double>(num_test_points));
+  }
+} //\namespace
+
+// Check that a single thread refreshing after every update takes exactly the
+// same steps as UpdateTargets.
+TEST(ParallelTargetFitter, TestMatchesSerial) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kBatchSize = 16;
+  const size_t kNumUpdates = 20;
+  const double kNoiseVariance = 0.01;
+  const double kStepSize = 0.1;
+  const double kMaxError = 1e-8;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = unif(rng);
+  }
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  const ParallelTargetFitter::Ptr fitter =
+    ParallelTargetFitter::Create(gp.Snapshot(), gp.ImmutableTargets(), 1, 7);
+
+  std::vector<VectorXd> batch_points(kBatchSize);
+  std::vector<double> batch_targets(kBatchSize);
+  for (size_t ii = 0; ii < kNumUpdates; ii++) {
+    for (size_t jj = 0; jj < kBatchSize; jj++) {
+      batch_points[jj] = VectorXd::Random(kDimension);
+      batch_targets[jj] = unif(rng);
+    }
+
+    EXPECT_NEAR(fitter->Update(batch_points, batch_targets, kStepSize),
+                gp.UpdateTargets(batch_points, batch_targets, kStepSize),
+                kMaxError);
+  }
+
+  EXPECT_EQ(fitter->NumUpdates(), kNumUpdates);
+
+  VectorXd fitted;
+  fitter->Targets(fitted);
+  EXPECT_LE((fitted - gp.ImmutableTargets().head(kNumTrainingPoints))
+            .lpNorm<Eigen::Infinity>(), kMaxError);
+}
+
+// Fit a simple 1D function from several threads at once, as in
+// TestFunctionApprox1D, and compare against serial UpdateTargets with the
+// same total number of updates. Also print throughput.
+TEST(ParallelTargetFitter, TestFunctionApprox1D) {
+  const size_t kNumTrainingPoints = 100;
+  const size_t kNumTestPoints = 100;
+  const size_t kBatchSize = 16;
+  const size_t kGradUpdates = 10000;
+  const double kNoiseVariance = 1e-3;
+  const double kLength = 0.1;
+  const double kStepSize = 0.1;
+  const double kMaxRmsError = 0.01;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = unif(rng);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, kLength));
+
+  // Serial baseline.
+  GaussianProcess serial(kernel->Clone(), kNoiseVariance,
+                         PointSet(new std::vector<VectorXd>(*points)),
+                         targets, kNumTrainingPoints);
+
+  std::vector<VectorXd> batch_points(kBatchSize);
+  std::vector<double> batch_targets(kBatchSize);
+  const std::chrono::high_resolution_clock::time_point serial_start =
+    std::chrono::high_resolution_clock::now();
+  for (size_t ii = 0; ii < kGradUpdates; ii++) {
+    for (size_t jj = 0; jj < kBatchSize; jj++) {
+      const double x = unif(rng);
+      batch_points[jj] = VectorXd::Constant(1, x);
+      batch_targets[jj] = BumpyParabola(x);
+    }
+
+    serial.UpdateTargets(batch_points, batch_targets, kStepSize,
+                         ii == kGradUpdates - 1);
+  }
+  const std::chrono::duration<double> serial_time =
+    std::chrono::high_resolution_clock::now() - serial_start;
+
+  const double serial_error = RmsError(serial, kNumTestPoints, rng);
+  std::printf("Serial:    %9.0f updates/s, RMS error %6.4f.\n",
+              kGradUpdates / serial_time.count(), serial_error);
+
+  // Parallel, with increasing numbers of threads.
+  const size_t kMaxThreads = std::max<size_t>(
+    2, std::min<unsigned>(8, std::thread::hardware_concurrency()));
+  for (size_t num_threads = 1; num_threads <= kMaxThreads; num_threads *= 2) {
+    GaussianProcess gp(kernel->Clone(), kNoiseVariance,
+                       PointSet(new std::vector<VectorXd>(*points)),
+                       targets, kNumTrainingPoints);
+    const ParallelTargetFitter::Ptr fitter =
+      ParallelTargetFitter::Create(gp.Snapshot(), gp.ImmutableTargets());
+
+    const std::chrono::high_resolution_clock::time_point start =
+      std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < num_threads; ii++) {
+      const unsigned int seed = rd();
+      threads.push_back(std::thread([&, num_threads, seed]() {
+        std::default_random_engine thread_rng(seed);
+        std::uniform_real_distribution<double> thread_unif(0.0, 1.0);
+
+        std::vector<VectorXd> thread_points(kBatchSize);
+        std::vector<double> thread_targets(kBatchSize);
+        for (size_t jj = 0; jj < kGradUpdates / num_threads; jj++) {
+          for (size_t kk = 0; kk < kBatchSize; kk++) {
+            const double x = thread_unif(thread_rng);
+            thread_points[kk] = VectorXd::Constant(1, x);
+            thread_targets[kk] = BumpyParabola(x);
+          }
+
+          fitter->Update(thread_points, thread_targets, kStepSize);
+        }
+      }));
+    }
+
+    for (size_t ii = 0; ii < num_threads; ii++)
+      threads[ii].join();
+
+    const std::chrono::duration<double> time =
+      std::chrono::high_resolution_clock::now() - start;
+
+    VectorXd fitted;
+    fitter->Targets(fitted);
+    gp.SetTargets(fitted);
+
+    const double error = RmsError(gp, kNumTestPoints, rng);
+    std::printf("%zu threads: %9.0f updates/s, RMS error %6.4f.\n",
+                num_threads, fitter->NumUpdates() / time.count(), error);
+    EXPECT_LE(error, std::max(kMaxRmsError, 2.0 * serial_error));
+  }
+}
+
+} //\namespace test
+} //\namespace gp
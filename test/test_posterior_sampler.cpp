@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for PosteriorSampler.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/posterior_sampler.hpp>
+#include <utils/thread_pool.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check the sample mean and covariance against the exact predictive mean
+// and covariance, up to sampling error plus the given tolerance.
+static void CheckMoments(const GaussianProcess& gp,
+                         const std::vector<VectorXd>& queries,
+                         const MatrixXd& samples, double tolerance) {
+  const size_t M = queries.size();
+  const size_t S = samples.cols();
+
+  // Predictive mean and covariance.
+  const Kernel& kernel = *gp.ImmutableKernel();
+  const std::vector<VectorXd>& points = *gp.ImmutablePoints();
+  MatrixXd cross(points.size(), M);
+  MatrixXd covariance(M, M);
+  for (size_t ii = 0; ii < M; ii++) {
+    for (size_t jj = 0; jj < points.size(); jj++)
+      cross(jj, ii) = kernel.Evaluate(points[jj], queries[ii]);
+    for (size_t jj = 0; jj < M; jj++)
+      covariance(ii, jj) = (ii == jj) ? 1.0 :
+        kernel.Evaluate(queries[ii], queries[jj]);
+  }
+
+  const VectorXd mean = cross.transpose() * gp.ImmutableRegressedTargets();
+  covariance -= cross.transpose() * gp.ImmutableCholesky().solve(cross);
+
+  // Sample moments.
+  const VectorXd sample_mean = samples.rowwise().mean();
+  const MatrixXd centered = samples.colwise() - sample_mean;
+  const MatrixXd sample_covariance =
+    centered * centered.transpose() / (S - 1);
+
+  for (size_t ii = 0; ii < M; ii++) {
+    EXPECT_NEAR(sample_mean(ii), mean(ii),
+                5.0 * std::sqrt(covariance(ii, ii) / S) + tolerance);
+
+    for (size_t jj = 0; jj < M; jj++) {
+      const double deviation = std::sqrt(
+        (covariance(ii, ii) * covariance(jj, jj) +
+         covariance(ii, jj) * covariance(ii, jj)) / S);
+      EXPECT_NEAR(sample_covariance(ii, jj), covariance(ii, jj),
+                  5.0 * deviation + tolerance);
+    }
+  }
+}
+
+// Sparse, noisy training data from sin(3x) on [-1, 1], so that predictive
+// variances are neither tiny nor close to the prior.
+static GaussianProcess::Ptr TrainingModel(size_t num_points) {
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(num_points);
+  for (size_t ii = 0; ii < num_points; ii++) {
+    points->push_back(VectorXd::Random(1));
+    targets(ii) = std::sin(3.0 * points->back()(0));
+  }
+
+  return GaussianProcess::Ptr(new GaussianProcess(
+    RbfKernel::Create(VectorXd::Constant(1, 0.3)), 0.01, points, targets,
+    num_points));
+}
+
+TEST(PosteriorSampler, TestExactMoments) {
+  const size_t kNumQueries = 8;
+  const size_t kNumSamples = 20000;
+
+  const GaussianProcess::ConstPtr gp = TrainingModel(10);
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumQueries; ii++)
+    queries.push_back(VectorXd::Random(1));
+
+  PosteriorSampler::Options options;
+  options.method = PosteriorSampler::EXACT;
+
+  MatrixXd samples;
+  EXPECT_TRUE(gp->Sample(queries, kNumSamples, samples, options));
+  ASSERT_EQ(samples.rows(), kNumQueries);
+  ASSERT_EQ(samples.cols(), kNumSamples);
+
+  CheckMoments(*gp, queries, samples, 1e-6);
+}
+
+TEST(PosteriorSampler, TestPathwiseMoments) {
+  const size_t kNumQueries = 8;
+  const size_t kNumSamples = 10000;
+
+  const GaussianProcess::ConstPtr gp = TrainingModel(10);
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumQueries; ii++)
+    queries.push_back(VectorXd::Random(1));
+
+  PosteriorSampler::Options options;
+  options.method = PosteriorSampler::PATHWISE;
+  options.num_features = 2048;
+
+  const PosteriorSampler::ConstPtr sampler =
+    PosteriorSampler::Create(gp->Snapshot(), options);
+  EXPECT_EQ(sampler->Choose(kNumQueries), PosteriorSampler::PATHWISE);
+
+  MatrixXd samples;
+  EXPECT_TRUE(sampler->Sample(queries, kNumSamples, samples));
+  ASSERT_EQ(samples.rows(), kNumQueries);
+  ASSERT_EQ(samples.cols(), kNumSamples);
+
+  // Allow for the error in the random feature approximation of the prior.
+  CheckMoments(*gp, queries, samples, 0.05);
+}
+
+// Exact sampling falls back to pathwise sampling when the predictive
+// covariance cannot be factored, here because the jitter starts too large.
+TEST(PosteriorSampler, TestExactFallsBack) {
+  const size_t kNumQueries = 8;
+  const size_t kNumSamples = 10000;
+
+  const GaussianProcess::ConstPtr gp = TrainingModel(10);
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumQueries; ii++)
+    queries.push_back(VectorXd::Random(1));
+
+  PosteriorSampler::Options options;
+  options.method = PosteriorSampler::EXACT;
+  options.jitter = 1.0;
+
+  MatrixXd samples;
+  EXPECT_TRUE(gp->Sample(queries, kNumSamples, samples, options));
+  ASSERT_EQ(samples.rows(), kNumQueries);
+  ASSERT_EQ(samples.cols(), kNumSamples);
+
+  CheckMoments(*gp, queries, samples, 0.05);
+}
+
+// Check the automatic choice of method.
+TEST(PosteriorSampler, TestChoose) {
+  const GaussianProcess::ConstPtr gp = TrainingModel(10);
+
+  PosteriorSampler::Options options;
+  options.max_exact_points = 100;
+  PosteriorSampler::ConstPtr sampler =
+    PosteriorSampler::Create(gp->Snapshot(), options);
+  EXPECT_EQ(sampler->Choose(100), PosteriorSampler::EXACT);
+  EXPECT_EQ(sampler->Choose(101), PosteriorSampler::PATHWISE);
+
+  options.method = PosteriorSampler::EXACT;
+  sampler = PosteriorSampler::Create(gp->Snapshot(), options);
+  EXPECT_EQ(sampler->Choose(101), PosteriorSampler::EXACT);
+
+  options.method = PosteriorSampler::PATHWISE;
+  sampler = PosteriorSampler::Create(gp->Snapshot(), options);
+  EXPECT_EQ(sampler->Choose(1), PosteriorSampler::PATHWISE);
+}
+
+// Compare the time taken by both methods for many query points, on one
+// shared pool. Disabled by default, since it only reports timings.
+TEST(PosteriorSampler, DISABLED_BenchmarkMethods) {
+  const size_t kNumQueries = 1500;
+  const size_t kNumSamples = 100;
+
+  const GaussianProcess::ConstPtr gp = TrainingModel(500);
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumQueries; ii++)
+    queries.push_back(VectorXd::Random(1));
+
+  PosteriorSampler::Options options;
+  options.method = PosteriorSampler::PATHWISE;
+  options.num_features = 512;
+  options.pool = ThreadPool::Create();
+
+  MatrixXd samples;
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(gp->Sample(queries, kNumSamples, samples, options));
+  const auto middle = std::chrono::steady_clock::now();
+
+  options.method = PosteriorSampler::EXACT;
+  EXPECT_TRUE(gp->Sample(queries, kNumSamples, samples, options));
+  const auto end = std::chrono::steady_clock::now();
+
+  const double pathwise_time =
+    std::chrono::duration<double>(middle - start).count();
+  const double exact_time =
+    std::chrono::duration<double>(end - middle).count();
+  std::printf("Drawing %zu samples at %zu points took %f s (pathwise) and "
+              "%f s (exact).\n", kNumSamples, kNumQueries, pathwise_time,
+              exact_time);
+}
+
+} //\namespace test
+} //\namespace gp
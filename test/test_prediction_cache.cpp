@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/prediction_cache.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check quantization, versioning, eviction, and counters.
+TEST(PredictionCache, TestLookup) {
+  const double kResolution = 0.1;
+  const size_t kCapacity = 8;
+
+  // A single shard makes eviction order deterministic.
+  const PredictionCache::Ptr cache =
+    PredictionCache::Create(kResolution, kCapacity, 1);
+  const uint64_t kOwner = PredictionCache::NewOwner();
+
+  double mean, variance;
+  EXPECT_FALSE(cache->Lookup(VectorXd::Constant(2, 0.01), kOwner, 0,
+                             mean, variance));
+  cache->Insert(VectorXd::Constant(2, 0.01), kOwner, 0, 1.0, 2.0);
+
+  // Same cell hits, neighboring cell misses.
+  EXPECT_TRUE(cache->Lookup(VectorXd::Constant(2, 0.09), kOwner, 0,
+                            mean, variance));
+  EXPECT_EQ(mean, 1.0);
+  EXPECT_EQ(variance, 2.0);
+  EXPECT_FALSE(cache->Lookup(VectorXd::Constant(2, 0.11), kOwner, 0,
+                             mean, variance));
+  EXPECT_FALSE(cache->Lookup(VectorXd::Constant(2, -0.01), kOwner, 0,
+                             mean, variance));
+
+  // Other versions miss, and drop the stale entry.
+  EXPECT_FALSE(cache->Lookup(VectorXd::Constant(2, 0.01), kOwner, 1,
+                             mean, variance));
+  EXPECT_FALSE(cache->Lookup(VectorXd::Constant(2, 0.01), kOwner, 0,
+                             mean, variance));
+  EXPECT_EQ(cache->Size(), 0);
+
+  // Fill past capacity, touching the first entry so that the second one is
+  // least recently used.
+  for (size_t ii = 0; ii <= kCapacity; ii++) {
+    cache->Insert(VectorXd::Constant(1, ii * kResolution + 0.05), kOwner, 0,
+                  static_cast<double>(ii), 0.0);
+    if (ii == 1)
+      EXPECT_TRUE(cache->Lookup(VectorXd::Constant(1, 0.05), kOwner, 0,
+                                mean, variance));
+  }
+
+  EXPECT_EQ(cache->Size(), kCapacity);
+  EXPECT_TRUE(cache->Lookup(VectorXd::Constant(1, 0.05), kOwner, 0,
+                            mean, variance));
+  EXPECT_FALSE(cache->Lookup(VectorXd::Constant(1, 0.15), kOwner, 0,
+                             mean, variance));
+  EXPECT_EQ(cache->Hits(), 3);
+  EXPECT_EQ(cache->Misses(), 6);
+
+  cache->Clear();
+  EXPECT_EQ(cache->Size(), 0);
+  EXPECT_EQ(cache->Hits(), 0);
+
+  // Readers of an older version neither drop nor overwrite a newer entry.
+  cache->Insert(VectorXd::Constant(1, 0.05), kOwner, 2, 1.0, 0.0);
+  EXPECT_FALSE(cache->Lookup(VectorXd::Constant(1, 0.05), kOwner, 1,
+                             mean, variance));
+  cache->Insert(VectorXd::Constant(1, 0.05), kOwner, 1, 2.0, 0.0);
+  EXPECT_TRUE(cache->Lookup(VectorXd::Constant(1, 0.05), kOwner, 2,
+                            mean, variance));
+  EXPECT_EQ(mean, 1.0);
+
+  // Other owners neither see nor replace the entry.
+  const uint64_t kOtherOwner = PredictionCache::NewOwner();
+  EXPECT_FALSE(cache->Lookup(VectorXd::Constant(1, 0.05), kOtherOwner, 2,
+                             mean, variance));
+  cache->Insert(VectorXd::Constant(1, 0.05), kOtherOwner, 3, 3.0, 0.0);
+  EXPECT_TRUE(cache->Lookup(VectorXd::Constant(1, 0.05), kOwner, 2,
+                            mean, variance));
+  EXPECT_EQ(mean, 1.0);
+  EXPECT_TRUE(cache->Lookup(VectorXd::Constant(1, 0.05), kOtherOwner, 3,
+                            mean, variance));
+  EXPECT_EQ(mean, 3.0);
+
+  // Points which cannot be quantized always miss, and are never stored.
+  const double kInfinity = std::numeric_limits<double>::infinity();
+  const double kNaN = std::numeric_limits<double>::quiet_NaN();
+  cache->Clear();
+  for (const double x : {kInfinity, -kInfinity, kNaN, 1e300}) {
+    cache->Insert(VectorXd::Constant(1, x), kOwner, 0, 1.0, 0.0);
+    EXPECT_FALSE(cache->Lookup(VectorXd::Constant(1, x), kOwner, 0,
+                               mean, variance));
+  }
+
+  EXPECT_EQ(cache->Size(), 0);
+}
+
+// Check that a cached GP returns the same predictions as an uncached one,
+// and that cached predictions are invalidated by model updates.
+TEST(PredictionCache, TestInvalidation) {
+  const size_t kNumTrainingPoints = 20;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-12;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.1));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     2 * kNumTrainingPoints);
+
+  // Use a very fine grid so that every test point has its own cell.
+  const PredictionCache::Ptr cache = PredictionCache::Create(1e-12, 1000);
+  gp.SetPredictionCache(cache);
+
+  std::vector<VectorXd> test_points;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    test_points.push_back(VectorXd::Constant(1, unif(rng)));
+
+  // Evaluate twice; the second pass must hit.
+  double mean, variance, cached_mean, cached_variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    gp.Evaluate(test_points[ii], mean, variance);
+    gp.Evaluate(test_points[ii], cached_mean, cached_variance);
+    EXPECT_EQ(mean, cached_mean);
+    EXPECT_EQ(variance, cached_variance);
+
+    gp.Snapshot()->Evaluate(test_points[ii], cached_mean, cached_variance);
+    EXPECT_EQ(mean, cached_mean);
+  }
+
+  EXPECT_EQ(cache->Hits(), 2 * kNumTestPoints);
+  EXPECT_EQ(cache->Misses(), kNumTestPoints);
+
+  // Every kind of update must bump the version.
+  uint64_t version = gp.Version();
+  EXPECT_TRUE(gp.Add(VectorXd::Constant(1, 0.5), BumpyParabola(0.5)));
+  EXPECT_GT(gp.Version(), version);
+
+  version = gp.Version();
+  gp.UpdateTargets(std::vector<VectorXd>(1, VectorXd::Constant(1, 0.5)),
+                   std::vector<double>(1, 0.0), 0.1);
+  EXPECT_GT(gp.Version(), version);
+
+  version = gp.Version();
+  EXPECT_TRUE(gp.LearnHyperparams());
+  EXPECT_GT(gp.Version(), version);
+
+  version = gp.Version();
+  EXPECT_TRUE(gp.SetTruncation(1e-6));
+  EXPECT_GT(gp.Version(), version);
+
+  version = gp.Version();
+  EXPECT_FALSE(gp.SetTruncation(0.0));
+  EXPECT_GT(gp.Version(), version);
+
+  // Predictions must now match an uncached model.
+  const size_t N = gp.ImmutablePoints()->size();
+  GaussianProcess reference(kernel->Clone(), kNoiseVariance,
+                            PointSet(new std::vector<VectorXd>(
+                              *gp.ImmutablePoints())),
+                            gp.ImmutableTargets().head(N), N);
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    gp.Evaluate(test_points[ii], cached_mean, cached_variance);
+    reference.Evaluate(test_points[ii], mean, variance);
+    EXPECT_NEAR(mean, cached_mean, kMaxError);
+    EXPECT_NEAR(variance, cached_variance, kMaxError);
+  }
+}
+
+// Check that models sharing a cache each get their own predictions.
+TEST(PredictionCache, TestSharedCache) {
+  const size_t kNumTrainingPoints = 10;
+  const double kNoiseVariance = 1e-3;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, static_cast<double>(ii) /
+                                         kNumTrainingPoints));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  // Same kernel and points, so both models are at the same version, but
+  // opposite targets.
+  GaussianProcess gp(RbfKernel::Create(VectorXd::Constant(1, 0.1)),
+                     kNoiseVariance, points, targets, kNumTrainingPoints);
+  GaussianProcess negated(RbfKernel::Create(VectorXd::Constant(1, 0.1)),
+                          kNoiseVariance, points, -targets,
+                          kNumTrainingPoints);
+  ASSERT_EQ(gp.Version(), negated.Version());
+
+  const PredictionCache::Ptr cache = PredictionCache::Create(1e-12, 1000);
+  gp.SetPredictionCache(cache);
+  negated.SetPredictionCache(cache);
+
+  const VectorXd x = VectorXd::Constant(1, 0.55);
+  double mean, variance, negated_mean, negated_variance;
+  gp.Evaluate(x, mean, variance);
+  negated.Evaluate(x, negated_mean, negated_variance);
+  EXPECT_NE(mean, 0.0);
+  EXPECT_EQ(negated_mean, -mean);
+
+  negated.Snapshot()->Evaluate(x, negated_mean, negated_variance);
+  EXPECT_EQ(negated_mean, -mean);
+  EXPECT_EQ(cache->Hits(), 1);
+}
+
+} //\namespace test
+} //\namespace gp
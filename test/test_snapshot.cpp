@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/model_snapshot.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that a snapshot evaluates exactly like the live model, and that it
+// does not change when the model is updated afterwards.
+TEST(ModelSnapshot, TestIsolation) {
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-12;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints / 2);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints / 2; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  // Train a GP.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.1));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  // Grab a snapshot and record its predictions.
+  const ModelSnapshot::ConstPtr snapshot = gp.Snapshot();
+  EXPECT_EQ(snapshot->NumPoints(), kNumTrainingPoints / 2);
+
+  std::vector<VectorXd> test_points;
+  std::vector<double> means, variances;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    test_points.push_back(VectorXd::Constant(1, unif(rng)));
+
+    double mean, variance, snapshot_mean, snapshot_variance;
+    gp.Evaluate(test_points.back(), mean, variance);
+    snapshot->Evaluate(test_points.back(), snapshot_mean, snapshot_variance);
+    EXPECT_NEAR(mean, snapshot_mean, kMaxError);
+    EXPECT_NEAR(variance, snapshot_variance, kMaxError);
+
+    means.push_back(snapshot_mean);
+    variances.push_back(snapshot_variance);
+  }
+
+  // Update the model in every possible way.
+  while (gp.ImmutablePoints()->size() < kNumTrainingPoints) {
+    const double x = unif(rng);
+    EXPECT_TRUE(gp.Add(VectorXd::Constant(1, x), BumpyParabola(x)));
+  }
+
+  gp.UpdateTargets(test_points, means, 0.1);
+  EXPECT_TRUE(gp.LearnHyperparams());
+
+  // The old snapshot must be unaffected, and the new one must be current.
+  EXPECT_EQ(snapshot->NumPoints(), kNumTrainingPoints / 2);
+  EXPECT_EQ(gp.Snapshot()->NumPoints(), kNumTrainingPoints);
+  EXPECT_NE(snapshot, gp.Snapshot());
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    double mean, variance;
+    snapshot->Evaluate(test_points[ii], mean, variance);
+    EXPECT_EQ(mean, means[ii]);
+    EXPECT_EQ(variance, variances[ii]);
+
+    double snapshot_mean, snapshot_variance;
+    gp.Evaluate(test_points[ii], mean, variance);
+    gp.Snapshot()->Evaluate(test_points[ii], snapshot_mean,
+                            snapshot_variance);
+    EXPECT_NEAR(mean, snapshot_mean, kMaxError);
+    EXPECT_NEAR(variance, snapshot_variance, kMaxError);
+  }
+}
+
+// Check that readers on several threads always see a consistent model while
+// a writer keeps adding points and relearning hyperparameters.
+TEST(ModelSnapshot, TestConcurrentReaders) {
+  const size_t kNumInitialPoints = 10;
+  const size_t kNumTrainingPoints = 60;
+  const size_t kNumReaders = 4;
+  const size_t kRelearnInterval = 10;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumInitialPoints);
+
+  for (size_t ii = 0; ii < kNumInitialPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.1));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  // Readers evaluate each snapshot at its own training points. Since the
+  // covariance is the kernel matrix plus noise on the diagonal, the mean at
+  // training point i is target_i - noise * regressed_i, an identity a torn
+  // kernel, point set, factorization or regressed target vector would break.
+  std::atomic<bool> done(false);
+  std::atomic<size_t> num_failures(0);
+  std::atomic<size_t> num_reads(0);
+  std::vector<std::thread> readers;
+  for (size_t ii = 0; ii < kNumReaders; ii++) {
+    readers.push_back(std::thread([&]() {
+      // Read at least once, even if the writer finishes first.
+      do {
+        const ModelSnapshot::ConstPtr snapshot = gp.Snapshot();
+        const size_t N = snapshot->NumPoints();
+        const VectorXd& regressed = snapshot->ImmutableRegressedTargets();
+
+        for (size_t jj = 0; jj < N; jj++) {
+          const VectorXd& x = snapshot->ImmutablePoints()->at(jj);
+          double mean, variance;
+          snapshot->Evaluate(x, mean, variance);
+
+          const double expected =
+            BumpyParabola(x(0)) - kNoiseVariance * regressed(jj);
+
+          if (std::abs(mean - expected) > kMaxError ||
+              !(variance > -kMaxError && variance <= 1.0 + kMaxError))
+            num_failures++;
+        }
+
+        num_reads++;
+      } while (!done.load());
+    }));
+  }
+
+  // Writer.
+  while (gp.ImmutablePoints()->size() < kNumTrainingPoints) {
+    const double x = unif(rng);
+    EXPECT_TRUE(gp.Add(VectorXd::Constant(1, x), BumpyParabola(x)));
+
+    if (gp.ImmutablePoints()->size() % kRelearnInterval == 0)
+      EXPECT_TRUE(gp.LearnHyperparams());
+  }
+
+  done = true;
+  for (auto& reader : readers)
+    reader.join();
+
+  EXPECT_GT(num_reads.load(), 0);
+  EXPECT_EQ(num_failures.load(), 0);
+}
+
+} //\namespace test
+} //\namespace gp
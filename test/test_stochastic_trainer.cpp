@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <optimization/cost_functors.hpp>
+#include <optimization/stochastic_trainer.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that minibatch training improves the full training log-likelihood
+// with either sampling scheme, and that polishing on the full data helps.
+TEST(StochasticTrainer, TestMinibatchTraining) {
+  const size_t kNumTrainingPoints = 400;
+  const size_t kBatchSize = 50;
+  const double kInitialLength = 0.01;
+  const double kNoiseVariance = 1e-2;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = BumpyParabola(points->back()(0));
+  }
+
+  // Full training log-likelihood.
+  TrainingLogLikelihood likelihood(points, &targets,
+                                   RbfKernel::Create(VectorXd::Ones(1)),
+                                   kNoiseVariance);
+  double initial_length = kInitialLength;
+  double initial_objective;
+  EXPECT_TRUE(likelihood.Evaluate(&initial_length, &initial_objective, NULL));
+
+  const StochasticTrainer::Sampling kSamplings[2] = {
+    StochasticTrainer::RANDOM_SAMPLING, StochasticTrainer::CLUSTERED_SAMPLING
+  };
+
+  for (size_t ii = 0; ii < 2; ii++) {
+    StochasticTrainer::Options options;
+    options.sampling = kSamplings[ii];
+    options.batch_size = kBatchSize;
+
+    const Kernel::Ptr kernel =
+      RbfKernel::Create(VectorXd::Constant(1, kInitialLength));
+    GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                       kNumTrainingPoints);
+    EXPECT_TRUE(gp.LearnHyperparamsStochastic(options));
+
+    double length = kernel->ImmutableParams()(0);
+    double objective;
+    EXPECT_TRUE(likelihood.Evaluate(&length, &objective, NULL));
+    EXPECT_LT(objective, initial_objective);
+
+    // Polishing should not do worse.
+    EXPECT_TRUE(gp.LearnHyperparamsStochastic(options, true));
+
+    length = kernel->ImmutableParams()(0);
+    double polished_objective;
+    EXPECT_TRUE(likelihood.Evaluate(&length, &polished_objective, NULL));
+    EXPECT_LE(polished_objective, objective);
+  }
+}
+
+} //\namespace test
+} //\namespace gp
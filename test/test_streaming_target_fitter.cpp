@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <optimization/streaming_target_fitter.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <Eigen/Cholesky>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check the streamed solution against a direct least squares solve in the
+// targets.
+TEST(StreamingTargetFitter, TestMatchesLeastSquares) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 10;
+  const size_t kNumSamples = 200;
+  const size_t kChunkSize = 37;
+  const double kNoiseVariance = 0.1;
+  const double kRidge = 0.1;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  std::vector<VectorXd> points;
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++)
+    points.push_back(VectorXd::Random(kDimension));
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  const StreamingTargetFitter::Ptr fitter =
+    StreamingTargetFitter::Create(*kernel, kNoiseVariance, points);
+
+  // Stream samples in chunks, and keep them for the direct solve.
+  std::vector<VectorXd> samples;
+  std::vector<double> sample_targets;
+  while (samples.size() < kNumSamples) {
+    std::vector<VectorXd> chunk;
+    std::vector<double> chunk_targets;
+    for (size_t ii = 0; ii < kChunkSize && samples.size() < kNumSamples;
+         ii++) {
+      samples.push_back(VectorXd::Random(kDimension));
+      sample_targets.push_back(unif(rng));
+      chunk.push_back(samples.back());
+      chunk_targets.push_back(sample_targets.back());
+    }
+
+    fitter->Add(chunk, chunk_targets);
+  }
+
+  EXPECT_EQ(fitter->NumSamples(), kNumSamples);
+
+  VectorXd targets;
+  double mse;
+  ASSERT_TRUE(fitter->Solve(kRidge, targets, &mse));
+
+  // Direct solve: predictions are R^T t, with R = inv(K) C.
+  MatrixXd covariance(kNumTrainingPoints, kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    for (size_t jj = 0; jj < kNumTrainingPoints; jj++) {
+      covariance(ii, jj) = kernel->Evaluate(points[ii], points[jj]) +
+        ((ii == jj) ? kNoiseVariance : 0.0);
+    }
+  }
+
+  MatrixXd cross(kNumTrainingPoints, kNumSamples);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++)
+    for (size_t jj = 0; jj < kNumSamples; jj++)
+      cross(ii, jj) = kernel->Evaluate(points[ii], samples[jj]);
+
+  const MatrixXd regressed_cross = covariance.llt().solve(cross);
+  const Eigen::Map<const VectorXd> y(sample_targets.data(), kNumSamples);
+  const MatrixXd system = regressed_cross * regressed_cross.transpose() +
+    kRidge * MatrixXd::Identity(kNumTrainingPoints, kNumTrainingPoints);
+  const VectorXd expected = system.llt().solve(regressed_cross * y);
+
+  EXPECT_LE((targets - expected).lpNorm<Eigen::Infinity>(), kMaxError);
+
+  const VectorXd errors = regressed_cross.transpose() * expected - y;
+  EXPECT_NEAR(mse, errors.squaredNorm() / kNumSamples, kMaxError);
+
+  // Without samples, only the ridge penalty remains.
+  fitter->Reset();
+  EXPECT_TRUE(fitter->Solve(kRidge, targets));
+  EXPECT_LE(targets.lpNorm<Eigen::Infinity>(), kMaxError);
+}
+
+// Check that one pass approximates a simple 1D function as well as the
+// gradient descent in TestFunctionApprox1D.
+TEST(StreamingTargetFitter, TestFunctionApprox1D) {
+  const size_t kNumTrainingPoints = 100;
+  const size_t kNumTestPoints = 100;
+  const size_t kNumChunks = 100;
+  const size_t kChunkSize = 100;
+  const double kMaxRmsError = 0.01;
+  const double kNoiseVariance = 1e-3;
+  const double kLength = 0.1;
+  const double kRidge = 1e-8;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Training points, with random targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = unif(rng);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, kLength));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  // Stream the dataset through the fitter.
+  const StreamingTargetFitter::Ptr fitter = gp.TargetFitter();
+  std::vector<VectorXd> chunk(kChunkSize);
+  std::vector<double> chunk_targets(kChunkSize);
+  for (size_t ii = 0; ii < kNumChunks; ii++) {
+    for (size_t jj = 0; jj < kChunkSize; jj++) {
+      const double x = unif(rng);
+      chunk[jj] = VectorXd::Constant(1, x);
+      chunk_targets[jj] = BumpyParabola(x);
+    }
+
+    fitter->Add(chunk, chunk_targets);
+  }
+
+  VectorXd fitted;
+  ASSERT_TRUE(fitter->Solve(kRidge, fitted));
+
+  const uint64_t version = gp.Version();
+  gp.SetTargets(fitted);
+  EXPECT_GT(gp.Version(), version);
+
+  // Test that we have approximated the function well.
+  double squared_error = 0.0;
+  double mean, variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const double x = unif(rng);
+
+    gp.Evaluate(VectorXd::Constant(1, x), mean, variance);
+    squared_error += (mean - BumpyParabola(x)) * (mean - BumpyParabola(x));
+  }
+
+  EXPECT_LE(std::sqrt(squared_error / static_cast<double>(kNumTestPoints)),
+            kMaxRmsError);
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for ThreadPool.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <utils/thread_pool.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace gp {
+namespace test {
+
+// Check that waiting on one group does not wait for another group's tasks.
+TEST(ThreadPool, TestIndependentGroups) {
+  const size_t kNumTasks = 20;
+
+  const ThreadPool::Ptr pool = ThreadPool::Create(2);
+
+  // The first group is blocked until released.
+  std::atomic<bool> released(false);
+  std::atomic<bool> blocked_finished(false);
+  ThreadPool::TaskGroup blocked;
+  pool->Schedule([&]() {
+    while (!released.load())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    blocked_finished = true;
+  }, blocked);
+
+  std::atomic<size_t> count(0);
+  ThreadPool::TaskGroup group;
+  for (size_t ii = 0; ii < kNumTasks; ii++)
+    pool->Schedule([&]() { count++; }, group);
+
+  pool->Wait(group);
+  EXPECT_EQ(count.load(), kNumTasks);
+  EXPECT_FALSE(blocked_finished.load());
+
+  released = true;
+  pool->Wait(blocked);
+  EXPECT_TRUE(blocked_finished.load());
+}
+
+// Check that tasks may wait on nested groups, even when every worker is busy.
+TEST(ThreadPool, TestNestedGroups) {
+  const size_t kNumOuterTasks = 4;
+  const size_t kNumInnerTasks = 10;
+
+  const ThreadPool::Ptr pool = ThreadPool::Create(1);
+
+  std::atomic<size_t> count(0);
+  ThreadPool::TaskGroup outer;
+  for (size_t ii = 0; ii < kNumOuterTasks; ii++) {
+    pool->Schedule([&]() {
+      ThreadPool::TaskGroup inner;
+      for (size_t jj = 0; jj < kNumInnerTasks; jj++)
+        pool->Schedule([&]() { count++; }, inner);
+
+      pool->Wait(inner);
+    }, outer);
+  }
+
+  pool->Wait(outer);
+  EXPECT_EQ(count.load(), kNumOuterTasks * kNumInnerTasks);
+}
+
+} //\namespace test
+} //\namespace gp
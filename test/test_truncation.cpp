@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for truncating the cross covariance in GaussianProcess::Evaluate.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/prediction_cache.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that truncated predictions are within the reported error bounds of
+// the full ones, for several cutoffs, with and without the inverse cached.
+TEST(Truncation, TestErrorBounds) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 500;
+  const size_t kNumTestPoints = 100;
+  const double kNoise = 0.01;
+  const double kLength = 0.1;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(5.0 * points->back()(0)) + points->back()(1);
+  }
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, kLength));
+  const GaussianProcess full(kernel->Clone(), kNoise,
+                             PointSet(new std::vector<VectorXd>(*points)),
+                             targets, kNumTrainingPoints);
+  GaussianProcess truncated(kernel->Clone(), kNoise, points, targets,
+                            kNumTrainingPoints);
+
+  for (size_t pass = 0; pass < 2; pass++) {
+    // On the second pass, cache the inverse (a zero step leaves the targets).
+    if (pass == 1) {
+      GaussianProcess::TargetUpdateOptions options;
+      options.cache_inverse = true;
+      truncated.SetTargetUpdateOptions(options);
+      truncated.UpdateTargets(std::vector<VectorXd>(1, points->at(0)),
+                              std::vector<double>(1, targets(0)), 0.0);
+    }
+
+    for (double cutoff = 1e-12; cutoff < 1e-1; cutoff *= 1e3) {
+      EXPECT_TRUE(truncated.SetTruncation(cutoff));
+      EXPECT_EQ(truncated.TruncationCutoff(), cutoff);
+
+      for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+        const VectorXd x = VectorXd::Random(kDimension);
+
+        double mean, variance, mean_error, variance_error;
+        double full_mean, full_variance;
+        truncated.Evaluate(x, mean, variance, mean_error, variance_error);
+        full.Evaluate(x, full_mean, full_variance);
+        EXPECT_LE(std::abs(mean - full_mean), mean_error + 1e-10);
+        EXPECT_LE(std::abs(variance - full_variance), variance_error + 1e-10);
+
+        double plain_mean, plain_variance;
+        truncated.Evaluate(x, plain_mean, plain_variance);
+        EXPECT_NEAR(plain_mean, mean, 1e-12);
+        EXPECT_NEAR(plain_variance, variance, 1e-12);
+
+        if (cutoff < 1e-10) {
+          EXPECT_NEAR(mean, full_mean, 1e-8);
+          EXPECT_NEAR(variance, full_variance, 1e-8);
+        }
+      }
+    }
+  }
+
+  // Disable.
+  EXPECT_FALSE(truncated.SetTruncation(0.0));
+  double mean, variance, mean_error, variance_error;
+  truncated.Evaluate(VectorXd::Zero(kDimension), mean, variance,
+                     mean_error, variance_error);
+  EXPECT_EQ(mean_error, 0.0);
+  EXPECT_EQ(variance_error, 0.0);
+}
+
+// Check that the index follows new points and kernel parameters.
+TEST(Truncation, TestStaysInSync) {
+  const size_t kMaxPoints = 200;
+  const size_t kNumTestPoints = 50;
+  const double kNoise = 0.01;
+  const double kCutoff = 1e-12;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kMaxPoints / 2);
+  for (size_t ii = 0; ii < kMaxPoints / 2; ii++) {
+    points->push_back(VectorXd::Random(1));
+    targets(ii) = std::sin(5.0 * points->back()(0));
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.05));
+  GaussianProcess gp(kernel, kNoise, points, targets, kMaxPoints);
+  EXPECT_TRUE(gp.SetTruncation(kCutoff));
+
+  const auto expect_matches_fresh = [&]() {
+    const size_t N = gp.ImmutablePoints()->size();
+    const GaussianProcess fresh(
+      kernel->Clone(), kNoise,
+      PointSet(new std::vector<VectorXd>(*gp.ImmutablePoints())),
+      gp.ImmutableTargets().head(N), kMaxPoints);
+
+    for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+      const VectorXd x = VectorXd::Random(1);
+
+      double mean, variance, fresh_mean, fresh_variance;
+      gp.Evaluate(x, mean, variance);
+      fresh.Evaluate(x, fresh_mean, fresh_variance);
+      EXPECT_NEAR(mean, fresh_mean, 1e-8);
+      EXPECT_NEAR(variance, fresh_variance, 1e-8);
+    }
+  };
+
+  // New points.
+  for (size_t ii = 0; ii < kMaxPoints / 2; ii++) {
+    const VectorXd x = VectorXd::Random(1);
+    EXPECT_TRUE(gp.Add(x, std::sin(5.0 * x(0))));
+  }
+
+  expect_matches_fresh();
+
+  // New kernel parameters.
+  kernel->Params()(0) = 0.02;
+  gp.RefitKernel();
+  expect_matches_fresh();
+}
+
+// Check that truncated predictions in a prediction cache are never returned
+// to snapshots, which evaluate exactly.
+TEST(Truncation, TestCachedSeparately) {
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 20;
+  const double kNoise = 0.01;
+  const double kCutoff = 0.5;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(1));
+    targets(ii) = std::sin(5.0 * points->back()(0));
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.2));
+  const GaussianProcess exact(kernel->Clone(), kNoise,
+                              PointSet(new std::vector<VectorXd>(*points)),
+                              targets, kNumTrainingPoints);
+  GaussianProcess gp(kernel->Clone(), kNoise, points, targets,
+                     kNumTrainingPoints);
+  gp.SetPredictionCache(PredictionCache::Create(1e-12, 1000));
+  EXPECT_TRUE(gp.SetTruncation(kCutoff));
+
+  size_t num_truncated = 0;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Random(1);
+
+    // Truncated predictions are cached.
+    double mean, variance, cached_mean, cached_variance;
+    gp.Evaluate(x, mean, variance);
+    gp.Evaluate(x, cached_mean, cached_variance);
+    EXPECT_EQ(cached_mean, mean);
+    EXPECT_EQ(cached_variance, variance);
+
+    // Snapshots must not see them.
+    double exact_mean, exact_variance;
+    exact.Evaluate(x, exact_mean, exact_variance);
+    gp.Snapshot()->Evaluate(x, cached_mean, cached_variance);
+    EXPECT_NEAR(cached_mean, exact_mean, 1e-12);
+    EXPECT_NEAR(cached_variance, exact_variance, 1e-12);
+
+    if (std::abs(mean - exact_mean) > 1e-6)
+      num_truncated++;
+  }
+
+  // Make sure the cutoff was large enough to matter.
+  EXPECT_GT(num_truncated, 0);
+}
+
+// Compare the time taken to evaluate with and without truncation, with the
+// inverse cached, for a short length scale.
+TEST(Truncation, BenchmarkEvaluate) {
+  const size_t kNumTrainingPoints = 1000;
+  const size_t kNumTestPoints = 200;
+  const double kNoise = 0.01;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(2));
+    targets(ii) = std::sin(5.0 * points->back()(0)) + points->back()(1);
+  }
+
+  GaussianProcess gp(RbfKernel::Create(VectorXd::Constant(2, 0.02)), kNoise,
+                     points, targets, kNumTrainingPoints);
+  GaussianProcess::TargetUpdateOptions options;
+  options.cache_inverse = true;
+  gp.SetTargetUpdateOptions(options);
+  gp.UpdateTargets(std::vector<VectorXd>(1, points->at(0)),
+                   std::vector<double>(1, targets(0)), 0.0);
+
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    queries.push_back(VectorXd::Random(2));
+
+  double mean, variance;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    gp.Evaluate(queries[ii], mean, variance);
+  const auto middle = std::chrono::steady_clock::now();
+
+  EXPECT_TRUE(gp.SetTruncation(1e-12));
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    gp.Evaluate(queries[ii], mean, variance);
+  const auto end = std::chrono::steady_clock::now();
+
+  const double full_time =
+    std::chrono::duration<double>(middle - start).count();
+  const double truncated_time =
+    std::chrono::duration<double>(end - middle).count();
+  std::printf("Evaluation took %f s (full) and %f s (truncated).\n",
+              full_time, truncated_time);
+}
+
+} //\namespace test
+} //\namespace gp
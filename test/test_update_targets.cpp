@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check the batched update against a point by point computation.
+TEST(UpdateTargets, TestBatchedGradient) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kBatchSize = 20;
+  const double kNoiseVariance = 0.01;
+  const double kStepSize = 0.1;
+  const double kMaxError = 1e-8;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Training data.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = unif(rng);
+  }
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  std::vector<VectorXd> batch_points;
+  std::vector<double> batch_targets;
+  for (size_t ii = 0; ii < kBatchSize; ii++) {
+    batch_points.push_back(VectorXd::Random(kDimension));
+    batch_targets.push_back(unif(rng));
+  }
+
+  // Point by point reference.
+  const Eigen::LLT<MatrixXd>& llt = gp.ImmutableCholesky();
+  double mse = 0.0;
+  VectorXd gradient = VectorXd::Zero(kNumTrainingPoints);
+  VectorXd cross(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kBatchSize; ii++) {
+    for (size_t jj = 0; jj < kNumTrainingPoints; jj++)
+      cross(jj) = kernel->Evaluate(points->at(jj), batch_points[ii]);
+
+    const VectorXd regressed_cross = llt.solve(cross);
+    const double error = regressed_cross.dot(targets) - batch_targets[ii];
+    mse += error * error;
+    gradient += error * regressed_cross;
+  }
+
+  mse /= static_cast<double>(kBatchSize);
+  gradient *= 2.0 / static_cast<double>(kBatchSize);
+  const VectorXd expected_targets = targets - kStepSize * gradient;
+
+  EXPECT_NEAR(gp.UpdateTargets(batch_points, batch_targets, kStepSize),
+              mse, kMaxError);
+  EXPECT_LE((gp.ImmutableTargets().head(kNumTrainingPoints) -
+             expected_targets).lpNorm<Eigen::Infinity>(), kMaxError);
+
+  // Regressed targets were recomputed.
+  EXPECT_LE((gp.ImmutableRegressedTargets().head(kNumTrainingPoints) -
+             llt.solve(expected_targets)).lpNorm<Eigen::Infinity>(),
+            kMaxError);
+}
+
+// Check that every update rule fits a simple 1D function.
+TEST(UpdateTargets, TestUpdateRules) {
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 100;
+  const size_t kBatchSize = 16;
+  const size_t kGradUpdates = 2000;
+  const double kNoiseVariance = 1e-3;
+  const double kLength = 0.1;
+  const double kMaxRmsError = 0.05;
+
+  const GaussianProcess::TargetUpdateMethod kMethods[] = {
+    GaussianProcess::TARGET_GRADIENT_DESCENT,
+    GaussianProcess::TARGET_MOMENTUM,
+    GaussianProcess::TARGET_ADAM
+  };
+  const double kStepSizes[] = { 0.1, 0.01, 0.01 };
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  for (size_t kk = 0; kk < 3; kk++) {
+    // Training points, evenly spaced, with zero targets.
+    PointSet points(new std::vector<VectorXd>);
+    for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+      points->push_back(VectorXd::Constant(
+        1, static_cast<double>(ii) / (kNumTrainingPoints - 1)));
+    }
+
+    const Kernel::Ptr kernel =
+      RbfKernel::Create(VectorXd::Constant(1, kLength));
+    GaussianProcess gp(kernel, kNoiseVariance, points,
+                       VectorXd::Zero(kNumTrainingPoints), kNumTrainingPoints);
+
+    GaussianProcess::TargetUpdateOptions options;
+    options.method = kMethods[kk];
+    gp.SetTargetUpdateOptions(options);
+
+    // Fit.
+    std::vector<VectorXd> batch_points(kBatchSize);
+    std::vector<double> batch_targets(kBatchSize);
+    for (size_t ii = 0; ii < kGradUpdates; ii++) {
+      for (size_t jj = 0; jj < kBatchSize; jj++) {
+        const double x = unif(rng);
+        batch_points[jj] = VectorXd::Constant(1, x);
+        batch_targets[jj] = BumpyParabola(x);
+      }
+
+      gp.UpdateTargets(batch_points, batch_targets, kStepSizes[kk],
+                       ii == kGradUpdates - 1);
+    }
+
+    // Test that we have approximated the function well.
+    double squared_error = 0.0;
+    double mean, variance;
+    for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+      const double x = unif(rng);
+
+      gp.Evaluate(VectorXd::Constant(1, x), mean, variance);
+      squared_error += (mean - BumpyParabola(x)) * (mean - BumpyParabola(x));
+    }
+
+    const double rms_error =
+      std::sqrt(squared_error / static_cast<double>(kNumTestPoints));
+    std::printf("Update rule %zu: RMS error %5.3f.\n", kk, rms_error);
+    EXPECT_LE(rms_error, kMaxRmsError);
+  }
+}
+
+// Check that updates through the cached inverse match those through the
+// Cholesky factor, including after the factorization changes.
+TEST(UpdateTargets, TestCachedInverse) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kBatchSize = 16;
+  const size_t kNumUpdates = 50;
+  const double kNoiseVariance = 0.01;
+  const double kStepSize = 0.1;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = unif(rng);
+  }
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  GaussianProcess direct(kernel->Clone(), kNoiseVariance,
+                         PointSet(new std::vector<VectorXd>(*points)),
+                         targets, 2 * kNumTrainingPoints);
+  GaussianProcess cached(kernel->Clone(), kNoiseVariance, points, targets,
+                         2 * kNumTrainingPoints);
+
+  GaussianProcess::TargetUpdateOptions options;
+  options.method = GaussianProcess::TARGET_MOMENTUM;
+  direct.SetTargetUpdateOptions(options);
+  options.cache_inverse = true;
+  cached.SetTargetUpdateOptions(options);
+
+  std::vector<VectorXd> batch_points(kBatchSize);
+  std::vector<double> batch_targets(kBatchSize);
+  for (size_t kk = 0; kk < 3; kk++) {
+    for (size_t ii = 0; ii < kNumUpdates; ii++) {
+      for (size_t jj = 0; jj < kBatchSize; jj++) {
+        batch_points[jj] = VectorXd::Random(kDimension);
+        batch_targets[jj] = unif(rng);
+      }
+
+      const bool finalize = (ii == kNumUpdates - 1);
+      EXPECT_NEAR(direct.UpdateTargets(batch_points, batch_targets,
+                                       kStepSize, finalize),
+                  cached.UpdateTargets(batch_points, batch_targets,
+                                       kStepSize, finalize), kMaxError);
+    }
+
+    const size_t N = direct.ImmutablePoints()->size();
+    EXPECT_LE((direct.ImmutableTargets().head(N) -
+               cached.ImmutableTargets().head(N)).lpNorm<Eigen::Infinity>(),
+              kMaxError);
+    EXPECT_LE((direct.ImmutableRegressedTargets().head(N) -
+               cached.ImmutableRegressedTargets().head(N))
+              .lpNorm<Eigen::Infinity>(), kMaxError);
+
+    // Change the factorization.
+    const VectorXd x = VectorXd::Random(kDimension);
+    const double target = unif(rng);
+    EXPECT_TRUE(direct.Add(x, target));
+    EXPECT_TRUE(cached.Add(x, target));
+  }
+}
+
+// Compare throughput of the batched update against solving for one batch
+// point at a time, for a range of batch sizes. Disabled by default, since it
+// only reports timings.
+TEST(UpdateTargets, DISABLED_BenchmarkBatchSizes) {
+  const size_t kDimension = 4;
+  const size_t kNumTrainingPoints = 1000;
+  const size_t kMinBatchSize = 16;
+  const size_t kMaxBatchSize = 1024;
+  const size_t kNumPointsPerSize = 2048;
+  const double kNoiseVariance = 0.01;
+  const double kStepSize = 1e-3;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = unif(rng);
+  }
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+  const Eigen::LLT<MatrixXd>& llt = gp.ImmutableCholesky();
+
+  for (size_t B = kMinBatchSize; B <= kMaxBatchSize; B *= 4) {
+    std::vector<VectorXd> batch_points(B);
+    std::vector<double> batch_targets(B);
+    for (size_t ii = 0; ii < B; ii++) {
+      batch_points[ii] = VectorXd::Random(kDimension);
+      batch_targets[ii] = unif(rng);
+    }
+
+    const size_t kNumBatches = kNumPointsPerSize / B;
+
+    // One point at a time, as UpdateTargets used to.
+    const std::chrono::high_resolution_clock::time_point loop_start =
+      std::chrono::high_resolution_clock::now();
+    VectorXd cross(kNumTrainingPoints);
+    VectorXd gradient(kNumTrainingPoints);
+    for (size_t ii = 0; ii < kNumBatches; ii++) {
+      gradient.setZero();
+      for (size_t jj = 0; jj < B; jj++) {
+        for (size_t kk = 0; kk < kNumTrainingPoints; kk++)
+          cross(kk) = kernel->Evaluate(points->at(kk), batch_points[jj]);
+
+        const VectorXd regressed_cross = llt.solve(cross);
+        gradient += (regressed_cross.dot(targets) - batch_targets[jj]) *
+          regressed_cross;
+      }
+
+      targets -= kStepSize * gradient;
+    }
+    const std::chrono::duration<double> loop_time =
+      std::chrono::high_resolution_clock::now() - loop_start;
+
+    // Batched, through the Cholesky factor and through the cached inverse.
+    GaussianProcess::TargetUpdateOptions options;
+    gp.SetTargetUpdateOptions(options);
+    const std::chrono::high_resolution_clock::time_point batch_start =
+      std::chrono::high_resolution_clock::now();
+    for (size_t ii = 0; ii < kNumBatches; ii++)
+      gp.UpdateTargets(batch_points, batch_targets, kStepSize, false);
+    const std::chrono::duration<double> batch_time =
+      std::chrono::high_resolution_clock::now() - batch_start;
+
+    options.cache_inverse = true;
+    gp.SetTargetUpdateOptions(options);
+    gp.UpdateTargets(batch_points, batch_targets, kStepSize, false);
+    const std::chrono::high_resolution_clock::time_point cached_start =
+      std::chrono::high_resolution_clock::now();
+    for (size_t ii = 0; ii < kNumBatches; ii++)
+      gp.UpdateTargets(batch_points, batch_targets, kStepSize, false);
+    const std::chrono::duration<double> cached_time =
+      std::chrono::high_resolution_clock::now() - cached_start;
+
+    std::printf("B = %4zu: %9.0f points/s point by point, "
+                "%9.0f points/s batched, %9.0f points/s cached inverse.\n", B,
+                kNumBatches * B / loop_time.count(),
+                kNumBatches * B / batch_time.count(),
+                kNumBatches * B / cached_time.count());
+  }
+}
+
+} //\namespace test
+} //\namespace gp